@@ -97,10 +97,25 @@ static void add_files(List<File> & files, FileType type, const char * dirpath, c
     static const bool windows = false;
 #endif
 
+#ifdef __linux__
+    static const bool isLinux = true;
+#else
+    static const bool isLinux = false;
+#endif
+
+//the headless build only has what the CPU benchmarks and the --render golden checks need,
+//so that it builds and runs on machines without SDL, GL or audio, like a Linux CI box.
+//glad and glutil come along because pixel.cpp's canvas presenter calls into them, but nothing headless calls that
+static const char * headlessFiles[] = {
+    "cpu", "drawlist", "glad", "glutil", "jobs", "pixel", "platform", "single_header_libs", "trace",
+    "bench", "bullet", "headless", "level", "pregen", "render", "tilecache", "tilemap",
+};
+
 int main(int argc, char ** argv) {
     const char * root = ".";
     const char * output = "build.ninja";
     const char * config = "";
+    bool headless = false;
 
     //parse command line arguments
     enum ArgType { ARG_NONE, ARG_ROOT, ARG_OUTPUT, ARG_CONFIG };
@@ -108,6 +123,8 @@ int main(int argc, char ** argv) {
     for (int i = 1; i < argc; ++i) {
         if (!strcmp(argv[i], "-v")) {
             verbose = true;
+        } else if (!strcmp(argv[i], "-headless")) {
+            headless = true;
         } else if (!strcmp(argv[i], "-r")) {
             type = ARG_ROOT;
         } else if (!strcmp(argv[i], "-o")) {
@@ -145,8 +162,10 @@ int main(int argc, char ** argv) {
     FILE * out = fopen(output, "w");
     assert(out);
     //NOTE: dev and perf sharing a directory here is intentional
-    const char * buildSubDir = conf == CONFIG_DEBUG? "debug" : conf == CONFIG_RELEASE? "release" : "dev";
-    fprintf(out, "ninja_required_version = 1.7\nbuilddir = build/%s/%s\n\n", windows? "win" : "mac", buildSubDir);
+    const char * buildSubDir = headless? "headless" :
+        conf == CONFIG_DEBUG? "debug" : conf == CONFIG_RELEASE? "release" : "dev";
+    fprintf(out, "ninja_required_version = 1.7\nbuilddir = build/%s/%s\n\n",
+        windows? "win" : isLinux? "linux" : "mac", buildSubDir);
 
     const char * debugArgs = conf == CONFIG_RELEASE? " -DCONFIG_RELEASE=1 -DNDEBUG " : " -DDEBUG ";
     const char * common = " clang -MMD -MF $out.d -c $in -o $out -fno-exceptions -fno-rtti "
@@ -173,7 +192,10 @@ int main(int argc, char ** argv) {
     fprintf(out, "    depfile = $out.d\n");
 
     fprintf(out, "rule link\n");
-    if (windows) {
+    if (headless) {
+        //NOTE: only mac and linux have a headless link line for now
+        fprintf(out, "    command = clang $in -o $out -lstdc++ -lpthread -lm -g %s\n", sanArgs);
+    } else if (windows) {
         #if USE_LLD_DIRECTLY
         Find_Result result = find_visual_studio_and_windows_sdk();
         printf("windows_sdk_root: %s\n", utf16_to_utf8(result.windows_sdk_root));
@@ -208,6 +230,13 @@ int main(int argc, char ** argv) {
     add_files(files, FILE_CLIB, "lib", ".c");
     add_files(files, FILE_SRC, "src", ".cpp");
 
+    //headless.cpp has its own main(), so exactly one of it and main.cpp goes into each build
+    for (File & f : files) {
+        bool headlessFile = false;
+        for (const char * name : headlessFiles) headlessFile |= !strcmp(f.name, name);
+        if (headless? !headlessFile : !strcmp(f.name, "headless")) f.type = FILE_NONE;
+    }
+
     //write compile commands
     for (File f : files) {
         const char * rule = match_pair<const char *>({
@@ -222,7 +251,8 @@ int main(int argc, char ** argv) {
     }
 
     //write link command
-    fprintf(out, "\nbuild %s: link", windows? "game.exe" : "game");
+    const char * executable = headless? "headless" : windows? "game.exe" : "game";
+    fprintf(out, "\nbuild %s: link", executable);
     for (File f : files) {
         if (one_of({ FILE_CPPLIB, FILE_CLIB, FILE_SRC }, f.type)) {
             fprintf(out, " $builddir/%s.o", f.name);
@@ -0,0 +1,11 @@
+#!/usr/bin/env sh
+# builds the headless benchmarks and golden checks (src/headless.cpp), which need neither SDL nor GL,
+# then passes the rest of the arguments to them, e.g. `./headless.sh perf --render --golden golden`
+cd "$(dirname "$0")"
+bob/build.sh || exit 1
+bob/bob -headless -o build.ninja -c "$1" || exit 1
+export NINJA_STATUS='[%f/%t] %es '
+ninja || exit 1
+rm build.ninja
+[ $# -gt 0 ] && shift
+./headless "$@"
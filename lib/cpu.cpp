@@ -0,0 +1,40 @@
+#include "cpu.hpp"
+#include <stdint.h>
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+    asm volatile ("cpuid" : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3]) : "a"(leaf), "c"(subleaf));
+}
+
+static uint64_t xgetbv(uint32_t index) {
+    uint32_t lo, hi;
+    asm volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(index));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static SimdLevel detect_simd_level() {
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    uint32_t maxLeaf = regs[0];
+    if (maxLeaf < 7) return SIMD_SSE2;
+
+    //AVX needs the OS to save the upper halves of the ymm registers on context switch, which it advertises via XCR0
+    cpuid(1, 0, regs);
+    bool osxsave = regs[2] & (1 << 27);
+    bool avx = regs[2] & (1 << 28);
+    if (!osxsave || !avx || (xgetbv(0) & 0x6) != 0x6) return SIMD_SSE2;
+
+    cpuid(7, 0, regs);
+    bool avx2 = regs[1] & (1 << 5);
+    return avx2? SIMD_AVX2 : SIMD_SSE2;
+}
+
+SimdLevel max_simd_level() {
+    static SimdLevel level = detect_simd_level();
+    return level;
+}
+
+SimdLevel simdLevel = max_simd_level();
+
+void set_simd_level(SimdLevel level) {
+    simdLevel = level < max_simd_level()? level : max_simd_level();
+}
@@ -0,0 +1,23 @@
+#ifndef CPU_HPP
+#define CPU_HPP
+
+//instruction set levels that we have hand-vectorized code paths for, in increasing order
+//NOTE: SSE2 is always available since we compile with -msse3, so it's the baseline vector path
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_LEVEL_COUNT,
+};
+
+static const char * const simdLevelNames[SIMD_LEVEL_COUNT] = { "scalar", "sse2", "avx2" };
+
+//the highest level supported by both the CPU and the OS, detected once on first call
+SimdLevel max_simd_level();
+
+//the level hot paths should dispatch on, which is `max_simd_level()` unless overridden
+//(e.g. by the benchmark harness, to compare code paths on the same machine)
+extern SimdLevel simdLevel;
+void set_simd_level(SimdLevel level);
+
+#endif // CPU_HPP
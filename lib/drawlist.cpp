@@ -0,0 +1,105 @@
+#include "drawlist.hpp"
+#include "jobs.hpp"
+#include "trace.hpp"
+
+void DrawList::finalize() {
+    commands.finalize();
+    for (List<int> & band : bands) band.finalize();
+    for (CachedTextRun & cached : runs) free_text_run(cached.run);
+    runs.finalize();
+    *this = {};
+}
+
+int find_text_run(DrawList & list, MonoFont & font, const char * text) {
+    //NOTE: there's only ever a handful of strings on screen, so a linear search is plenty
+    for (int i = 0; i < list.runs.len; ++i) {
+        TextRun & run = list.runs[i].run;
+        if (run.font == &font && !strcmp(run.text, text)) {
+            list.runs[i].frame = list.frame;
+            return i;
+        }
+    }
+    list.runs.add({ make_text_run(font, text), list.frame });
+    return list.runs.len - 1;
+}
+
+static void run_command(Canvas & canvas, DrawList & list, DrawCommand & c) {
+    switch (c.type) {
+        case DRAW_SPRITE_PREMUL: {
+            _draw_sprite_premul(canvas, c.premul.image, c.premul.cellx, c.premul.celly, c.premul.cx, c.premul.cy, c.premul.flip);
+        } break;
+        case DRAW_SPRITE: {
+            _draw_sprite(canvas, c.sprite.pixels, c.sprite.width, c.sprite.height, c.sprite.pitch, c.sprite.cx, c.sprite.cy);
+        } break;
+        case DRAW_SPRITE_FLIP: {
+            _draw_sprite_flip(canvas, c.sprite.pixels, c.sprite.width, c.sprite.height, c.sprite.pitch,
+                c.sprite.cx, c.sprite.cy, c.sprite.flip);
+        } break;
+        case DRAW_SPRITE_FADE: {
+            _draw_sprite(canvas, c.sprite.pixels, c.sprite.width, c.sprite.height, c.sprite.pitch,
+                c.sprite.cx, c.sprite.cy, c.sprite.alpha);
+        } break;
+        case DRAW_SPRITE_SILHOUETTE: {
+            _draw_sprite_silhouette(canvas, c.sprite.pixels, c.sprite.width, c.sprite.height, c.sprite.pitch,
+                c.sprite.cx, c.sprite.cy, c.color);
+        } break;
+        case DRAW_SPRITE_A1: {
+            _draw_sprite_a1(canvas, c.sprite.pixels, c.sprite.width, c.sprite.height, c.sprite.pitch,
+                c.sprite.cx, c.sprite.cy);
+        } break;
+        case DRAW_RECT: {
+            draw_rect(canvas, c.rect.x, c.rect.y, c.rect.w, c.rect.h, c.color);
+        } break;
+        case DRAW_OVAL: {
+            draw_oval_f(canvas, c.oval.x0, c.oval.y0, c.oval.w, c.oval.h, c.color);
+        } break;
+        case DRAW_TRIANGLE: {
+            draw_triangle(canvas, c.triangle.x1, c.triangle.y1, c.triangle.x2, c.triangle.y2,
+                c.triangle.x3, c.triangle.y3, c.color);
+        } break;
+        case DRAW_TEXT: {
+            draw_text_run(canvas, list.runs[c.text.run].run, c.text.cx, c.text.cy, c.color);
+        } break;
+        case DRAW_CALLBACK: {
+            c.callback.func(canvas, c.callback.data, c.callback.x, c.callback.y);
+        } break;
+    }
+}
+
+void execute_draw_list(DrawList & list, Canvas & canvas, int bandCount) { TimeFunc
+    bandCount = imax(1, imin(imin(bandCount, MAX_DRAW_BANDS), canvas.height));
+    int bandHeight = (canvas.height + bandCount - 1) / bandCount;
+
+    //bin the commands
+    for (int i = 0; i < bandCount; ++i) list.bands[i].len = 0;
+    for (int i = 0; i < list.commands.len; ++i) {
+        DrawCommand & c = list.commands[i];
+        int first = imax(0, c.miny) / bandHeight;
+        int last = (imin(canvas.height, c.maxy) - 1) / bandHeight;
+        for (int band = first; band <= last; ++band) {
+            list.bands[band].add(i);
+        }
+    }
+
+    parallel_for(bandCount, 1, [&] (int first, int last) {
+        for (int band = first; band < last; ++band) {
+            Canvas view = canvas;
+            view.top = imax(canvas.top, band * bandHeight);
+            view.height = imin(canvas.height, (band + 1) * bandHeight);
+            for (int i : list.bands[band]) {
+                run_command(view, list, list.commands[i]);
+            }
+        }
+    });
+
+    list.clear();
+
+    //text that's drawn every frame stays cached, anything else (like a counter that changed) is dropped
+    for (int i = 0; i < list.runs.len; ++i) {
+        if (list.runs[i].frame != list.frame) {
+            free_text_run(list.runs[i].run);
+            list.runs.remove(i--);
+        }
+    }
+    list.frame += 1;
+}
@@ -0,0 +1,175 @@
+#ifndef DRAWLIST_HPP
+#define DRAWLIST_HPP
+
+#include "pixel.hpp"
+#include "list.hpp"
+
+//a recorded list of canvas draw calls, so that a frame can be rasterized in parallel: the canvas is split into
+//horizontal bands, each command is binned into the bands it touches, and each band is drawn by its own job.
+//within a band the commands still run in the order they were recorded, and every primitive clips to the band
+//(see `Canvas::top`), so the result is pixel-identical to drawing straight into the canvas
+//NOTE: the list only stores pointers to images, tilesets and fonts, which must stay alive until it's executed
+
+enum DrawCommandType {
+    DRAW_SPRITE_PREMUL,
+    DRAW_SPRITE,
+    DRAW_SPRITE_FLIP,
+    DRAW_SPRITE_FADE,
+    DRAW_SPRITE_SILHOUETTE,
+    DRAW_SPRITE_A1,
+    DRAW_RECT,
+    DRAW_OVAL,
+    DRAW_TRIANGLE,
+    DRAW_TEXT,
+    DRAW_CALLBACK,
+};
+
+//draws something that isn't one of the built-in primitives, offset by (x, y)
+//NOTE: this gets called once per band, from multiple threads at once, so it must only draw from `canvas.top` down
+//      and must not modify `data`
+typedef void (* DrawCallback) (Canvas & canvas, void * data, int x, int y);
+
+struct DrawCommand {
+    DrawCommandType type;
+    int miny, maxy; //rows of the canvas this can touch, [miny, maxy), only used for binning so it can overestimate
+    Color color; //the fill color for sprite silhouettes
+    union {
+        struct { Image image; int cellx, celly, cx, cy, flip; } premul;
+        struct { Pixel * pixels; int width, height, pitch, cx, cy, flip; float alpha; } sprite;
+        struct { int x, y, w, h; } rect;
+        struct { float x0, y0, w, h; } oval;
+        struct { int x1, y1, x2, y2, x3, y3; } triangle;
+        struct { int run, cx, cy; } text; //`run` is an index into `DrawList::runs`
+        struct { DrawCallback func; void * data; int x, y; } callback;
+    };
+};
+
+static const int MAX_DRAW_BANDS = 64;
+
+//a rasterized string that stays cached for as long as it keeps getting drawn every frame
+struct CachedTextRun {
+    TextRun run;
+    int frame; //the last frame it was drawn in
+};
+
+struct DrawList {
+    List<DrawCommand> commands;
+    List<int> bands[MAX_DRAW_BANDS]; //indices of the commands that touch each band, in order
+    List<CachedTextRun> runs; //the strings drawn this frame, so text that's on screen for a while is rasterized once
+    int frame; //number of times the list has been executed
+
+    void add(DrawCommand command) { commands.add(command); }
+    void clear() { commands.len = 0; }
+    void finalize();
+};
+
+//returns the index into `list.runs` of `text` rasterized with `font`, rasterizing it if it wasn't cached yet
+int find_text_run(DrawList & list, MonoFont & font, const char * text);
+
+//draws every command into `canvas`, split into `bandCount` bands of equal height that are drawn in parallel,
+//then clears the list and drops any cached text that wasn't drawn this frame.
+//with one band this is exactly the same as drawing every command straight into the canvas
+void execute_draw_list(DrawList & list, Canvas & canvas, int bandCount);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// RECORDING                                                                                                        ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//these mirror the functions of the same names in pixel.hpp, but record the call instead of drawing it
+
+static inline void _draw_sprite(DrawList & list, DrawCommandType type,
+    Pixel * pixels, int width, int height, int pitch, int cx, int cy, int flip, float alpha, Color fill)
+{
+    DrawCommand command = { type, cy, cy + height, fill };
+    command.sprite = { pixels, width, height, pitch, cx, cy, flip, alpha };
+    list.add(command);
+}
+
+//NOTE: the image is stored by value, so it's fine to record drawing a copy of one that goes out of scope,
+//      as long as its pixels don't
+static inline void _draw_sprite_premul(DrawList & list, Image & image, int cellx, int celly, int cx, int cy, bool flip) {
+    DrawCommand command = { DRAW_SPRITE_PREMUL, cy, cy + image.premul->cellHeight };
+    command.premul = { image, cellx, celly, cx, cy, flip };
+    list.add(command);
+}
+
+static inline void draw_sprite(DrawList & list, Image & image, int cx, int cy) {
+    if (image.premul) _draw_sprite_premul(list, image, 0, 0, cx, cy, false);
+    else _draw_sprite(list, DRAW_SPRITE, image.pixels, image.width, image.height, image.width, cx, cy, 0, 1, {});
+}
+
+static inline void draw_sprite(DrawList & list, Image & image, int cx, int cy, float alpha) {
+    _draw_sprite(list, DRAW_SPRITE_FADE, image.pixels, image.width, image.height, image.width, cx, cy, 0, alpha, {});
+}
+
+static inline void draw_sprite_silhouette(DrawList & list, Image & image, int cx, int cy, Color fill) {
+    _draw_sprite(list, DRAW_SPRITE_SILHOUETTE, image.pixels, image.width, image.height, image.width, cx, cy, 0, 1, fill);
+}
+
+static inline void draw_sprite_a1(DrawList & list, Image & image, int cx, int cy) {
+    _draw_sprite(list, DRAW_SPRITE_A1, image.pixels, image.width, image.height, image.width, cx, cy, 0, 1, {});
+}
+
+static inline void draw_tile(DrawList & list, Tileset & set, int tx, int ty, int cx, int cy) {
+    if (set.image.premul) _draw_sprite_premul(list, set.image, tx, ty, cx, cy, false);
+    else _draw_sprite(list, DRAW_SPRITE, &set.image[ty * set.tileHeight][tx * set.tileWidth],
+        set.tileWidth, set.tileHeight, set.image.width, cx, cy, 0, 1, {});
+}
+
+static inline void draw_tile_flip(DrawList & list, Tileset & set, int tx, int ty, int cx, int cy, bool flip) {
+    if (set.image.premul) _draw_sprite_premul(list, set.image, tx, ty, cx, cy, flip);
+    else _draw_sprite(list, DRAW_SPRITE_FLIP, &set.image[ty * set.tileHeight][tx * set.tileWidth],
+        set.tileWidth, set.tileHeight, set.image.width, cx, cy, flip, 1, {});
+}
+
+static inline void draw_tile_a1(DrawList & list, Tileset & set, int tx, int ty, int cx, int cy) {
+    _draw_sprite(list, DRAW_SPRITE_A1, &set.image[ty * set.tileHeight][tx * set.tileWidth],
+        set.tileWidth, set.tileHeight, set.image.width, cx, cy, 0, 1, {});
+}
+
+static inline void draw_tile_silhouette(DrawList & list, Tileset & set, int tx, int ty, int cx, int cy, Color fill) {
+    _draw_sprite(list, DRAW_SPRITE_SILHOUETTE, &set.image[ty * set.tileHeight][tx * set.tileWidth],
+        set.tileWidth, set.tileHeight, set.image.width, cx, cy, 0, 1, fill);
+}
+
+static inline void draw_rect(DrawList & list, int x, int y, int w, int h, Color color) {
+    DrawCommand command = { DRAW_RECT, y, y + h, color };
+    command.rect = { x, y, w, h };
+    list.add(command);
+}
+
+static inline void draw_oval_f(DrawList & list, float x0, float y0, float w, float h, Color color) {
+    DrawCommand command = { DRAW_OVAL, (int) lroundf(y0 - h), (int) lroundf(y0 + h) + 1, color };
+    command.oval = { x0, y0, w, h };
+    list.add(command);
+}
+
+static inline void draw_triangle(DrawList & list, int x1, int y1, int x2, int y2, int x3, int y3, Color color) {
+    DrawCommand command = { DRAW_TRIANGLE, imin(y1, imin(y2, y3)), imax(y1, imax(y2, y3)) + 1, color };
+    command.triangle = { x1, y1, x2, y2, x3, y3 };
+    list.add(command);
+}
+
+static inline void draw_text(DrawList & list, MonoFont & font, int cx, int cy, Color color, const char * text) {
+    int run = find_text_run(list, font, text);
+    DrawCommand command = { DRAW_TEXT, cy, cy + list.runs[run].run.height, color };
+    command.text = { run, cx, cy };
+    list.add(command);
+}
+
+static inline void draw_text_center(DrawList & list, MonoFont & font, int cx, int cy, Color color, const char * text) {
+    draw_text(list, font, cx - font.glyphWidth * strlen(text) / 2, cy, color, text);
+}
+
+static inline void draw_text_right(DrawList & list, MonoFont & font, int cx, int cy, Color color, const char * text) {
+    draw_text(list, font, cx - font.glyphWidth * strlen(text), cy, color, text);
+}
+
+//records a call to `func` that may draw anywhere in rows [miny, maxy) of the canvas
+static inline void draw_callback(DrawList & list, DrawCallback func, void * data, int x, int y, int miny, int maxy) {
+    DrawCommand command = { DRAW_CALLBACK, miny, maxy };
+    command.callback = { func, data, x, y };
+    list.add(command);
+}
+
+#endif // DRAWLIST_HPP
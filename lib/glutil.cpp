@@ -2,17 +2,7 @@
 #include "stb_image.h"
 #include "platform.hpp"
 
-Texture load_texture(const char * imagePath) {
-    int w, h, c;
-    u8 * image = stbi_load(imagePath, &w, &h, &c, 4);
-
-    if (image == nullptr) {
-        fflush(stdout);
-        fprintf(stderr, "ERROR: Could not load file %s\n", imagePath);
-        fflush(stderr);
-        return { 0, 0, 0 };
-    }
-
+Texture create_texture(const u8 * pixels, int w, int h) {
     uint tex;
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
@@ -23,13 +13,27 @@ Texture load_texture(const char * imagePath) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-
-    stbi_image_free(image);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
     return { tex, w, h };
 }
 
+Texture load_texture(const char * imagePath) {
+    int w, h, c;
+    u8 * image = stbi_load(imagePath, &w, &h, &c, 4);
+
+    if (image == nullptr) {
+        fflush(stdout);
+        fprintf(stderr, "ERROR: Could not load file %s\n", imagePath);
+        fflush(stderr);
+        return { 0, 0, 0 };
+    }
+
+    Texture tex = create_texture(image, w, h);
+    stbi_image_free(image);
+    return tex;
+}
+
 static GLuint create_shader(GLenum shaderType, const char * source) {
     GLuint shader = glCreateShader(shaderType);
     glShaderSource(shader, 1, &source, NULL);
@@ -11,6 +11,7 @@ struct Texture {
 	int height;
 };
 
+Texture create_texture(const u8 * pixels, int w, int h); //from RGBA pixels
 Texture load_texture(const char * imagePath);
 GLuint create_program_from_files(const char * vertexShaderPath, const char * fragmentShaderPath);
 void gl_error(const char * when);
@@ -1,25 +1,136 @@
 #include "imm.hpp"
 #include "stb_image.h"
 #include "platform.hpp"
+#include "common.hpp"
 
 #include <string.h>
 
+////////////////////////////////////////////////////////////////////////////////
+/// ATLAS                                                                    ///
+////////////////////////////////////////////////////////////////////////////////
+
+static void add_atlas_page(Atlas & atlas) {
+    AtlasPage page = {};
+    page.packer = (stbrp_context *) malloc(sizeof(stbrp_context) + ATLAS_PAGE_SIZE * sizeof(stbrp_node));
+    stbrp_init_target(page.packer, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, (stbrp_node *) (page.packer + 1), ATLAS_PAGE_SIZE);
+
+    //the unused parts of a page are never drawn, but clearing them makes the page much easier to look at in a debugger
+    uint8_t * blank = (uint8_t *) calloc(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE, 4);
+    glGenTextures(1, &page.tex.handle);
+    glBindTexture(GL_TEXTURE_2D, page.tex.handle);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, blank);
+    free(blank);
+    page.tex.width = page.tex.height = ATLAS_PAGE_SIZE;
+    atlas.pages.add(page);
+}
+
+Atlas make_atlas() {
+    Atlas atlas = {};
+    add_atlas_page(atlas);
+    uint8_t white[4] = { 255, 255, 255, 255 };
+    atlas.white = add_atlas_image(atlas, white, 1, 1);
+    return atlas;
+}
+
+void free_atlas(Atlas & atlas) {
+    for (AtlasPage & page : atlas.pages) {
+        glDeleteTextures(1, &page.tex.handle);
+        free(page.packer);
+    }
+    atlas.pages.finalize();
+    atlas = {};
+}
+
+//NOTE: this binds the page's texture, so don't add images in between `Imm::begin()` and `Imm::end()`
+AtlasImage add_atlas_image(Atlas & atlas, uint8_t * pixels, int width, int height) {
+    int paddedWidth = width + 2, paddedHeight = height + 2;
+    assert(paddedWidth <= ATLAS_PAGE_SIZE && paddedHeight <= ATLAS_PAGE_SIZE);
+
+    //pages only fill up, so any image that didn't fit in an earlier page won't fit there later either,
+    //but a smaller image might, so every page gets a try
+    stbrp_rect rect = { 0, (stbrp_coord) paddedWidth, (stbrp_coord) paddedHeight };
+    int page = 0;
+    while (!stbrp_pack_rects(atlas.pages[page].packer, &rect, 1)) {
+        page += 1;
+        if (page == atlas.pages.len) add_atlas_page(atlas);
+    }
+
+    uint32_t * padded = (uint32_t *) malloc(paddedWidth * paddedHeight * sizeof(uint32_t));
+    for (int y = 0; y < paddedHeight; ++y) {
+        uint32_t * src = (uint32_t *) pixels + imin(imax(y - 1, 0), height - 1) * width;
+        for (int x = 0; x < paddedWidth; ++x) {
+            padded[y * paddedWidth + x] = src[imin(imax(x - 1, 0), width - 1)];
+        }
+    }
+    Texture tex = atlas.pages[page].tex;
+    glBindTexture(GL_TEXTURE_2D, tex.handle);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, paddedWidth, paddedHeight,
+                    GL_RGBA, GL_UNSIGNED_BYTE, padded);
+    free(padded);
+    gl_error("add_atlas_image");
+
+    return { tex, (uint16_t) (rect.x + 1), (uint16_t) (rect.y + 1), (uint16_t) width, (uint16_t) height };
+}
+
+AtlasImage load_atlas_image(Atlas & atlas, const char * imagePath) {
+    int w, h, c;
+    uint8_t * pixels = stbi_load(imagePath, &w, &h, &c, 4);
+    if (pixels == nullptr) {
+        fprintf(stderr, "ERROR: Could not load file %s\n", imagePath);
+        exit(1);
+    }
+    AtlasImage image = add_atlas_image(atlas, pixels, w, h);
+    stbi_image_free(pixels);
+    return image;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// FONTS                                                                    ///
 ////////////////////////////////////////////////////////////////////////////////
 
-//TODO: go over this code and see if it can be improved
-//TODO: switch to pre-processing font files at compile time?
+//the baked font file, which is just these structs as they are in memory, since it's only a cache of the .fnt
+//and is rebuilt on any machine that loads the font
+struct BakedFont {
+    uint32_t magic;
+    int32_t version;
+    char page[64]; //path of the font's image, relative to the .fnt
+    uint16_t lineHeight, base, scaleW, scaleH;
+    int32_t width, height; //of the image
+    int32_t kerningPairs; //how many pairs of chars have kerning, the table is left out if there aren't any
+    Char chars[128];
+    float advances[128];
+    //followed by int8_t kerning[128 * 128] if there are any kerning pairs, then the image's RGBA pixels
+};
+
+static const uint32_t BAKED_FONT_MAGIC = 'F' | 'O' << 8 | 'N' << 16 | 'T' << 24;
+static const int32_t BAKED_FONT_VERSION = 1;
+static const int KERNING_TABLE_SIZE = 128 * 128;
+
+static char * baked_font_path(const char * bmfont) {
+    return dsprintf(nullptr, "%s.bin", bmfont);
+}
 
-Font load_font(const char * bmfont) {
+//makes a path to `relativePath` from the folder the .fnt is in
+static char * font_image_path(const char * bmfont, const char * relativePath) {
+    const char * slash = strrchr(bmfont, '/');
+    int folderPathLen = slash? slash - bmfont + 1 : 0;
+    return dsprintf(nullptr, "%.*s%s", folderPathLen, bmfont, relativePath);
+}
+
+void bake_font(const char * bmfont) {
     enum BlockType {
-        OTHER, COMMON, PAGE, CHAR,
+        OTHER, COMMON, PAGE, CHAR, KERNING,
     };
 
-    Font font = {};
-    font.kernBias = -8; //TODO: compute this better
-    font.chars = (Char *) malloc(128 * sizeof(Char));
-    memset(font.chars, 0, 128 * sizeof(Char));
+    BakedFont * baked = (BakedFont *) calloc(1, sizeof(BakedFont));
+    int8_t * kerning = (int8_t *) calloc(KERNING_TABLE_SIZE, 1);
+    baked->magic = BAKED_FONT_MAGIC;
+    baked->version = BAKED_FONT_VERSION;
 
     char * text = read_entire_file(bmfont);
 
@@ -29,11 +140,8 @@ Font load_font(const char * bmfont) {
         exit(1);
     }
 
-    char * relativePath = nullptr;
     Char * ch = nullptr;
-
-    //kerning pairs appear to have very little visual impact, especially at small glyph sizes,
-    //so we leave them out of our implementation for size/memory/simplicity/performance reasons
+    int first = 0, second = 0;
 
     //simple stateful parsing algorithm which ignores line breaks because it can.
     //for now we assume all glyphs are contained in one image, and ignore non-ascii chars
@@ -44,6 +152,7 @@ Font load_font(const char * bmfont) {
              if (!strcmp(token, "common" )) { type = COMMON;  }
         else if (!strcmp(token, "page"   )) { type = PAGE;    }
         else if (!strcmp(token, "char"   )) { type = CHAR;    }
+        else if (!strcmp(token, "kerning")) { type = KERNING; }
         else if (type != OTHER) {
             //parse key-value pair
             char * eq = strchr(token, '=');
@@ -57,31 +166,32 @@ Font load_font(const char * bmfont) {
                 switch (type) {
                     case COMMON: {
                         if (!strcmp(key, "lineHeight")) {
-                            font.lineHeight = strtol(value, nullptr, 10);
+                            baked->lineHeight = strtol(value, nullptr, 10);
                         } else if (!strcmp(key, "base")) {
-                            font.base = strtol(value, nullptr, 10);
+                            baked->base = strtol(value, nullptr, 10);
                         } else if (!strcmp(key, "scaleW")) {
-                            font.scaleW = strtol(value, nullptr, 10);
+                            baked->scaleW = strtol(value, nullptr, 10);
                         } else if (!strcmp(key, "scaleH")) {
-                            font.scaleH = strtol(value, nullptr, 10);
+                            baked->scaleH = strtol(value, nullptr, 10);
                         }
                     } break;
                     case PAGE: {
                         if (!strcmp(key, "file")) {
                             *strchr(value + 1, '"') = '\0';
-                            relativePath = value + 1;
+                            assert(strlen(value + 1) < sizeof(baked->page));
+                            strcpy(baked->page, value + 1);
                         }
                     } break;
                     case CHAR: {
                         if (!strcmp(key, "id")) {
                             int id = strtol(value, nullptr, 10);
                             if (id < 128) {
-                                ch = font.chars + id;
+                                ch = baked->chars + id;
                             } else {
                                 printf("NON-ASCII CHAR IN FONT: %d\n", id);
                                 //overwriting nul char is safe because it is never printed
                                 //TODO: properly extend this to support all of unicode
-                                ch = font.chars;
+                                ch = baked->chars;
                             }
                         } else if (!strcmp(key, "x")) {
                             ch->x = strtol(value, nullptr, 10);
@@ -99,6 +209,17 @@ Font load_font(const char * bmfont) {
                             ch->xadvance = strtol(value, nullptr, 10);
                         }
                     } break;
+                    case KERNING: {
+                        //NOTE: pairs with non-ascii chars are dropped, like the chars themselves
+                        if (!strcmp(key, "first")) {
+                            first = strtol(value, nullptr, 10);
+                        } else if (!strcmp(key, "second")) {
+                            second = strtol(value, nullptr, 10);
+                        } else if (!strcmp(key, "amount") && first < 128 && second < 128) {
+                            kerning[first * 128 + second] = strtol(value, nullptr, 10);
+                            baked->kerningPairs += 1;
+                        }
+                    } break;
                     case OTHER: {} //unreachable case included to suppress warning
                 }
             }
@@ -107,51 +228,177 @@ Font load_font(const char * bmfont) {
         token = strtok(nullptr, " \t\r\n");
     }
 
-    //make "absolute" (root-relative) path from file-relative path
-    const char * slash = strrchr(bmfont, '/');
-    int folderPathLen = slash - bmfont + 1;
-    char * imagePath = (char *) malloc(folderPathLen + strlen(relativePath) + 1);
-    strncpy(imagePath, bmfont, folderPathLen);
-    strcpy(imagePath + folderPathLen, relativePath);
-
     free(text); //not used past this point
 
-    //load image
-    font.tex = load_texture(imagePath);
-    assert(font.tex.handle);
+    //the spacing Hiero puts in the advances is too wide for how we draw text, so it gets taken back out here
+    //TODO: compute this better
+    float kernBias = -8;
+    for (int i = 0; i < 128; ++i) {
+        baked->advances[i] = baked->chars[i].xadvance + kernBias;
+    }
 
+    //load image
+    char * imagePath = font_image_path(bmfont, baked->page);
+    int c;
+    uint8_t * pixels = stbi_load(imagePath, &baked->width, &baked->height, &c, 4);
+    if (pixels == nullptr) {
+        fprintf(stderr, "ERROR: Could not load file %s\n", imagePath);
+        exit(1);
+    }
     free(imagePath); //not used past this point
 
+    List<char> blob = {};
+    blob.add((char *) baked, sizeof(BakedFont));
+    if (baked->kerningPairs) blob.add((char *) kerning, KERNING_TABLE_SIZE);
+    blob.add((char *) pixels, baked->width * baked->height * 4);
+    char * bakedPath = baked_font_path(bmfont);
+    if (!write_entire_file(bakedPath, blob.data, blob.len)) {
+        fprintf(stderr, "ERROR: Could not write file %s\n", bakedPath);
+        exit(1);
+    }
+
+    free(bakedPath);
+    blob.finalize();
+    stbi_image_free(pixels);
+    free(kerning);
+    free(baked);
+}
+
+//the baked file needs to be rebuilt if it's missing, older than the .fnt or its image, from an older version,
+//or not the size its header says it is (e.g. cut short by a crash while it was being written)
+static bool baked_font_stale(const char * bmfont, const char * bakedPath) {
+    long long bakedTime = file_modified_time(bakedPath);
+    if (!bakedTime || file_modified_time(bmfont) > bakedTime) return true;
+
+    MappedFile file = map_entire_file(bakedPath);
+    BakedFont * baked = (BakedFont *) file.data;
+    bool stale = !baked || file.size < sizeof(BakedFont) ||
+                 baked->magic != BAKED_FONT_MAGIC || baked->version != BAKED_FONT_VERSION;
+    if (!stale) {
+        size_t kerningSize = baked->kerningPairs? KERNING_TABLE_SIZE : 0;
+        stale = file.size != sizeof(BakedFont) + kerningSize + (size_t) baked->width * baked->height * 4;
+    }
+    if (!stale) {
+        char * imagePath = font_image_path(bmfont, baked->page);
+        stale = file_modified_time(imagePath) > bakedTime;
+        free(imagePath);
+    }
+    unmap_file(file);
+    return stale;
+}
+
+static Font load_baked_font(const char * bmfont, Atlas * atlas) {
+    char * bakedPath = baked_font_path(bmfont);
+    if (baked_font_stale(bmfont, bakedPath)) {
+        print_log("rebuilding %s\n", bakedPath);
+        bake_font(bmfont);
+    }
+
+    Font font = {};
+    font.file = map_entire_file(bakedPath);
+    free(bakedPath); //not used past this point
+    assert(font.file.data);
+    BakedFont * baked = (BakedFont *) font.file.data;
+    size_t kerningSize = baked->kerningPairs? KERNING_TABLE_SIZE : 0;
+    assert(font.file.size == sizeof(BakedFont) + kerningSize + baked->width * baked->height * 4);
+
+    font.lineHeight = baked->lineHeight;
+    font.base = baked->base;
+    font.scaleW = baked->scaleW;
+    font.scaleH = baked->scaleH;
+    font.advances = baked->advances;
+    if (kerningSize) font.kerningPairs = (int8_t *) (baked + 1);
+    uint8_t * pixels = (uint8_t *) (baked + 1) + kerningSize;
+
+    //the chars get copied, since they're offset to wherever the image ends up in the atlas
+    font.chars = (Char *) malloc(sizeof(baked->chars));
+    memcpy(font.chars, baked->chars, sizeof(baked->chars));
+
+    //load image
+    if (atlas) {
+        AtlasImage image = add_atlas_image(*atlas, pixels, baked->width, baked->height);
+        for (int i = 0; i < 128; ++i) {
+            font.chars[i].x += image.x;
+            font.chars[i].y += image.y;
+        }
+        font.tex = image.tex;
+        font.inAtlas = true;
+    } else {
+        font.tex = create_texture(pixels, baked->width, baked->height);
+    }
+    assert(font.tex.handle);
+
     gl_error("FONT_LOAD");
 
     return font;
 }
 
+Font load_font(const char * bmfont) {
+    return load_baked_font(bmfont, nullptr);
+}
+
+Font load_font(const char * bmfont, Atlas & atlas) {
+    return load_baked_font(bmfont, &atlas);
+}
+
 void free_font(Font &font) {
     free(font.chars);
     font.chars = nullptr;
-    glDeleteTextures(1, &font.tex.handle);
+    if (!font.inAtlas) glDeleteTextures(1, &font.tex.handle);
     font.tex.handle = 0;
+    unmap_file(font.file);
+    font.advances = nullptr;
+    font.kerningPairs = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// OTHER STUFF                                                              ///
 ////////////////////////////////////////////////////////////////////////////////
 
+static ImmProgram make_program(const char * vertPath, const char * fragPath) {
+    ImmProgram program = {};
+    program.handle = create_program_from_files(vertPath, fragPath);
+    program.scaleLocation = glGetUniformLocation(program.handle, "scale");
+    program.transformLocation = glGetUniformLocation(program.handle, "transform");
+    program.depthLocation = glGetUniformLocation(program.handle, "depth");
+    program.pixelSizeLocation = glGetUniformLocation(program.handle, "pixelSize");
+    return program;
+}
+
+static ImmRing make_ring(int size) {
+    ImmRing ring = {};
+    ring.size = size;
+    ring.waited = -1;
+    glGenBuffers(1, &ring.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, ring.vbo);
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    return ring;
+}
+
+static void free_ring(ImmRing & ring) {
+    for (GLsync fence : ring.fences) glDeleteSync(fence);
+    glDeleteBuffers(1, &ring.vbo);
+    ring = {};
+}
+
 void Imm::init(int size) {
     *this = {}; //zero-initialize
-    program = create_program_from_files("res/imm.vert", "res/imm.frag");
+    program = make_program("res/imm.vert", "res/imm.frag");
+    quadProgram = make_program("res/immquad.vert", "res/imm.frag");
+    shapeProgram = make_program("res/immshape.vert", "res/immshape.frag");
 
     //allocate data
+    assert(size <= IMM_RING_VERTICES && size <= IMM_RING_QUADS && size <= IMM_RING_SHAPES);
     data = (Vertex *) malloc(sizeof(Vertex) * size);
+    quads = (ImmQuad *) malloc(sizeof(ImmQuad) * size);
+    shapes = (ImmShape *) malloc(sizeof(ImmShape) * size);
 
     //allocate VAO
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
 
     //allocate VBO
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    ring = make_ring(IMM_RING_VERTICES * sizeof(Vertex));
 
     //setup vertex attributes
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
@@ -163,9 +410,30 @@ void Imm::init(int size) {
     glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) (6 * 4));
     glEnableVertexAttribArray(3);
 
+    //the quad and shape attributes advance once per instance, and get pointed at each batch when it's drawn
+    glGenVertexArrays(1, &quadVao);
+    glBindVertexArray(quadVao);
+    quadRing = make_ring(IMM_RING_QUADS * sizeof(ImmQuad));
+    for (int i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+
+    glGenVertexArrays(1, &shapeVao);
+    glBindVertexArray(shapeVao);
+    shapeRing = make_ring(IMM_RING_SHAPES * sizeof(ImmShape));
+    for (int i = 0; i < 4; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
+    //start out on the first atlas page, so nothing drawn from the atlas has to switch textures
+    atlas = make_atlas();
+    tex = atlas.pages[0].tex;
+
     total = size;
     used = 0;
 
@@ -181,10 +449,19 @@ void Imm::init(int size) {
 }
 
 void Imm::finalize() {
-    glDeleteProgram(program);
+    glDeleteProgram(program.handle);
+    glDeleteProgram(quadProgram.handle);
+    glDeleteProgram(shapeProgram.handle);
     glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &quadVao);
+    glDeleteVertexArrays(1, &shapeVao);
+    free_ring(ring);
+    free_ring(quadRing);
+    free_ring(shapeRing);
+    free_atlas(atlas);
     free(data);
+    free(quads);
+    free(shapes);
 }
 
 void Imm::begin(int width, int height) {
@@ -203,6 +480,8 @@ void Imm::begin(int width, int height) {
     glDisable(GL_CULL_FACE);
 
     depth = 1.0f;
+    stateValid = false;
+    stats = {};
 }
 
 void Imm::incrementDepth() {
@@ -215,8 +494,7 @@ void Imm::incrementDepth() {
         depth = 1.0f;
     }
 
-    //use smallest safe depth increment for 16-bit linear depth buffer
-    depth -= powf(2, -14);
+    depth -= IMM_DEPTH_STEP;
 }
 
 void Imm::backgroundGradient(Color color1, Color color2, float direction) {
@@ -264,48 +542,211 @@ void Imm::debugStencilVis(Color c, uint8_t val) {
     end();
 }
 
-void Imm::flush() {
-    if (used == 0) {
-        return;
+//waits until the GPU is done with everything submitted before the fence was set
+static void wait_for_fence(GLsync & fence) {
+    if (!fence) return;
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+//NOTE: a segment that was skipped over can still have last lap's fence, which gets replaced rather than leaked
+static void fence_segment(ImmRing & ring, int segment) {
+    if (ring.fences[segment]) glDeleteSync(ring.fences[segment]);
+    ring.fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+//copies `bytes` of `src` into the next free part of the ring that's a multiple of `stride` into it,
+//and returns the offset it went to
+//NOTE: the ring's buffer has to be bound to GL_ARRAY_BUFFER
+static int write_to_ring(ImmRing & ring, void * src, int bytes, int stride) {
+    int segmentSize = ring.size / IMM_RING_SEGMENTS;
+
+    //every draw reading the segments the head has moved past was submitted by an earlier flush, so fence them off
+    for (; ring.segment < ring.head / segmentSize; ++ring.segment) {
+        fence_segment(ring, ring.segment);
     }
 
-    //bind texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex.handle);
+    //wrap around if the batch doesn't fit before the end,
+    //and make sure the GPU is done with any segments the batch is about to overwrite
+    int offset = (ring.head + stride - 1) / stride * stride;
+    if (offset + bytes > ring.size) {
+        if (ring.segment < IMM_RING_SEGMENTS) fence_segment(ring, ring.segment);
+        offset = 0;
+        ring.segment = 0;
+        ring.waited = -1;
+    }
+    int lastSegment = (offset + bytes - 1) / segmentSize;
+    for (; ring.waited < lastSegment; ++ring.waited) {
+        wait_for_fence(ring.fences[ring.waited + 1]);
+    }
 
-    glUseProgram(program);
-    GLint scaleLocation = glGetUniformLocation(program, "scale");
-    glUniform2f(scaleLocation, 1.0f / tex.width, 1.0f / tex.height);
+    void * dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    assert(dst);
+    memcpy(dst, src, bytes);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
 
-    //upload vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, used * sizeof(Vertex), data, GL_DYNAMIC_DRAW);
-    //BufferSubData is way slower than BufferData for some reason, at least with small batches
-    //I have no idea why - look into this! (maybe ask on StackOverflow)
-    // glBufferSubData(GL_ARRAY_BUFFER, 0, flat.used * sizeof(FlatVert), flat.data);
+    ring.head = offset + bytes;
+    return offset;
+}
 
-    glUseProgram(program);
-    glBindVertexArray(vao);
+void Imm::useProgram(ImmProgram & prog, float firstDepth) {
+    if (boundProgram != prog.handle) {
+        glUseProgram(prog.handle);
+        boundProgram = prog.handle;
+        stats.stateChanges += 1;
+    }
+    Vec2 scale = vec2(1.0f / tex.width, 1.0f / tex.height);
+    if (!prog.valid || memcmp(&scale, &prog.scale, sizeof(scale))) {
+        glUniform2f(prog.scaleLocation, scale.x, scale.y);
+        prog.scale = scale;
+        stats.stateChanges += 1;
+    }
+    if (!prog.valid || memcmp(&matrix, &prog.transform, sizeof(matrix))) {
+        glUniformMatrix4fv(prog.transformLocation, 1, GL_TRUE, (float *)(&matrix));
+        prog.transform = matrix;
+        stats.stateChanges += 1;
+    }
+    if (prog.depthLocation >= 0 && (!prog.valid || firstDepth != prog.depth)) {
+        glUniform1f(prog.depthLocation, firstDepth);
+        prog.depth = firstDepth;
+        stats.stateChanges += 1;
+    }
+    if (prog.pixelSizeLocation >= 0) {
+        //how big a pixel is before the transform, along whichever axis it's bigger on
+        float pixelSize = fmaxf(2.0f / (ww * sqrtf(matrix.m00 * matrix.m00 + matrix.m10 * matrix.m10)),
+                                2.0f / (wh * sqrtf(matrix.m01 * matrix.m01 + matrix.m11 * matrix.m11)));
+        if (!prog.valid || pixelSize != prog.pixelSize) {
+            glUniform1f(prog.pixelSizeLocation, pixelSize);
+            prog.pixelSize = pixelSize;
+            stats.stateChanges += 1;
+        }
+    }
+    prog.valid = true;
+}
 
-    GLint transformLocation = glGetUniformLocation(program, "transform");
-    glUniformMatrix4fv(transformLocation, 1, GL_TRUE, (float *)(&matrix));
+void Imm::bindBuffers(uint32_t vertexArray, uint32_t buffer) {
+    if (boundVao != vertexArray) {
+        glBindVertexArray(vertexArray);
+        boundVao = vertexArray;
+        stats.stateChanges += 1;
+    }
+    if (boundBuffer != buffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        boundBuffer = buffer;
+        stats.stateChanges += 1;
+    }
+}
+
+void Imm::flush() {
+    if (used == 0 && quadsUsed == 0 && shapesUsed == 0) {
+        return;
+    }
+    //only one kind of batch can be pending at a time, since starting one flushes the others
+    assert(!!used + !!quadsUsed + !!shapesUsed == 1);
+
+    //bring the bindings and uniforms up to date with whatever changed since the last flush
+    if (!stateValid) {
+        glActiveTexture(GL_TEXTURE0);
+        boundProgram = boundVao = boundBuffer = boundTexture = 0;
+        stats.stateChanges += 1;
+        stateValid = true;
+    }
+    if (boundTexture != tex.handle) {
+        glBindTexture(GL_TEXTURE_2D, tex.handle);
+        boundTexture = tex.handle;
+        stats.stateChanges += 1;
+    }
 
-    glDrawArrays(GL_TRIANGLES, 0, used);
+    int bytes;
+    if (used) {
+        useProgram(program, 0);
+        bindBuffers(vao, ring.vbo);
+        bytes = used * sizeof(Vertex);
+        int offset = write_to_ring(ring, data, bytes, sizeof(Vertex));
+        glDrawArrays(GL_TRIANGLES, offset / sizeof(Vertex), used);
+    } else if (quadsUsed) {
+        useProgram(quadProgram, quadDepth);
+        bindBuffers(quadVao, quadRing.vbo);
+        bytes = quadsUsed * sizeof(ImmQuad);
+        int offset = write_to_ring(quadRing, quads, bytes, sizeof(ImmQuad));
+
+        //GL 3.3 has no base instance, so the attributes get pointed at wherever the batch went instead
+        glVertexAttribPointer(0, 4, GL_SHORT, GL_FALSE, sizeof(ImmQuad), (void *) (uintptr_t) offset);
+        glVertexAttribPointer(1, 4, GL_SHORT, GL_FALSE, sizeof(ImmQuad), (void *) (uintptr_t) (offset + 8));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImmQuad), (void *) (uintptr_t) (offset + 16));
+        stats.stateChanges += 3;
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, quadsUsed);
+    } else {
+        useProgram(shapeProgram, 0);
+        bindBuffers(shapeVao, shapeRing.vbo);
+        bytes = shapesUsed * sizeof(ImmShape);
+        int offset = write_to_ring(shapeRing, shapes, bytes, sizeof(ImmShape));
+
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ImmShape), (void *) (uintptr_t) offset);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ImmShape), (void *) (uintptr_t) (offset + 16));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ImmShape), (void *) (uintptr_t) (offset + 32));
+        glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImmShape), (void *) (uintptr_t) (offset + 44));
+        stats.stateChanges += 4;
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, shapesUsed);
+    }
 
-    //unbind things (this isn't strictly necessary but I don't think it hurts any)
-    glBindVertexArray(0);
-    glUseProgram(0);
+    stats.flushes += 1;
+    stats.drawCalls += 1;
+    stats.bytesUploaded += bytes;
 
     //reset state
     used = 0;
+    quadsUsed = 0;
+    shapesUsed = 0;
 
     gl_error("imm flush");
 }
 
 void Imm::check(int newVerts) {
-    if (used + newVerts > total) {
+    if (used + newVerts > total || quadsUsed || shapesUsed) {
+        flush();
+    }
+}
+
+//NOTE: rounds to the nearest eighth of a pixel, clamping to what fits in a quad
+static int16_t to_eighths(float f) {
+    return (int16_t) lroundf(fmaxf(-32768, fminf(32767, f * 8)));
+}
+
+//adds a quad at the current depth, which must be the only thing drawn at it
+void Imm::quad(float x, float y, float w, float h, float u, float v, float uw, float vh, Color color) {
+    //the shader works out each quad's depth from where it is in the batch, so their depths have to be consecutive
+    if (used || shapesUsed || quadsUsed == total || depth != quadDepth - quadsUsed * IMM_DEPTH_STEP) {
         flush();
     }
+    if (quadsUsed == 0) {
+        quadDepth = depth;
+    }
+    quads[quadsUsed] = { to_eighths(x), to_eighths(y), to_eighths(w), to_eighths(h),
+                         (int16_t) u, (int16_t) v, (int16_t) uw, (int16_t) vh, color };
+    quadsUsed += 1;
+}
+
+//adds a shape at the current depth
+void Imm::shape(float x1, float y1, float x2, float y2, float radius, float inner, Color color) {
+    if (used || quadsUsed || shapesUsed == total) {
+        flush();
+    }
+    shapes[shapesUsed] = { x1, y1, x2, y2, x1, y1, x2, y2, radius, inner, depth, color };
+    shapesUsed += 1;
+}
+
+//adds a leg of a round line, which starts where the leg before it ends at (px, py) and ends where the leg after it
+//starts at (nx, ny), with those being the leg's own ends if it's the first or last one
+void Imm::lineLeg(float x1, float y1, float x2, float y2, float px, float py, float nx, float ny) {
+    shape(x1, y1, x2, y2, r, 0, lineColor);
+    ImmShape & leg = shapes[shapesUsed - 1];
+    leg.px = px;
+    leg.py = py;
+    leg.nx = nx;
+    leg.ny = ny;
 }
 
 void Imm::vertex(float x, float y, Color color) {
@@ -337,26 +778,17 @@ void Imm::drawTextCentered(const char * text, float x, float y, float s, Color c
 
 void Imm::drawText(const char * text, float x, float y, float s, Color color, int len) {
     useTexture(font.tex);
+    const int8_t * kerning = font.kerning? font.kerningPairs : nullptr;
     for (int i = 0; i < len; ++i) {
         incrementDepth();
 
         Char * ch = font.chars + text[i];
 
-        float x0 = x + ch->xoffset * s, y0 = y + ch->yoffset * s;
-        float x1 = x0 + ch->width * s, y1 = y0 + ch->height * s;
-        float u0 = ch->x, v0 = ch->y;
-        float u1 = u0 + ch->width, v1 = v0 + ch->height;
+        quad(x + ch->xoffset * s, y + ch->yoffset * s, ch->width * s, ch->height * s,
+             ch->x, ch->y, ch->width, ch->height, color);
 
-        check(6);
-
-        vertex(x0, y0, color, u0, v0);
-        vertex(x0, y1, color, u0, v1);
-        vertex(x1, y0, color, u1, v0);
-        vertex(x0, y1, color, u0, v1);
-        vertex(x1, y0, color, u1, v0);
-        vertex(x1, y1, color, u1, v1);
-
-        x += font.kernBias * s + ch->xadvance * s;
+        x += font.advances[(int) text[i]] * s;
+        if (kerning && i + 1 < len) x += kerning[text[i] * 128 + text[i + 1]] * s;
     }
 }
 
@@ -368,18 +800,15 @@ void Imm::useTexture(Texture texture) {
 }
 
 void Imm::drawImage(Texture texture, float x, float y) {
-    useTexture(texture);
-    float x0 = x, y0 = y, x1 = x + tex.width, y1 = y + tex.height;
-    float u0 = 0, v1 = 0, u1 = tex.width, v0 = tex.height;
-    Color color = { 255, 255, 255, 255 };
-    check(6);
+    drawImage({ texture, 0, 0, (uint16_t) texture.width, (uint16_t) texture.height }, x, y);
+}
+
+void Imm::drawImage(AtlasImage image, float x, float y) {
+    useTexture(image.tex);
     incrementDepth();
-    vertex(x0, y0, color, u0, v0);
-    vertex(x0, y1, color, u0, v1);
-    vertex(x1, y0, color, u1, v0);
-    vertex(x0, y1, color, u0, v1);
-    vertex(x1, y0, color, u1, v0);
-    vertex(x1, y1, color, u1, v1);
+    //NOTE: images are drawn with their rows flipped
+    quad(x, y, image.width, image.height, image.x, image.y + image.height, image.width, -image.height,
+         { 255, 255, 255, 255 });
 }
 
 //estimates the number of segments per octant needed to draw a circle
@@ -442,6 +871,8 @@ void Imm::arcJoin(float x, float y, float dx1, float dy1, float dx2, float dy2)
 
 void Imm::beginLine() {
     lineVertexCount = 0;
+    //every leg is drawn at the same depth, so round joins are just where the legs overlap
+    roundLine = join == ROUND && cap == ROUND && !tessellateCurves;
     incrementDepth();
 }
 
@@ -452,6 +883,31 @@ void Imm::lineVertex(float x, float y) {
         return;
     }
 
+    if (roundLine) {
+        //each leg needs to know about the legs on either side of it, so it's only added once the vertex after it
+        //comes in, except for the first one, which waits for `endLine()` in case the line gets closed
+        if (lineVertexCount == 0) {
+            fx = x;
+            fy = y;
+        } else if (lineVertexCount == 1) {
+            sx = x;
+            sy = y;
+        } else if (lineVertexCount == 2) {
+            hx = x;
+            hy = y;
+        } else {
+            lineLeg(px, py, lx, ly, qx, qy, x, y);
+        }
+        qx = px;
+        qy = py;
+        px = lx;
+        py = ly;
+        lx = x;
+        ly = y;
+        lineVertexCount += 1;
+        return;
+    }
+
     if (lineVertexCount == 0) {
         fx = x;
         fy = y;
@@ -546,6 +1002,20 @@ void Imm::endLine(bool close) {
         return;
     }
 
+    if (roundLine) {
+        if (lineVertexCount == 2) {
+            lineLeg(fx, fy, sx, sy, fx, fy, sx, sy);
+        } else if (close) {
+            lineLeg(px, py, lx, ly, qx, qy, fx, fy);
+            lineLeg(lx, ly, fx, fy, px, py, sx, sy);
+            lineLeg(fx, fy, sx, sy, lx, ly, hx, hy);
+        } else {
+            lineLeg(px, py, lx, ly, qx, qy, lx, ly);
+            lineLeg(fx, fy, sx, sy, fx, fy, hx, hy);
+        }
+        return;
+    }
+
     if (lineVertexCount < 3) {
         line(px, py, lx, ly, lineColor);
     }
@@ -602,6 +1072,11 @@ void Imm::endLine(bool close) {
 void Imm::line(float x1, float y1, float x2, float y2, Color stroke) {
     incrementDepth();
 
+    if (cap == ROUND && !tessellateCurves) {
+        shape(x1, y1, x2, y2, r, 0, stroke);
+        return;
+    }
+
     float dx = x2 - x1;
     float dy = y2 - y1;
     float d = sqrtf(dx * dx + dy * dy);
@@ -638,14 +1113,25 @@ void Imm::line(float x1, float y1, float x2, float y2, Color stroke) {
 }
 
 void Imm::rect(float x, float y, float w, float h, Color c) {
+    //rects are quads that only sample the atlas' white pixel, so they can go in the same batch as text and images
+    useTexture(atlas.white.tex);
     incrementDepth();
-
-    triangle(x, y, x + w, y, x + w, y + h, c);
-    triangle(x, y, x, y + h, x + w, y + h, c);
+    quad(x, y, w, h, atlas.white.x, atlas.white.y, 0, 0, c);
 }
 
-//TODO: optimize this!
 void Imm::circle(float x, float y, float radius, Color fill, Color stroke) {
+    if (!tessellateCurves) {
+        if (fill.a) {
+            incrementDepth();
+            shape(x, y, x, y, radius, 0, fill);
+        }
+        if (stroke.a) {
+            incrementDepth();
+            shape(x, y, x, y, radius + r, radius - r, stroke);
+        }
+        return;
+    }
+
     if (fill.a) {
         incrementDepth();
 
@@ -747,8 +1233,13 @@ float text_width(Font font, float scale, const char * text) {
 float text_width(Font font, float scale, const char * text, int len) {
     float width = 0;
     for (int i = 0; i < len; ++i) {
-        Char * ch = font.chars + text[i];
-        width += font.kernBias * scale + ch->xadvance * scale;
+        width += font.advances[(int) text[i]];
+    }
+    //kerning only ever applies between chars, so it's a separate pass that's skipped entirely when it's off
+    if (font.kerning && font.kerningPairs) {
+        for (int i = 0; i + 1 < len; ++i) {
+            width += font.kerningPairs[text[i] * 128 + text[i + 1]];
+        }
     }
-    return width;
+    return width * scale;
 }
@@ -3,9 +3,44 @@
 
 #include "color.hpp"
 #include "glutil.hpp"
+#include "list.hpp"
+#include "platform.hpp"
+#include "imstb_rectpack.h"
 
 ////////////////////////////////////////////////////////////////////////////////
-///
+/// ATLAS                                                                    ///
+////////////////////////////////////////////////////////////////////////////////
+
+//the font page and UI images all get packed into a few big textures, so that drawing any mix of them and solid
+//shapes doesn't need any texture switches, which would each flush the batch
+//NOTE: every image gets a 1 pixel border copied from its edges, so linear filtering never bleeds in its neighbors
+static const int ATLAS_PAGE_SIZE = 1024; //the biggest texture GL 3.3 guarantees
+
+//where an image ended up, in pixels of the page texture
+struct AtlasImage {
+	Texture tex;
+	uint16_t x, y, width, height;
+};
+
+struct AtlasPage {
+	Texture tex;
+	stbrp_context * packer; //followed by its nodes, the packer points into itself so it lives on the heap
+};
+
+struct Atlas {
+	List<AtlasPage> pages;
+	AtlasImage white; //a single white pixel, for drawing solid colors with shaders that always sample the texture
+};
+
+Atlas make_atlas();
+void free_atlas(Atlas & atlas);
+
+//copies RGBA `pixels` into whichever page has room for them, starting a new page if none does
+AtlasImage add_atlas_image(Atlas & atlas, uint8_t * pixels, int width, int height);
+AtlasImage load_atlas_image(Atlas & atlas, const char * imagePath);
+
+////////////////////////////////////////////////////////////////////////////////
+/// FONTS                                                                    ///
 ////////////////////////////////////////////////////////////////////////////////
 
 struct Char {
@@ -13,17 +48,30 @@ struct Char {
 	int16_t xoffset, yoffset, xadvance;
 };
 
+//fonts are loaded from a baked version of the .fnt file, with the image's pixels in it, which is memory-mapped
+//so that loading doesn't have to parse anything. the baked file sits next to the .fnt as `<bmfont>.bin`,
+//and gets rebuilt whenever it's missing, older than the .fnt or its image, or from an older version
 struct Font {
 	Char * chars;
+	const float * advances; //[128] how far the pen moves after each char, in font pixels
+	const int8_t * kerningPairs; //[first * 128 + second] added to the advance between two chars, null if none
+	bool kerning; //whether to apply `kerningPairs`, off by default
 	Texture tex;
 	//TODO: since Texture struct stores its own width/height, is scaleW/scaleH unnecessary?
 	uint16_t lineHeight, base, scaleW, scaleH;
-	float kernBias;
+	bool inAtlas; //`tex` is an atlas page, which belongs to the atlas
+	MappedFile file; //the baked font, which `advances` and `kerningPairs` point into
 };
 
 Font load_font(const char * bmfont);
+//packs the font's page into the atlas, so text can go in the same batch as anything else from the atlas
+Font load_font(const char * bmfont, Atlas & atlas);
 void free_font(Font &font);
 
+//rebuilds `<bmfont>.bin` from the .fnt file and its image
+//NOTE: this normally happens automatically whenever the baked file is out of date
+void bake_font(const char * bmfont);
+
 ////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////
@@ -46,22 +94,108 @@ struct Vertex {
 	float f;
 };
 
+//a textured quad, which the vertex shader expands into two triangles, so text, rects and images
+//upload one of these per quad instead of six vertices
+//NOTE: positions are in eighths of a pixel, so quads have to be within 4096 pixels of the origin
+struct ImmQuad {
+	int16_t x, y, width, height;
+	int16_t u, v, uw, vh; //in texels of the bound texture, a negative size flips the quad's texture
+	Color color;
+};
+
+//a segment with everything within `radius` of it filled in, or only what's further than `inner` from it for
+//`inner` > 0, which the vertex shader expands into the quad around it and the fragment shader antialiases, so that
+//circles, rings and round capped lines are one of these instead of hundreds of vertices
+//NOTE: circles are segments that start and end in the same place
+struct ImmShape {
+	float x1, y1, x2, y2;
+	//where the legs before and after this one start and end when it's a leg of a round line, or the segment's own
+	//ends if there isn't one, so that each pixel where they join only gets drawn by the leg closest to it
+	float px, py, nx, ny;
+	float radius, inner;
+	float depth;
+	Color color;
+};
+
+//smallest safe depth increment for a 16-bit linear depth buffer
+static const float IMM_DEPTH_STEP = 1.0f / (1 << 14);
+
+//batches are streamed into big vertex buffers that are used as rings, each through its own unsynchronized mapped
+//range, so uploading never stalls on the GPU still drawing from the buffer. each ring is split into segments that
+//each get a fence once the head moves past them, which is waited on before the segment gets overwritten a lap later
+static const int IMM_RING_VERTICES = 1 << 17;
+static const int IMM_RING_QUADS = 1 << 16;
+static const int IMM_RING_SHAPES = 1 << 15;
+static const int IMM_RING_SEGMENTS = 4;
+
+struct ImmRing {
+	uint32_t vbo;
+	int size; //in bytes
+	int head; //next byte to write to
+	int segment; //first segment written to since fences were last set
+	int waited; //last segment waited on this lap, the ones up to it are free to write to
+	GLsync fences[IMM_RING_SEGMENTS]; //set after the last draw that read each segment, null once waited on
+};
+
+//a shader program, with the uniforms it was last given so that flushing only sends the ones that changed
+//NOTE: uniforms are part of the program, so unlike the bindings these stay valid between frames
+struct ImmProgram {
+	uint32_t handle;
+	int scaleLocation, transformLocation, depthLocation, pixelSizeLocation;
+	bool valid;
+	Vec2 scale;
+	Mat4 transform;
+	float depth;
+	float pixelSize;
+};
+
+//what flushing has sent to GL since the last `Imm::begin()`
+struct ImmStats {
+	int flushes;
+	int drawCalls;
+	int stateChanges; //binds and uniform updates, only counting the ones that weren't redundant
+	size_t bytesUploaded;
+};
+
 struct Imm {
 	Vertex * data;
+	ImmQuad * quads;
+	ImmShape * shapes;
 
 	//vertex counts
 	int total;
 	int used;
 
+	//quads and shapes go in their own batches, so a batch is either all vertices, all quads or all shapes
+	//NOTE: the same `total` applies to quads and shapes
+	int quadsUsed;
+	float quadDepth; //depth of the batch's first quad, the shader gives each one after it the next depth
+	int shapesUsed;
+
 	//OpenGL IDs
-	uint32_t program;
+	ImmProgram program;
+	ImmProgram quadProgram;
+	ImmProgram shapeProgram;
 	uint32_t vao;
-	uint32_t vbo;
+	uint32_t quadVao;
+	uint32_t shapeVao;
 	Texture tex;
 
+	ImmRing ring;
+	ImmRing quadRing;
+	ImmRing shapeRing;
+
+	//GL bindings as of the last flush, so that flushing only binds what changed
+	//NOTE: other code can change the bindings between frames, so `begin()` throws these away
+	bool stateValid;
+	uint32_t boundProgram, boundVao, boundBuffer, boundTexture;
+
+	ImmStats stats;
+
 	Mat4 matrix;
 	int ww, wh;
 
+	Atlas atlas;
 	Font font;
 
 	float depth;
@@ -71,6 +205,9 @@ struct Imm {
 	uint8_t join;
 	Color lineColor;
 
+	//draw circles and round lines as triangles, like lines with other caps and joins, instead of as shapes
+	bool tessellateCurves;
+
 	void init(int size);
 	void finalize();
 
@@ -91,6 +228,7 @@ struct Imm {
 	void useTexture(Texture texture);
 
 	void drawImage(Texture texture, float x, float y);
+	void drawImage(AtlasImage image, float x, float y);
 
 	void arc(float x, float y, float dx1, float dy1, float dx2, float dy2);
 	void circle(float x, float y, float r, Color fill, Color stroke);
@@ -101,8 +239,11 @@ struct Imm {
 private:
 	//line drawing state
 	int lineVertexCount;
+	bool roundLine; //drawn as a shape per leg
 	float fx, fy; //first vertex
 	float sx, sy, sdx, sdy; //second vertex
+	float hx, hy; //third vertex, for round lines
+	float qx, qy; //vertex before the previous one, for round lines
 	float px, py, pdx, pdy; //previous vertex
 	float lx, ly; //last vertex
 
@@ -110,6 +251,11 @@ private:
 	int circleDetail(float radius, float delta);
 	void incrementDepth();
 	void check(int newVerts);
+	void quad(float x, float y, float w, float h, float u, float v, float uw, float vh, Color color);
+	void shape(float x1, float y1, float x2, float y2, float radius, float inner, Color color);
+	void lineLeg(float x1, float y1, float x2, float y2, float px, float py, float nx, float ny);
+	void useProgram(ImmProgram & prog, float firstDepth);
+	void bindBuffers(uint32_t vertexArray, uint32_t buffer);
 	void vertex(float x, float y, Color color);
 	void vertex(float x, float y, Color color, float u, float v);
 
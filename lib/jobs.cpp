@@ -0,0 +1,165 @@
+#include "jobs.hpp"
+#include "list.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct Job {
+    JobFunc func;
+    void * data;
+    int first, last;
+    JobCounter * counter;
+};
+
+//the owning thread pushes and pops at the back (so it works on the most recently split, cache-hot work first)
+//while other threads steal from the front (so they take the oldest, and usually biggest, pieces of work)
+//NOTE: the lock is almost never contended, so a plain mutex is plenty fast here
+struct JobQueue {
+    std::mutex mutex;
+    List<Job> jobs;
+    int front;
+
+    void push(Job job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.add(job);
+    }
+
+    bool pop_back(Job & job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (front == (int) jobs.len) return false;
+        job = jobs.data[--jobs.len];
+        if (front == (int) jobs.len) front = jobs.len = 0;
+        return true;
+    }
+
+    bool pop_front(Job & job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (front == (int) jobs.len) return false;
+        job = jobs[front++];
+        if (front == (int) jobs.len) front = jobs.len = 0;
+        return true;
+    }
+
+    //takes the most recently pushed job that counts towards `counter`, from wherever it is in the queue
+    bool pop_counter(Job & job, JobCounter * counter) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = (int) jobs.len - 1; i >= front; --i) {
+            if (jobs[i].counter == counter) {
+                job = jobs[i];
+                for (int j = i + 1; j < (int) jobs.len; ++j) jobs[j - 1] = jobs[j];
+                jobs.len -= 1;
+                if (front == (int) jobs.len) front = jobs.len = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+static const int MAX_JOB_THREADS = 64;
+
+struct JobSystem {
+    int threadCount;
+    std::atomic<int> threadLimit;
+    JobQueue queues[MAX_JOB_THREADS];
+    std::atomic<int> queuedJobs;
+
+    //idle workers sleep on this until there's work to steal
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+};
+
+//NOTE: intentionally never destroyed, since the worker threads are never joined (see pregen.cpp)
+static JobSystem & jobs = *new JobSystem();
+//the main thread and any other thread that isn't a worker (like the render and pregen threads) share queue 0
+static thread_local int jobThreadIndex;
+
+static bool try_get_job(int self, Job & job) {
+    if (jobs.queues[self].pop_back(job)) return true;
+    for (int i = 1; i < jobs.threadCount; ++i) {
+        if (jobs.queues[(self + i) % jobs.threadCount].pop_front(job)) return true;
+    }
+    return false;
+}
+
+static void run_job(Job & job) {
+    jobs.queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    job.func(job.data, job.first, job.last);
+    job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+static void worker_thread(int index) {
+    jobThreadIndex = index;
+    while (true) {
+        Job job;
+        if (index < jobs.threadLimit.load(std::memory_order_relaxed) && try_get_job(index, job)) {
+            run_job(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(jobs.sleepMutex);
+        jobs.wake.wait(lock, [index] {
+            return jobs.queuedJobs.load(std::memory_order_relaxed) > 0 && index < jobs.threadLimit.load();
+        });
+    }
+}
+
+void init_job_system(int threadCount) {
+    assert(jobs.threadCount == 0);
+    if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount > MAX_JOB_THREADS) threadCount = MAX_JOB_THREADS;
+    if (threadCount < 1) threadCount = 1;
+    jobs.threadCount = threadCount;
+    jobs.threadLimit = threadCount;
+    for (int i = 1; i < threadCount; ++i) {
+        std::thread(worker_thread, i).detach();
+    }
+}
+
+int job_thread_count() {
+    return jobs.threadCount? jobs.threadCount : 1;
+}
+
+void set_job_thread_limit(int threadCount) {
+    jobs.threadLimit = threadCount < 1? 1 : threadCount;
+    { std::lock_guard<std::mutex> lock(jobs.sleepMutex); }
+    jobs.wake.notify_all();
+}
+
+void run_jobs(JobCounter & counter, JobFunc func, void * data, int count, int batchSize) {
+    assert(batchSize > 0);
+    if (count <= 0) return;
+    if (count <= batchSize || jobs.threadLimit.load(std::memory_order_relaxed) <= 1) {
+        func(data, 0, count);
+        return;
+    }
+
+    int batches = (count + batchSize - 1) / batchSize;
+    counter.pending.fetch_add(batches, std::memory_order_relaxed);
+    jobs.queuedJobs.fetch_add(batches, std::memory_order_relaxed);
+    //NOTE: pushed in reverse so the owning thread (popping from the back) works through the range front to back
+    for (int b = batches - 1; b >= 0; --b) {
+        int first = b * batchSize, last = first + batchSize < count? first + batchSize : count;
+        jobs.queues[jobThreadIndex].push({ func, data, first, last, &counter });
+    }
+
+    //taking the lock (even briefly) before notifying means a worker can't miss the wakeup
+    //between checking `queuedJobs` and going to sleep
+    { std::lock_guard<std::mutex> lock(jobs.sleepMutex); }
+    jobs.wake.notify_all();
+}
+
+//only the counter's own jobs get run while waiting, so that e.g. the main thread waiting on a tick never ends up
+//rasterizing a frame for the render thread (which would stall the simulation behind rendering), or the reverse.
+//nested waits still work, since a job that waits on jobs it spawned runs those itself if nobody else has yet
+//NOTE: the counter's jobs are all in the waiting thread's own queue, unless they've been stolen already
+void wait_for_counter(JobCounter & counter) {
+    while (counter.pending.load(std::memory_order_acquire) > 0) {
+        Job job;
+        if (jobs.queues[jobThreadIndex].pop_counter(job, &counter)) {
+            run_job(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
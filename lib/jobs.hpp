@@ -0,0 +1,42 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <atomic>
+#include <type_traits>
+
+//a small work-stealing job system. each thread has its own queue of jobs, and threads that run out of work
+//steal from the other queues. a thread waiting on a counter runs that counter's jobs instead of blocking,
+//so waits can be nested (a job can itself spawn jobs and wait on them)
+
+typedef void (* JobFunc) (void * data, int first, int last);
+
+//counts jobs that have been submitted but not finished yet
+struct JobCounter {
+    std::atomic<int> pending;
+};
+
+//starts `threadCount - 1` worker threads, the calling thread counts as the first one.
+//0 means one thread per hardware thread. until this is called, all jobs run inline on the calling thread
+void init_job_system(int threadCount = 0);
+int job_thread_count();
+
+//limits how many of the threads (including the calling thread) will pick up jobs, for measuring scaling
+void set_job_thread_limit(int threadCount);
+
+//splits [0, count) into batches of at most `batchSize` and submits a job for each one, calling `func(data, first, last)`
+//NOTE: if there's only one batch's worth of work (or only one thread), it's just run inline before returning
+void run_jobs(JobCounter & counter, JobFunc func, void * data, int count, int batchSize);
+
+//runs the jobs submitted with `counter` that no other thread has taken yet, until all of them have finished
+void wait_for_counter(JobCounter & counter);
+
+//calls `func(first, last)` over [0, count) in batches of at most `batchSize`, in parallel, and waits for it to finish
+template <typename FUNC>
+static inline void parallel_for(int count, int batchSize, FUNC && func) {
+    typedef std::remove_reference_t<FUNC> Func;
+    JobCounter counter = {};
+    run_jobs(counter, [] (void * data, int first, int last) { (*(Func *) data)(first, last); }, &func, count, batchSize);
+    wait_for_counter(counter);
+}
+
+#endif // JOBS_HPP
@@ -1044,6 +1044,23 @@ static inline float rand_float(float min, float max) { return rand_float() * (ma
 static inline int rand_int(int max) { return rand_int() % max; }
 static inline int rand_int(int min, int max) { assert(max > min); return rand_int() % (max - min) + min; }
 
+//same generator as above, but with its own state, for code that needs to be deterministic
+//regardless of what else is using the global generator (or that might run on another thread)
+struct Rng {
+    int state;
+};
+
+static inline int rand_int(Rng & rng) {
+    rng.state = rng.state * 0xdb429a1d + 1;
+    return rng.state & 0x00FFFFFF;
+}
+
+static inline float rand_float(Rng & rng) { return rand_int(rng) * 5.9604644775390625e-8f; }
+static inline float rand_float(Rng & rng, float max) { return rand_float(rng) * max; }
+static inline float rand_float(Rng & rng, float min, float max) { return rand_float(rng) * (max - min) + min; }
+static inline int rand_int(Rng & rng, int max) { return rand_int(rng) % max; }
+static inline int rand_int(Rng & rng, int min, int max) { assert(max > min); return rand_int(rng) % (max - min) + min; }
+
 //TODO: make this not be biased toward corners
 static inline Vec3 rand_dir() {
     return noz(vec3(rand_float(), rand_float(), rand_float()) - vec3(0.5f));
@@ -1,46 +1,17 @@
 #include "pixel.hpp"
+#include "cpu.hpp"
+#include "stb_image_write.h"
+#include <stdio.h>
 
-//U and V are in pixel coordinates, not normalize [0,1] coordinates
-void draw_textured_triangle(Canvas & canvas, Image & tex,
-    int x1, int y1, int u1, int v1,
-    int x2, int y2, int u2, int v2,
-    int x3, int y3, int u3, int v3)
-{
-    int area = cross(coord2(x1, y1) - coord2(x2, y2), coord2(x3, y3) - coord2(x2, y2));
-    if (area == 0) return;
-
-    int minx = imax(0, imin(x1, imin(x2, x3)));
-    int miny = imax(0, imin(y1, imin(y2, y3)));
-    int maxx = imin(canvas.width - 1, imax(x1, imax(x2, x3)));
-    int maxy = imin(canvas.height - 1, imax(y1, imax(y2, y3)));
-    for (int y = miny; y <= maxy; ++y) {
-        for (int x = minx; x <= maxx; ++x) {
-            int w1 = cross(coord2(x, y) - coord2(x2, y2), coord2(x3, y3) - coord2(x2, y2));
-            int w2 = cross(coord2(x, y) - coord2(x3, y3), coord2(x1, y1) - coord2(x3, y3));
-            int w3 = cross(coord2(x, y) - coord2(x1, y1), coord2(x2, y2) - coord2(x1, y1));
-
-
-            if ((w1 >= 0 && w2 >= 0 && w3 >= 0) || (w1 <= 0 && w2 <= 0 && w3 <= 0)) {
-                int u = w1 * u1 + w2 * u2 + w3 * u3;
-                int v = w1 * v1 + w2 * v2 + w3 * v3;
-
-                u /= area;
-                v /= area;
-
-                //TODO: option to wrap texture using euclidean modulus?
-                if (u >= 0 && u < tex.width && v >= 0 && v < tex.height) {
-                    unsafe_blend(canvas, x, y, tex[v][u]);
-                }
-            }
-        }
-    }
-}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// LIGHTING                                                                                                         ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void add_light(Canvas & canvas, int x0, int y0, int w, int h, Color color) {
     int minx = imax(0, x0 - w);
-    int miny = imax(0, y0 - h);
-    int maxx = imin(canvas.width, x0 + w);
-    int maxy = imin(canvas.height, y0 + h);
+    int miny = imax(canvas.top, y0 - h);
+    int maxx = imin(canvas.width  - 1, x0 + w);
+    int maxy = imin(canvas.height - 1, y0 + h);
     if (maxx < minx || maxy < miny) return;
     float xfactor = 1.0f / w;
     float yfactor = 1.0f / h;
@@ -60,47 +31,1209 @@ void add_light(Canvas & canvas, int x0, int y0, int w, int h, Color color) {
     }
 }
 
-void _draw_sprite_a1(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy) {
+LightBuffer make_light_buffer(int canvasWidth, int canvasHeight) {
+    //NOTE: the zeroed table is already right for the zeroed color, which adds no light at all
+    LightBuffer lights = {};
+    lights.width = (canvasWidth + LIGHT_SCALE - 1) / LIGHT_SCALE;
+    lights.height = (canvasHeight + LIGHT_SCALE - 1) / LIGHT_SCALE;
+    lights.texels = (u16 *) calloc(lights.width * lights.height * 4, sizeof(u16));
+    return lights;
+}
+
+void free_light_buffer(LightBuffer & lights) {
+    free(lights.texels);
+    lights = {};
+}
+
+void clear_light_buffer(LightBuffer & lights) {
+    memset(lights.texels, 0, lights.width * lights.height * 4 * sizeof(u16));
+}
+
+//samples the falloff of `add_light(canvas, ...)` in the middle of each step of squared distance
+static void build_light_lut(LightBuffer & lights, Color color) {
+    for (int i = 0; i < LIGHT_LUT_SIZE; ++i) {
+        float dist = (i + 0.5f) / LIGHT_LUT_SIZE;
+        float factor = fminf(255, (1 / dist - 1) * 64);
+        u64 a = (color.a * (u8)factor) >> 8;
+        lights.lut[i] = color.r * a | color.g * a << 16 | color.b * a << 32;
+    }
+    lights.lut[LIGHT_LUT_SIZE] = 0;
+    lights.lutColor = color;
+}
+
+//texel `x` of the row is lit by the table entry for its squared distance `dx * dx + dy2` from the light's center
+static void light_span_scalar(u16 * row, int first, int last, float x0, float xfactor, float dy2, u64 * lut) {
+    for (int x = first; x <= last; ++x) {
+        float dx = ((float) (x * LIGHT_SCALE + LIGHT_SCALE / 2) - x0) * xfactor;
+        u64 light = lut[(int) fminf((dx * dx + dy2) * LIGHT_LUT_SIZE, LIGHT_LUT_SIZE)];
+        u16 * texel = row + x * 4;
+        texel[0] = imin(0xFFFF, texel[0] + (u16) light);
+        texel[1] = imin(0xFFFF, texel[1] + (u16) (light >> 16));
+        texel[2] = imin(0xFFFF, texel[2] + (u16) (light >> 32));
+    }
+}
+
+static inline __m128i light_lut_index_sse2(__m128 centers, __m128 x0, __m128 xfactor, __m128 dy2, __m128 size) {
+    __m128 dx = _mm_mul_ps(_mm_sub_ps(centers, x0), xfactor);
+    return _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(dx, dx), dy2), size), size));
+}
+
+static void light_span_sse2(u16 * row, int first, int last, float x0, float xfactor, float dy2, u64 * lut) {
+    __m128 center = _mm_set1_ps(x0), factor = _mm_set1_ps(xfactor), dy = _mm_set1_ps(dy2);
+    __m128 size = _mm_set1_ps(LIGHT_LUT_SIZE), step = _mm_set1_ps(4 * LIGHT_SCALE);
+    __m128 centers = _mm_add_ps(_mm_set1_ps(first * LIGHT_SCALE + LIGHT_SCALE / 2),
+                                _mm_setr_ps(0, LIGHT_SCALE, 2 * LIGHT_SCALE, 3 * LIGHT_SCALE));
+    int x = first;
+    for (; x + 3 <= last; x += 4) {
+        int i[4];
+        _mm_storeu_si128((__m128i *) i, light_lut_index_sse2(centers, center, factor, dy, size));
+        __m128i * texels = (__m128i *) (row + x * 4);
+        __m128i lo = _mm_set_epi64x(lut[i[1]], lut[i[0]]);
+        __m128i hi = _mm_set_epi64x(lut[i[3]], lut[i[2]]);
+        _mm_storeu_si128(texels, _mm_adds_epu16(_mm_loadu_si128(texels), lo));
+        _mm_storeu_si128(texels + 1, _mm_adds_epu16(_mm_loadu_si128(texels + 1), hi));
+        centers = _mm_add_ps(centers, step);
+    }
+    light_span_scalar(row, x, last, x0, xfactor, dy2, lut);
+}
+
+__attribute__((target("avx2")))
+static void light_span_avx2(u16 * row, int first, int last, float x0, float xfactor, float dy2, u64 * lut) {
+    __m128 center = _mm_set1_ps(x0), factor = _mm_set1_ps(xfactor), dy = _mm_set1_ps(dy2);
+    __m128 size = _mm_set1_ps(LIGHT_LUT_SIZE), step = _mm_set1_ps(4 * LIGHT_SCALE);
+    __m128 centers = _mm_add_ps(_mm_set1_ps(first * LIGHT_SCALE + LIGHT_SCALE / 2),
+                                _mm_setr_ps(0, LIGHT_SCALE, 2 * LIGHT_SCALE, 3 * LIGHT_SCALE));
+    int x = first;
+    for (; x + 3 <= last; x += 4) {
+        __m128i index = light_lut_index_sse2(centers, center, factor, dy, size);
+        __m256i light = _mm256_i32gather_epi64((const long long *) lut, index, 8);
+        __m256i * texels = (__m256i *) (row + x * 4);
+        _mm256_storeu_si256(texels, _mm256_adds_epu16(_mm256_loadu_si256(texels), light));
+        centers = _mm_add_ps(centers, step);
+    }
+    light_span_scalar(row, x, last, x0, xfactor, dy2, lut);
+}
+
+void add_light(LightBuffer & lights, float x0, float y0, float w, float h, Color color) {
+    if (!(color == lights.lutColor)) build_light_lut(lights, color);
+
+    void (* span) (u16 *, int, int, float, float, float, u64 *);
+    switch (simdLevel) {
+        case SIMD_AVX2: span = light_span_avx2; break;
+        case SIMD_SSE2: span = light_span_sse2; break;
+        default: span = light_span_scalar; break;
+    }
+
+    //texel (x, y) is lit by the light at its center, (x + 0.5, y + 0.5) * LIGHT_SCALE in canvas pixels
+    float half = LIGHT_SCALE * 0.5f;
+    int miny = imax(0, ceilf((y0 - h - half) / LIGHT_SCALE));
+    int maxy = imin(lights.height - 1, floorf((y0 + h - half) / LIGHT_SCALE));
+    float xfactor = 1.0f / w;
+    float yfactor = 1.0f / h;
+    for (int y = miny; y <= maxy; ++y) {
+        float dy = (y * LIGHT_SCALE + half - y0) * yfactor;
+        float dy2 = dy * dy;
+        if (dy2 >= 1) continue;
+
+        //the table is 0 past the edge, so the span only has to cover the light, it doesn't have to hug it
+        float extent = w * sqrtf(1 - dy2);
+        int first = imax(0, floorf((x0 - extent - half) / LIGHT_SCALE));
+        int last = imin(lights.width - 1, ceilf((x0 + extent - half) / LIGHT_SCALE));
+        if (first <= last) span(lights.texels + y * lights.width * 4, first, last, x0, xfactor, dy2, lights.lut);
+    }
+}
+
+//NOTE: at half resolution, every canvas pixel's center is a quarter of a texel away from the nearest texel's center,
+//      so on each axis the bilinear weights are always 3/4 for the nearest texel and 1/4 for the next one over
+static_assert(LIGHT_SCALE == 2, "composite_lights() only handles a light buffer at half resolution");
+static const u32 NEAR_WEIGHT = 0xC000; //3/4 in 0.16 fixed point
+static const u32 FAR_WEIGHT = 0x4000; //1/4 in 0.16 fixed point
+
+static inline u16 mix_texels(u16 nearest, u16 next) {
+    return (nearest * NEAR_WEIGHT >> 16) + (next * FAR_WEIGHT >> 16);
+}
+
+//blends a row of texels vertically into `dst`, which gets a copy of the first and last texel on either side
+static void mix_rows_scalar(u16 * dst, u16 * nearRow, u16 * farRow, int width) {
+    for (int i = 0; i < width * 4; ++i) {
+        dst[i + 4] = mix_texels(nearRow[i], farRow[i]);
+    }
+    memcpy(dst, dst + 4, 4 * sizeof(u16));
+    memcpy(dst + (width + 1) * 4, dst + width * 4, 4 * sizeof(u16));
+}
+
+static void mix_rows_sse2(u16 * dst, u16 * nearRow, u16 * farRow, int width) {
+    __m128i nearWeight = _mm_set1_epi16((short) NEAR_WEIGHT), farWeight = _mm_set1_epi16((short) FAR_WEIGHT);
+    int i = 0;
+    for (; i + 8 <= width * 4; i += 8) {
+        __m128i n = _mm_mulhi_epu16(_mm_loadu_si128((__m128i *) (nearRow + i)), nearWeight);
+        __m128i f = _mm_mulhi_epu16(_mm_loadu_si128((__m128i *) (farRow + i)), farWeight);
+        _mm_storeu_si128((__m128i *) (dst + i + 4), _mm_add_epi16(n, f));
+    }
+    for (; i < width * 4; ++i) {
+        dst[i + 4] = mix_texels(nearRow[i], farRow[i]);
+    }
+    memcpy(dst, dst + 4, 4 * sizeof(u16));
+    memcpy(dst + (width + 1) * 4, dst + width * 4, 4 * sizeof(u16));
+}
+
+//the two canvas pixels between texel `i` and `i + 1` of a row from `mix_rows()`, the first one is 3/4 of texel `i`
+static inline void upsample_pair_scalar(Pixel * dst, u16 * row, int i) {
+    u16 * a = row + i * 4, * b = a + 4;
+    dst[0] = { (u8) (mix_texels(a[0], b[0]) >> 8), (u8) (mix_texels(a[1], b[1]) >> 8),
+               (u8) (mix_texels(a[2], b[2]) >> 8), 0 };
+    dst[1] = { (u8) (mix_texels(b[0], a[0]) >> 8), (u8) (mix_texels(b[1], a[1]) >> 8),
+               (u8) (mix_texels(b[2], a[2]) >> 8), 0 };
+}
+
+//`upsample_pair_scalar()` for texels `i` to `i + 2`, which is four canvas pixels
+static inline __m128i upsample_quad_sse2(u16 * row, int i) {
+    __m128i nearWeight = _mm_set1_epi16((short) NEAR_WEIGHT), farWeight = _mm_set1_epi16((short) FAR_WEIGHT);
+    __m128i a = _mm_loadu_si128((__m128i *) (row + i * 4));
+    __m128i b = _mm_loadu_si128((__m128i *) (row + i * 4 + 4));
+    //swapping the two texels in each register turns the first pixel's weights into the second one's
+    __m128i pa = _mm_add_epi16(_mm_mulhi_epu16(a, nearWeight),
+                               _mm_mulhi_epu16(_mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)), farWeight));
+    __m128i pb = _mm_add_epi16(_mm_mulhi_epu16(b, nearWeight),
+                               _mm_mulhi_epu16(_mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)), farWeight));
+    return _mm_packus_epi16(_mm_srli_epi16(pa, 8), _mm_srli_epi16(pb, 8));
+}
+
+void composite_lights(Canvas & canvas, LightBuffer & lights) {
+    assert(lights.width * LIGHT_SCALE >= canvas.width && lights.height * LIGHT_SCALE >= canvas.height);
+    bool sse2 = simdLevel >= SIMD_SSE2;
+
+    //`row` is one row of texels plus a copy of the edge texels on either side, `light` holds pixels [-1, width]
+    u16 * row = (u16 *) malloc((lights.width + 2) * 4 * sizeof(u16));
+    Pixel * light = (Pixel *) malloc((lights.width + 1) * 2 * sizeof(Pixel));
+    for (int y = canvas.top; y < canvas.height; ++y) {
+        //the nearest row of texels is above the pixel's center for odd rows, and below it for even ones
+        int nearest = y / LIGHT_SCALE;
+        int next = imax(0, imin(lights.height - 1, y % LIGHT_SCALE? nearest + 1 : nearest - 1));
+        u16 * nearRow = lights.texels + nearest * lights.width * 4;
+        u16 * farRow = lights.texels + next * lights.width * 4;
+
+        Pixel * dst = canvas[y];
+        int i = 0, x = 0;
+        if (sse2) {
+            mix_rows_sse2(row, nearRow, farRow, lights.width);
+            for (; i < lights.width; i += 2) {
+                _mm_storeu_si128((__m128i *) (light + i * 2), upsample_quad_sse2(row, i));
+            }
+            for (; i <= lights.width; ++i) upsample_pair_scalar(light + i * 2, row, i);
+            for (; x + 4 <= canvas.width; x += 4) {
+                __m128i d = _mm_loadu_si128((__m128i *) (dst + x));
+                __m128i l = _mm_loadu_si128((__m128i *) (light + x + 1));
+                _mm_storeu_si128((__m128i *) (dst + x), _mm_adds_epu8(d, l));
+            }
+        } else {
+            mix_rows_scalar(row, nearRow, farRow, lights.width);
+            for (; i <= lights.width; ++i) upsample_pair_scalar(light + i * 2, row, i);
+        }
+        for (; x < canvas.width; ++x) {
+            dst[x].r = imin(255, dst[x].r + light[x + 1].r);
+            dst[x].g = imin(255, dst[x].g + light[x + 1].g);
+            dst[x].b = imin(255, dst[x].b + light[x + 1].b);
+        }
+    }
+    free(row);
+    free(light);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// TRIANGLES                                                                                                        ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//NOTE: pixels are sampled at their integer coordinates, and a pixel exactly on an edge is only drawn if it's a top or
+//      left edge (the same fill rule GPUs use), so two triangles that share an edge never both draw the pixels on it.
+//      degenerate triangles draw nothing
+
+static const int TRIANGLE_BLOCK = 8;
+static const int SMALL_TRIANGLE_AREA = 32 * 32; //textured triangles with bounding boxes up to this big are drawn by row
+
+//a triangle set up for rasterizing with edge functions
+struct Triangle {
+    int minx, miny, maxx, maxy; //bounding box, clipped to the canvas, inclusive
+    int a[3], b[3], c[3]; //edge function `i` is `a * x + b * y + c`, it's opposite vertex `i` and >= 0 inside
+    int bias[3]; //how much has been taken off `c` for the fill rule, 1 for edges that aren't top or left edges
+    int area; //twice the area of the triangle, the sum of the unbiased edge functions at every point
+};
+
+static bool setup_triangle(Canvas & canvas, int x[3], int y[3], Triangle & t) {
+    t.area = (x[2] - x[1]) * (y[0] - y[1]) - (y[2] - y[1]) * (x[0] - x[1]);
+    if (t.area == 0) return false;
+    int sign = t.area > 0? 1 : -1;
+    t.area *= sign;
+
+    t.minx = imax(0, imin(x[0], imin(x[1], x[2])));
+    t.miny = imax(canvas.top, imin(y[0], imin(y[1], y[2])));
+    t.maxx = imin(canvas.width  - 1, imax(x[0], imax(x[1], x[2])));
+    t.maxy = imin(canvas.height - 1, imax(y[0], imax(y[1], y[2])));
+    if (t.minx > t.maxx || t.miny > t.maxy) return false;
+
+    for (int i = 0; i < 3; ++i) {
+        int j = (i + 1) % 3, k = (i + 2) % 3;
+        t.a[i] = (y[j] - y[k]) * sign;
+        t.b[i] = (x[k] - x[j]) * sign;
+        //with +y pointing down, the inside is to the right of a left edge and below a top edge
+        bool topLeft = t.a[i] > 0 || (t.a[i] == 0 && t.b[i] > 0);
+        t.bias[i] = topLeft? 0 : 1;
+        t.c[i] = -(t.a[i] * x[j] + t.b[i] * y[j]) - t.bias[i];
+    }
+    return true;
+}
+
+//calls `block(bx, by, width, height, e, inside)` for every block of the bounding box that overlaps the triangle,
+//with the edge functions evaluated at its top left pixel, and `inside` set if the whole block is inside
+//NOTE: the edge functions are linear, so their extremes over a block are at its corners
+template <typename BLOCK>
+static inline void rasterize_triangle(Triangle & t, BLOCK block) {
+    int rowEdge[3];
+    for (int i = 0; i < 3; ++i) rowEdge[i] = t.a[i] * t.minx + t.b[i] * t.miny + t.c[i];
+    for (int by = t.miny; by <= t.maxy; by += TRIANGLE_BLOCK) {
+        int height = imin(TRIANGLE_BLOCK, t.maxy - by + 1);
+        int e[3] = { rowEdge[0], rowEdge[1], rowEdge[2] };
+        for (int bx = t.minx; bx <= t.maxx; bx += TRIANGLE_BLOCK) {
+            int width = imin(TRIANGLE_BLOCK, t.maxx - bx + 1);
+            bool outside = false, inside = true;
+            for (int i = 0; i < 3; ++i) {
+                int dx = t.a[i] * (width - 1), dy = t.b[i] * (height - 1);
+                outside |= e[i] + imax(0, dx) + imax(0, dy) < 0;
+                inside &= e[i] + imin(0, dx) + imin(0, dy) >= 0;
+            }
+            if (!outside) block(bx, by, width, height, e, inside);
+            for (int i = 0; i < 3; ++i) e[i] += t.a[i] * TRIANGLE_BLOCK;
+        }
+        for (int i = 0; i < 3; ++i) rowEdge[i] += t.b[i] * TRIANGLE_BLOCK;
+    }
+}
+
+void draw_triangle(Canvas & canvas, int x1, int y1, int x2, int y2, int x3, int y3, Color color) {
+    int x[3] = { x1, x2, x3 }, y[3] = { y1, y2, y3 };
+    Triangle t = {};
+    if (!setup_triangle(canvas, x, y, t)) return;
+
+    bool sse2 = simdLevel >= SIMD_SSE2;
+    rasterize_triangle(t, [&] (int bx, int by, int width, int height, int * e, bool inside) {
+        for (int y = 0; y < height; ++y) {
+            Pixel * dst = &canvas[by + y][bx];
+            int e0 = e[0] + t.b[0] * y, e1 = e[1] + t.b[1] * y, e2 = e[2] + t.b[2] * y;
+            if (inside) {
+                for (int x = 0; x < width; ++x) dst[x] = color;
+            } else if (sse2 && width == TRIANGLE_BLOCK) {
+                //a pixel is inside if none of its edge functions has the sign bit set
+                int a0 = t.a[0], a1 = t.a[1], a2 = t.a[2];
+                __m128i w0 = _mm_setr_epi32(e0, e0 + a0, e0 + a0 * 2, e0 + a0 * 3);
+                __m128i w1 = _mm_setr_epi32(e1, e1 + a1, e1 + a1 * 2, e1 + a1 * 3);
+                __m128i w2 = _mm_setr_epi32(e2, e2 + a2, e2 + a2 * 2, e2 + a2 * 3);
+                __m128i c = _mm_set1_epi32(*(int *) &color);
+                for (int x = 0; x < TRIANGLE_BLOCK; x += 4) {
+                    __m128i outside = _mm_srai_epi32(_mm_or_si128(w0, _mm_or_si128(w1, w2)), 31);
+                    __m128i d = _mm_loadu_si128((__m128i *) (dst + x));
+                    d = _mm_or_si128(_mm_and_si128(outside, d), _mm_andnot_si128(outside, c));
+                    _mm_storeu_si128((__m128i *) (dst + x), d);
+                    w0 = _mm_add_epi32(w0, _mm_set1_epi32(a0 * 4));
+                    w1 = _mm_add_epi32(w1, _mm_set1_epi32(a1 * 4));
+                    w2 = _mm_add_epi32(w2, _mm_set1_epi32(a2 * 4));
+                }
+            } else {
+                for (int x = 0; x < width; ++x) {
+                    if ((e0 | e1 | e2) >= 0) dst[x] = color;
+                    e0 += t.a[0], e1 += t.a[1], e2 += t.a[2];
+                }
+            }
+        }
+    });
+}
+
+//`n / d` for d > 0, as the floor of the quotient and a remainder in [0, d), so that it can be stepped along exactly
+//with just adds and a compare instead of a division per pixel
+struct Quotient {
+    int q, r;
+};
+
+static inline Quotient make_quotient(i64 n, int d) {
+    i64 q = n / d, r = n % d;
+    if (r < 0) q -= 1, r += d;
+    return { (int) q, (int) r };
+}
+
+static inline void step_quotient(Quotient & value, Quotient step, int d) {
+    //NOTE: whether it carries is different at almost every pixel, so this has to be branchless
+    value.r += step.r - d;
+    int borrow = value.r >> 31;
+    value.q += step.q + 1 + borrow;
+    value.r += d & borrow;
+}
+
+//U and V are in pixel coordinates, not normalize [0,1] coordinates
+void draw_textured_triangle(Canvas & canvas, Image & tex,
+    int x1, int y1, int u1, int v1,
+    int x2, int y2, int u2, int v2,
+    int x3, int y3, int u3, int v3)
+{
+    int x[3] = { x1, x2, x3 }, y[3] = { y1, y2, y3 }, u[3] = { u1, u2, u3 }, v[3] = { v1, v2, v3 };
+    Triangle t = {};
+    if (!setup_triangle(canvas, x, y, t)) return;
+
+    //the texture coords are the vertices' coords weighted by the (unbiased) edge functions opposite them, over the area,
+    //so their numerators are linear in x and y too
+    i64 u0 = 0, v0 = 0, udx = 0, vdx = 0, udy = 0, vdy = 0;
+    for (int i = 0; i < 3; ++i) {
+        u0 += (i64) (t.c[i] + t.bias[i]) * u[i], v0 += (i64) (t.c[i] + t.bias[i]) * v[i];
+        udx += (i64) t.a[i] * u[i], vdx += (i64) t.a[i] * v[i];
+        udy += (i64) t.b[i] * u[i], vdy += (i64) t.b[i] * v[i];
+    }
+    Quotient ustepx = make_quotient(udx, t.area), vstepx = make_quotient(vdx, t.area);
+    Quotient ustepy = make_quotient(udy, t.area), vstepy = make_quotient(vdy, t.area);
+
+    //NOTE: copied out of the structs so the compiler doesn't have to reload them after every store to the canvas
+    int a0 = t.a[0], a1 = t.a[1], a2 = t.a[2], area = t.area;
+    Pixel * texels = tex.pixels;
+    int texWidth = tex.width, texHeight = tex.height;
+    auto blend = [&] (Pixel & dst, Quotient uq, Quotient vq) {
+        //TODO: option to wrap texture using euclidean modulus?
+        if ((unsigned) uq.q < (unsigned) texWidth && (unsigned) vq.q < (unsigned) texHeight) {
+            Color c = texels[vq.q * texWidth + uq.q];
+            dst.r = (c.r * c.a + dst.r * (255 - c.a)) >> 8;
+            dst.g = (c.g * c.a + dst.g * (255 - c.a)) >> 8;
+            dst.b = (c.b * c.a + dst.b * (255 - c.a)) >> 8;
+        }
+    };
+
+    //NOTE: a small triangle only covers a few blocks, so the block tests skip little, while every block still pays two
+    //      64-bit divisions and steps the texture coords across all of its outside pixels. so it's drawn row by row
+    //      instead: a row's pixels inside the triangle are contiguous, so the edge functions alone find where they
+    //      start, and the texture coords are only set up and stepped from there
+    if ((t.maxx - t.minx + 1) * (t.maxy - t.miny + 1) <= SMALL_TRIANGLE_AREA) {
+        int rowEdge[3];
+        for (int i = 0; i < 3; ++i) rowEdge[i] = t.a[i] * t.minx + t.b[i] * t.miny + t.c[i];
+        for (int y = t.miny; y <= t.maxy; ++y) {
+            int x = t.minx, e0 = rowEdge[0], e1 = rowEdge[1], e2 = rowEdge[2];
+            for (; x <= t.maxx && (e0 | e1 | e2) < 0; ++x) e0 += a0, e1 += a1, e2 += a2;
+            if (x <= t.maxx) {
+                Pixel * dst = canvas[y];
+                Quotient uq = make_quotient(u0 + udx * x + udy * y, area);
+                Quotient vq = make_quotient(v0 + vdx * x + vdy * y, area);
+                for (; x <= t.maxx && (e0 | e1 | e2) >= 0; ++x) {
+                    blend(dst[x], uq, vq);
+                    e0 += a0, e1 += a1, e2 += a2;
+                    step_quotient(uq, ustepx, area);
+                    step_quotient(vq, vstepx, area);
+                }
+            }
+            for (int i = 0; i < 3; ++i) rowEdge[i] += t.b[i];
+        }
+        return;
+    }
+
+    rasterize_triangle(t, [&] (int bx, int by, int width, int height, int * e, bool inside) {
+        Quotient urow = make_quotient(u0 + udx * bx + udy * by, area);
+        Quotient vrow = make_quotient(v0 + vdx * bx + vdy * by, area);
+        for (int y = 0; y < height; ++y) {
+            Pixel * dst = &canvas[by + y][bx];
+            int e0 = e[0] + t.b[0] * y, e1 = e[1] + t.b[1] * y, e2 = e[2] + t.b[2] * y;
+            Quotient uq = urow, vq = vrow;
+            for (int x = 0; x < width; ++x) {
+                if (inside || (e0 | e1 | e2) >= 0) blend(dst[x], uq, vq);
+                e0 += a0, e1 += a1, e2 += a2;
+                step_quotient(uq, ustepx, area);
+                step_quotient(vq, vstepx, area);
+            }
+            step_quotient(urow, ustepy, area);
+            step_quotient(vrow, vstepy, area);
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// SPRITE BLITTING                                                                                                  ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//NOTE: the vector kernels must produce exactly the same bytes as the scalar kernel (which matches `unsafe_blend()`),
+//      so they do the same integer math in 16-bit lanes, and only ever touch pixels the scalar kernel would touch
+
+enum BlitMode {
+    BLIT_BLEND,
+    BLIT_FADE, //blend with the sprite's alpha scaled by a constant
+    BLIT_SILHOUETTE, //blend a constant color where the sprite's alpha is > 127
+    BLIT_A1, //copy the sprite's pixel where its alpha is > 127
+};
+
+//a sprite blit that has already been clipped to the canvas
+struct Blit {
+    Pixel * dst;
+    int dstPitch;
+    Pixel * src; //the sprite pixel that lands on `dst`
+    int srcPitch;
+    int srcStep; //1, or -1 if the sprite is mirrored
+    int width, height;
+    Color fill; //only used by BLIT_SILHOUETTE
+    float alpha; //only used by BLIT_FADE
+};
+
+static bool clip_blit(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy,
+                      bool flip, Blit & blit)
+{
     //destination coords
     int minx = imax(0, cx);
-    int miny = imax(0, cy);
+    int miny = imax(canvas.top, cy);
     int maxx = imin(canvas.width, cx + width);
     int maxy = imin(canvas.height, cy + height);
+    if (minx >= maxx || miny >= maxy) return false;
 
     //source coords
     int srcx = minx - cx;
     int srcy = miny - cy;
-    int srcw = maxx - minx;
-    int srch = maxy - miny;
-
-    #ifdef SSE_BLIT
-        const __m128i iSrcw = _mm_set1_epi32(srcw);
-        const __m128i i3210 = _mm_set_epi32(3, 2, 1, 0);
-        const __m128i zero = (__m128i) _mm_set1_epi32(0);
-
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; x += 4) {
-                __m128i ix = _mm_add_epi32(i3210, _mm_set1_epi32(x));
-                __m128i inclusionMask = _mm_cmplt_epi32(ix, iSrcw);
-
-                Pixel * canvSrc = &canvas[miny + y][minx + x];
-                __m128i src = _mm_loadu_si128((__m128i *) canvSrc);
-                Pixel * imgSrc = &pixels[(srcy + y) * pitch + srcx + x];
-                __m128i img = _mm_loadu_si128((__m128i *) imgSrc);
-
-                __m128i alphaMask = _mm_and_si128(_mm_cmplt_epi32(img, zero), inclusionMask);
-                __m128i c = _mm_blendv_epi8(src, img, alphaMask); //@SSE4.1
-                _mm_storeu_si128((__m128i *) canvSrc, c);
+
+    blit.dst = &canvas[miny][minx];
+    blit.dstPitch = canvas.pitch;
+    //NOTE: a mirrored sprite is mirrored about its own center, not the center of the part that survived clipping
+    blit.src = pixels + srcy * pitch + (flip? width - 1 - srcx : srcx);
+    blit.srcPitch = pitch;
+    blit.srcStep = flip? -1 : 1;
+    blit.width = maxx - minx;
+    blit.height = maxy - miny;
+    return true;
+}
+
+template <BlitMode MODE>
+static inline void blit_span_scalar(Blit & blit, Pixel * dst, Pixel * src, int count) {
+    for (int x = 0; x < count; ++x) {
+        Color c = src[x * blit.srcStep];
+        Pixel & d = dst[x];
+        if (MODE == BLIT_A1) {
+            if (c.a > 127) d = c;
+            continue;
+        } else if (MODE == BLIT_SILHOUETTE) {
+            if (c.a <= 127) continue;
+            c = blit.fill;
+        } else if (MODE == BLIT_FADE) {
+            c.a *= blit.alpha;
+        }
+        d.r = (c.r * c.a + d.r * (255 - c.a)) >> 8;
+        d.g = (c.g * c.a + d.g * (255 - c.a)) >> 8;
+        d.b = (c.b * c.a + d.b * (255 - c.a)) >> 8;
+    }
+}
+
+template <BlitMode MODE>
+static void blit_scalar(Blit & blit) {
+    for (int y = 0; y < blit.height; ++y) {
+        blit_span_scalar<MODE>(blit, blit.dst + y * blit.dstPitch, blit.src + y * blit.srcPitch, blit.width);
+    }
+}
+
+//blends 4 pixels of `src` over `dst`, where the low byte of each 32-bit lane of `a` is that pixel's alpha
+static inline __m128i blend_sse2(__m128i dst, __m128i src, __m128i a) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i i255 = _mm_set1_epi16(255);
+    const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+
+    //spread each pixel's alpha to all four of its 16-bit lanes
+    __m128i aa = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+    __m128i alo = _mm_unpacklo_epi32(aa, aa), ahi = _mm_unpackhi_epi32(aa, aa);
+
+    //c * a + d * (255 - a) is at most 255 * 255, so it fits in an unsigned 16-bit lane
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(src, zero), alo),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_sub_epi16(i255, alo)));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(src, zero), ahi),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_sub_epi16(i255, ahi)));
+    __m128i c = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+
+    //keep the destination's alpha, like `unsafe_blend()` does
+    return _mm_or_si128(_mm_and_si128(rgb, c), _mm_andnot_si128(rgb, dst));
+}
+
+template <BlitMode MODE>
+static inline __m128i blit_sse2(Blit & blit, __m128i dst, __m128i src) {
+    if (MODE == BLIT_BLEND) {
+        return blend_sse2(dst, src, _mm_srli_epi32(src, 24));
+    } else if (MODE == BLIT_FADE) {
+        __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(src, 24)), _mm_set1_ps(blit.alpha));
+        return blend_sse2(dst, src, _mm_cvttps_epi32(a));
+    } else {
+        //the alpha byte is the top byte, so alpha > 127 exactly when the pixel is negative as a signed int
+        __m128i mask = _mm_cmplt_epi32(src, _mm_setzero_si128());
+        if (MODE == BLIT_SILHOUETTE) {
+            int fill;
+            memcpy(&fill, &blit.fill, sizeof(fill));
+            src = blend_sse2(dst, _mm_set1_epi32(fill), _mm_set1_epi32(blit.fill.a));
+        }
+        return _mm_or_si128(_mm_and_si128(mask, src), _mm_andnot_si128(mask, dst));
+    }
+}
+
+template <BlitMode MODE>
+static void blit_sse2(Blit & blit) {
+    for (int y = 0; y < blit.height; ++y) {
+        Pixel * dst = blit.dst + y * blit.dstPitch;
+        Pixel * src = blit.src + y * blit.srcPitch;
+        int x = 0;
+        for (; x + 4 <= blit.width; x += 4) {
+            __m128i s = blit.srcStep > 0? _mm_loadu_si128((__m128i *) (src + x))
+                : _mm_shuffle_epi32(_mm_loadu_si128((__m128i *) (src - x - 3)), _MM_SHUFFLE(0, 1, 2, 3));
+            __m128i d = _mm_loadu_si128((__m128i *) (dst + x));
+            _mm_storeu_si128((__m128i *) (dst + x), blit_sse2<MODE>(blit, d, s));
+        }
+        blit_span_scalar<MODE>(blit, dst + x, src + x * blit.srcStep, blit.width - x);
+    }
+}
+
+//NOTE: the 256-bit unpacks and packs work within each 128-bit half, so this is just two copies of the SSE2 version
+__attribute__((target("avx2")))
+static inline __m256i blend_avx2(__m256i dst, __m256i src, __m256i a) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i i255 = _mm256_set1_epi16(255);
+    const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+
+    __m256i aa = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+    __m256i alo = _mm256_unpacklo_epi32(aa, aa), ahi = _mm256_unpackhi_epi32(aa, aa);
+
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(src, zero), alo),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), _mm256_sub_epi16(i255, alo)));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(src, zero), ahi),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), _mm256_sub_epi16(i255, ahi)));
+    __m256i c = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+
+    return _mm256_blendv_epi8(dst, c, rgb);
+}
+
+template <BlitMode MODE>
+__attribute__((target("avx2")))
+static inline __m256i blit_avx2(Blit & blit, __m256i dst, __m256i src) {
+    if (MODE == BLIT_BLEND) {
+        return blend_avx2(dst, src, _mm256_srli_epi32(src, 24));
+    } else if (MODE == BLIT_FADE) {
+        __m256 a = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(src, 24)), _mm256_set1_ps(blit.alpha));
+        return blend_avx2(dst, src, _mm256_cvttps_epi32(a));
+    } else {
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_setzero_si256(), src);
+        if (MODE == BLIT_SILHOUETTE) {
+            int fill;
+            memcpy(&fill, &blit.fill, sizeof(fill));
+            src = blend_avx2(dst, _mm256_set1_epi32(fill), _mm256_set1_epi32(blit.fill.a));
+        }
+        return _mm256_blendv_epi8(dst, src, mask);
+    }
+}
+
+template <BlitMode MODE>
+__attribute__((target("avx2")))
+static void blit_avx2(Blit & blit) {
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    for (int y = 0; y < blit.height; ++y) {
+        Pixel * dst = blit.dst + y * blit.dstPitch;
+        Pixel * src = blit.src + y * blit.srcPitch;
+        int x = 0;
+        for (; x + 8 <= blit.width; x += 8) {
+            __m256i s = blit.srcStep > 0? _mm256_loadu_si256((__m256i *) (src + x))
+                : _mm256_permutevar8x32_epi32(_mm256_loadu_si256((__m256i *) (src - x - 7)), reverse);
+            __m256i d = _mm256_loadu_si256((__m256i *) (dst + x));
+            _mm256_storeu_si256((__m256i *) (dst + x), blit_avx2<MODE>(blit, d, s));
+        }
+        blit_span_scalar<MODE>(blit, dst + x, src + x * blit.srcStep, blit.width - x);
+    }
+}
+
+template <BlitMode MODE>
+static void run_blit(Blit & blit) {
+    switch (simdLevel) {
+        case SIMD_AVX2: blit_avx2<MODE>(blit); break;
+        case SIMD_SSE2: blit_sse2<MODE>(blit); break;
+        default: blit_scalar<MODE>(blit); break;
+    }
+}
+
+void _draw_sprite(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy) {
+    Blit b = {};
+    if (clip_blit(canvas, pixels, width, height, pitch, cx, cy, false, b)) run_blit<BLIT_BLEND>(b);
+}
+
+void _draw_sprite_flip(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy, int flip) {
+    Blit b = {};
+    if (clip_blit(canvas, pixels, width, height, pitch, cx, cy, flip, b)) run_blit<BLIT_BLEND>(b);
+}
+
+void _draw_sprite(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy, float alpha) {
+    Blit b = {};
+    b.alpha = alpha;
+    if (clip_blit(canvas, pixels, width, height, pitch, cx, cy, false, b)) run_blit<BLIT_FADE>(b);
+}
+
+void _draw_sprite_silhouette(Canvas & canvas, Pixel * pixels,
+    int width, int height, int pitch, int cx, int cy, Color fill)
+{
+    Blit b = {};
+    b.fill = fill;
+    if (clip_blit(canvas, pixels, width, height, pitch, cx, cy, false, b)) run_blit<BLIT_SILHOUETTE>(b);
+}
+
+void _draw_sprite_a1(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy) {
+    Blit b = {};
+    if (clip_blit(canvas, pixels, width, height, pitch, cx, cy, false, b)) run_blit<BLIT_A1>(b);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// TEXT                                                                                                             ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void coverage_span_scalar(Pixel * dst, u8 * mask, int count, Color color) {
+    for (int x = 0; x < count; ++x) {
+        if (mask[x]) {
+            dst[x].r = (color.r * color.a + dst[x].r * (255 - color.a)) >> 8;
+            dst[x].g = (color.g * color.a + dst[x].g * (255 - color.a)) >> 8;
+            dst[x].b = (color.b * color.a + dst[x].b * (255 - color.a)) >> 8;
+        }
+    }
+}
+
+static void coverage_span_sse2(Pixel * dst, u8 * mask, int count, Color color) {
+    int fill;
+    memcpy(&fill, &color, sizeof(fill));
+    __m128i src = _mm_set1_epi32(fill), a = _mm_set1_epi32(color.a), zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        int m;
+        memcpy(&m, mask + x, sizeof(m));
+        if (!m) continue; //most of a line of text is the gaps between strokes
+        __m128i m32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero), zero);
+        __m128i covered = _mm_cmpgt_epi32(m32, zero);
+        __m128i d = _mm_loadu_si128((__m128i *) (dst + x));
+        __m128i b = blend_sse2(d, src, a);
+        _mm_storeu_si128((__m128i *) (dst + x), _mm_or_si128(_mm_and_si128(covered, b), _mm_andnot_si128(covered, d)));
+    }
+    coverage_span_scalar(dst + x, mask + x, count - x, color);
+}
+
+__attribute__((target("avx2")))
+static void coverage_span_avx2(Pixel * dst, u8 * mask, int count, Color color) {
+    int fill;
+    memcpy(&fill, &color, sizeof(fill));
+    __m256i src = _mm256_set1_epi32(fill), a = _mm256_set1_epi32(color.a), zero = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        long long m;
+        memcpy(&m, mask + x, sizeof(m));
+        if (!m) continue;
+        __m256i covered = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(_mm_cvtsi64_si128(m)), zero);
+        __m256i d = _mm256_loadu_si256((__m256i *) (dst + x));
+        _mm256_storeu_si256((__m256i *) (dst + x), _mm256_blendv_epi8(d, blend_avx2(d, src, a), covered));
+    }
+    coverage_span_scalar(dst + x, mask + x, count - x, color);
+}
+
+void _draw_coverage(Canvas & canvas, u8 * mask, int width, int height, int pitch, int cx, int cy, Color color) {
+    int minx = imax(0, cx);
+    int miny = imax(canvas.top, cy);
+    int maxx = imin(canvas.width, cx + width);
+    int maxy = imin(canvas.height, cy + height);
+    if (minx >= maxx || miny >= maxy) return;
+
+    void (* span) (Pixel *, u8 *, int, Color);
+    switch (simdLevel) {
+        case SIMD_AVX2: span = coverage_span_avx2; break;
+        case SIMD_SSE2: span = coverage_span_sse2; break;
+        default: span = coverage_span_scalar; break;
+    }
+    for (int y = miny; y < maxy; ++y) {
+        span(canvas[y] + minx, mask + (y - cy) * pitch + (minx - cx), maxx - minx, color);
+    }
+}
+
+TextRun make_text_run(MonoFont & font, const char * text) {
+    TextRun run = { &font, dup(text) };
+    int len = strlen(text);
+    run.width = len * font.glyphWidth;
+    run.height = font.glyphHeight * 2;
+    run.mask = (u8 *) calloc(run.width * run.height, sizeof(u8));
+
+    auto copy_glyph = [&] (int glyph, int x, int y) {
+        u8 * src = font.pixels + glyph / font.columns * font.glyphHeight * font.textureWidth
+                               + glyph % font.columns * font.glyphWidth;
+        for (int row = 0; row < font.glyphHeight; ++row) {
+            memcpy(run.mask + (y + row) * run.width + x, src + row * font.textureWidth, font.glyphWidth);
+        }
+    };
+    for (int i = 0; i < len; ++i) {
+        copy_glyph(text[i], i * font.glyphWidth, 0);
+        int descender = descender_glyph(text[i]);
+        if (descender >= 0) copy_glyph(descender, i * font.glyphWidth, font.glyphHeight);
+    }
+    return run;
+}
+
+void free_text_run(TextRun & run) {
+    free(run.text);
+    free(run.mask);
+    run = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// OVALS                                                                                                            ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum OvalMode {
+    OVAL_FILL,
+    OVAL_BLEND,
+    OVAL_ADD,
+};
+
+//`unsafe_blend()` over a whole span
+static inline void blend_color_span(Pixel * dst, int count, Color color) {
+    int x = 0;
+    if (simdLevel >= SIMD_SSE2) {
+        int fill;
+        memcpy(&fill, &color, sizeof(fill));
+        __m128i src = _mm_set1_epi32(fill), a = _mm_set1_epi32(color.a);
+        for (; x + 4 <= count; x += 4) {
+            __m128i d = _mm_loadu_si128((__m128i *) (dst + x));
+            _mm_storeu_si128((__m128i *) (dst + x), blend_sse2(d, src, a));
+        }
+    }
+    for (; x < count; ++x) {
+        dst[x].r = (color.r * color.a + dst[x].r * (255 - color.a)) >> 8;
+        dst[x].g = (color.g * color.a + dst[x].g * (255 - color.a)) >> 8;
+        dst[x].b = (color.b * color.a + dst[x].b * (255 - color.a)) >> 8;
+    }
+}
+
+//finds each row's extent from the ellipse equation, then nudges its ends until they agree exactly with the per-pixel
+//test, which is monotonic in the distance from the center, so the pixels inside a row are always one run
+template <OvalMode MODE>
+static void draw_oval_spans(Canvas & canvas, float x0, float y0, float w, float h, Color color) {
+    int minx = imax(0, lroundf(x0 - w));
+    int miny = imax(canvas.top, lroundf(y0 - h));
+    int maxx = imin(canvas.width  - 1, lroundf(x0 + w));
+    int maxy = imin(canvas.height - 1, lroundf(y0 + h));
+    if (maxx < minx || maxy < miny) return;
+    float xfactor = 1.0f / w;
+    float yfactor = 1.0f / h;
+    for (int y = miny; y <= maxy; ++y) {
+        float dy = (y - y0 + 0.5f) * yfactor;
+        float dy2 = dy * dy;
+        if (dy2 >= 1) continue;
+        auto inside = [&] (int x) {
+            float dx = (x - x0 + 0.5f) * xfactor;
+            return dx * dx + dy2 < 1;
+        };
+
+        float half = w * sqrtf(1 - dy2);
+        int first = imax(minx, ceilf(x0 - 0.5f - half));
+        int last = imin(maxx, floorf(x0 - 0.5f + half));
+        while (first > minx && inside(first - 1)) --first;
+        while (first <= last && !inside(first)) ++first;
+        while (last < maxx && inside(last + 1)) ++last;
+        while (last >= first && !inside(last)) --last;
+        if (first > last) continue;
+
+        Pixel * dst = canvas[y] + first;
+        int count = last - first + 1;
+        if (MODE == OVAL_FILL) {
+            for (int x = 0; x < count; ++x) dst[x] = color;
+        } else if (MODE == OVAL_BLEND) {
+            blend_color_span(dst, count, color);
+        } else {
+            for (int x = 0; x < count; ++x) {
+                dst[x].r = imin(255, dst[x].r + ((color.r * color.a) >> 8));
+                dst[x].g = imin(255, dst[x].g + ((color.g * color.a) >> 8));
+                dst[x].b = imin(255, dst[x].b + ((color.b * color.a) >> 8));
             }
         }
-    #else
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; ++x) {
-                Color c = pixels[(srcy + y) * pitch + srcx + x];
-                if (c.a > 127) {
-                    canvas[miny + y][minx + x] = c;
-                }
+    }
+}
+
+void draw_oval_f(Canvas & canvas, float x0, float y0, float w, float h, Color color) {
+    if (color.a < 250) draw_oval_spans<OVAL_BLEND>(canvas, x0, y0, w, h, color);
+    else draw_oval_spans<OVAL_FILL>(canvas, x0, y0, w, h, color);
+}
+
+void draw_oval_add(Canvas & canvas, int x0, int y0, int w, int h, Color color) {
+    draw_oval_spans<OVAL_ADD>(canvas, x0, y0, w, h, color);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// PREMULTIPLIED SPRITES                                                                                            ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//x / 255, rounded to nearest, for x in [0, 65535]
+static inline int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+//NOTE: blending a fully opaque or fully transparent premultiplied pixel gives exactly the same result as copying or
+//      skipping it, which is what lets every row be drawn as just one copied run with a blended run on each side:
+//      anything transparent in between gets blended, opaque runs shorter than `MIN_COPY` are blended instead of
+//      copied, and the blended runs are padded out to multiples of 8 pixels where the row has room. small sprites
+//      are mostly edges, so this way they pay less for mispredicted branches than a full list of runs would save
+static const int MIN_COPY = 8;
+
+static PremulRow build_premul_row(Pixel * row, int width) {
+    int start = 0, end = width;
+    while (start < end && row[start].a == 0) ++start;
+    while (end > start && row[end - 1].a == 0) --end;
+    if (start == end) return {};
+
+    //the longest opaque run
+    int copyStart = end, copyEnd = end;
+    for (int x = start; x < end;) {
+        int len = 0;
+        while (x + len < end && row[x + len].a == 255) ++len;
+        if (len >= MIN_COPY && len > copyEnd - copyStart) copyStart = x, copyEnd = x + len;
+        x += imax(1, len);
+    }
+
+    //pad the left run out to the left, then into the copied run, or out to the right if nothing is copied
+    int pad = -(copyStart - start) & 7, take = imin(pad, start);
+    start -= take, pad -= take;
+    if (copyStart == copyEnd) {
+        take = imin(pad, width - end);
+        end += take, copyStart += take, copyEnd += take;
+    } else {
+        copyStart += imin(pad, copyEnd - copyStart);
+    }
+    //pad the right run out to the right, then into the copied run
+    pad = -(end - copyEnd) & 7, take = imin(pad, width - end);
+    end += take, pad -= take;
+    copyEnd -= imin(pad, copyEnd - copyStart);
+
+    return { (u16) start, (u16) copyStart, (u16) copyEnd, (u16) end };
+}
+
+void premultiply_image(Image & image, int cellWidth, int cellHeight) {
+    assert(cellWidth > 0 && cellWidth <= UINT16_MAX && cellHeight > 0);
+    PremulImage * premul = (PremulImage *) malloc(sizeof(PremulImage));
+    *premul = {};
+    premul->cellWidth = cellWidth;
+    premul->cellHeight = cellHeight;
+    premul->cellsAcross = image.width / cellWidth;
+    premul->cellsDown = image.height / cellHeight;
+
+    int count = image.width * image.height;
+    Pixel * straight = (Pixel *) malloc(count * sizeof(Pixel));
+    Pixel * flipped = (Pixel *) malloc(count * sizeof(Pixel));
+    for (int i = 0; i < count; ++i) {
+        Pixel p = image.pixels[i];
+        straight[i] = { (u8) div255(p.r * p.a), (u8) div255(p.g * p.a), (u8) div255(p.b * p.a), p.a };
+    }
+    for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+            //mirror within the cell, any pixels to the right of the last whole cell are just copied as they are
+            int cellx = x / cellWidth;
+            int mirrored = cellx < premul->cellsAcross? cellx * cellWidth + cellWidth - 1 - x % cellWidth : x;
+            flipped[y * image.width + x] = straight[y * image.width + mirrored];
+        }
+    }
+    premul->pixels[0] = straight;
+    premul->pixels[1] = flipped;
+
+    for (int side = 0; side < 2; ++side) {
+        PremulRow * rows = (PremulRow *) malloc(image.height * premul->cellsAcross * sizeof(PremulRow));
+        for (int y = 0; y < premul->cellsDown * cellHeight; ++y) {
+            for (int cellx = 0; cellx < premul->cellsAcross; ++cellx) {
+                Pixel * row = premul->pixels[side] + y * image.width + cellx * cellWidth;
+                rows[y * premul->cellsAcross + cellx] = build_premul_row(row, cellWidth);
             }
         }
-    #endif
+        premul->rows[side] = rows;
+    }
+    image.premul = premul;
+}
+
+void free_image(Image & image) {
+    if (image.premul) {
+        for (int side = 0; side < 2; ++side) {
+            free(image.premul->pixels[side]);
+            free(image.premul->rows[side]);
+        }
+        free(image.premul);
+    }
+    free(image.pixels);
+    image = {};
+}
+
+//dst = src + dst * (1 - src alpha), for all four channels of the low `PIXELS` pixels of `src` and `dst`
+//NOTE: this does the same rounding division by 255 as `div255()`, and none of the intermediates can overflow 16 bits
+template <int PIXELS>
+static inline __m128i blend_premul_sse2(__m128i dst, __m128i src) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i i255 = _mm_set1_epi16(255);
+    const __m128i i128 = _mm_set1_epi16(128);
+
+    //spread each pixel's inverse alpha to all four of its 16-bit lanes
+    __m128i a = _mm_srli_epi32(src, 24);
+    __m128i aa = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+    __m128i t0 = _mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_sub_epi16(i255, _mm_unpacklo_epi32(aa, aa)));
+    t0 = _mm_add_epi16(t0, i128);
+    t0 = _mm_srli_epi16(_mm_add_epi16(t0, _mm_srli_epi16(t0, 8)), 8);
+    if (PIXELS <= 2) return _mm_add_epi8(src, _mm_packus_epi16(t0, zero));
+
+    __m128i t1 = _mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_sub_epi16(i255, _mm_unpackhi_epi32(aa, aa)));
+    t1 = _mm_add_epi16(t1, i128);
+    t1 = _mm_srli_epi16(_mm_add_epi16(t1, _mm_srli_epi16(t1, 8)), 8);
+    return _mm_add_epi8(src, _mm_packus_epi16(t0, t1));
+}
+
+//the same as `blend_premul_sse2<4>()`, for 8 pixels
+__attribute__((target("avx2")))
+static inline __m256i blend_premul_avx2(__m256i dst, __m256i src) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i i255 = _mm256_set1_epi16(255);
+    const __m256i i128 = _mm256_set1_epi16(128);
+
+    __m256i a = _mm256_srli_epi32(src, 24);
+    __m256i aa = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+    __m256i t0 = _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), _mm256_sub_epi16(i255, _mm256_unpacklo_epi32(aa, aa)));
+    __m256i t1 = _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), _mm256_sub_epi16(i255, _mm256_unpackhi_epi32(aa, aa)));
+    t0 = _mm256_add_epi16(t0, i128);
+    t1 = _mm256_add_epi16(t1, i128);
+    t0 = _mm256_srli_epi16(_mm256_add_epi16(t0, _mm256_srli_epi16(t0, 8)), 8);
+    t1 = _mm256_srli_epi16(_mm256_add_epi16(t1, _mm256_srli_epi16(t1, 8)), 8);
+    return _mm256_add_epi8(src, _mm256_packus_epi16(t0, t1));
+}
+
+//the premultiplied blend of a span, at each SIMD level
+//NOTE: blended runs are padded to multiples of 8 pixels where they can be, so the single pixel loops are mostly only
+//      for ones that got clipped
+typedef void (* BlendSpanFunc) (Pixel * dst, Pixel * src, int count);
+
+static inline void blend_premul_span_scalar(Pixel * dst, Pixel * src, int count) {
+    for (int x = 0; x < count; ++x) {
+        Pixel s = src[x], & d = dst[x];
+        int inv = 255 - s.a;
+        d = { (u8) (s.r + div255(d.r * inv)), (u8) (s.g + div255(d.g * inv)),
+              (u8) (s.b + div255(d.b * inv)), (u8) (s.a + div255(d.a * inv)) };
+    }
+}
+
+static inline void blend_premul_span_sse2(Pixel * dst, Pixel * src, int count) {
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128i s = _mm_loadu_si128((__m128i *) (src + x)), d = _mm_loadu_si128((__m128i *) (dst + x));
+        _mm_storeu_si128((__m128i *) (dst + x), blend_premul_sse2<4>(d, s));
+    }
+    for (; x < count; ++x) {
+        __m128i s = _mm_cvtsi32_si128(*(int *) (src + x)), d = _mm_cvtsi32_si128(*(int *) (dst + x));
+        *(int *) (dst + x) = _mm_cvtsi128_si32(blend_premul_sse2<1>(d, s));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void blend_premul_span_avx2(Pixel * dst, Pixel * src, int count) {
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i s = _mm256_loadu_si256((__m256i *) (src + x)), d = _mm256_loadu_si256((__m256i *) (dst + x));
+        _mm256_storeu_si256((__m256i *) (dst + x), blend_premul_avx2(d, s));
+    }
+    blend_premul_span_sse2(dst + x, src + x, count - x);
+}
+
+static inline void copy_span(Pixel * dst, Pixel * src, int count) {
+    if (count < 4) {
+        for (int x = 0; x < count; ++x) dst[x] = src[x];
+        return;
+    }
+    //the last 4 pixels are copied separately, overlapping the loop if the count isn't a multiple of 4
+    for (int x = 0; x + 4 < count; x += 4) {
+        _mm_storeu_si128((__m128i *) (dst + x), _mm_loadu_si128((__m128i *) (src + x)));
+    }
+    _mm_storeu_si128((__m128i *) (dst + count - 4), _mm_loadu_si128((__m128i *) (src + count - 4)));
+}
+
+struct PremulBlit {
+    Pixel * src; //the first pixel of the clipped source rect
+    Pixel * dst; //the first pixel of the clipped destination rect
+    int srcPitch, dstPitch;
+    PremulRow * rows; //the row of the first clipped source row
+    int rowStep; //between consecutive rows of the same cell, always `cellsAcross`
+    int srcx, endx; //the clipped columns of the cell, [srcx, endx)
+    int height;
+};
+
+//draws every row with the blend function for one SIMD level
+//NOTE: this gets inlined into a function for each level, so the blend function can be inlined into it in turn
+template <BlendSpanFunc BLEND>
+__attribute__((always_inline)) static inline void draw_premul_rows(PremulBlit & b) {
+    //NOTE: copied out of the struct so the compiler doesn't have to reload them after every store to the canvas
+    int srcx = b.srcx, endx = b.endx;
+    for (int y = 0; y < b.height; ++y) {
+        Pixel * src = b.src + y * b.srcPitch - srcx;
+        Pixel * dst = b.dst + y * b.dstPitch - srcx;
+        PremulRow r = b.rows[y * b.rowStep];
+        int first = imax(r.blendStart, srcx), last = imin(r.copyStart, endx);
+        if (first < last) BLEND(dst + first, src + first, last - first);
+        first = imax(r.copyStart, srcx), last = imin(r.copyEnd, endx);
+        if (first < last) copy_span(dst + first, src + first, last - first);
+        first = imax(r.copyEnd, srcx), last = imin(r.blendEnd, endx);
+        if (first < last) BLEND(dst + first, src + first, last - first);
+    }
+}
+
+static void draw_premul_rows_scalar(PremulBlit & b) { draw_premul_rows<blend_premul_span_scalar>(b); }
+static void draw_premul_rows_sse2(PremulBlit & b) { draw_premul_rows<blend_premul_span_sse2>(b); }
+__attribute__((target("avx2")))
+static void draw_premul_rows_avx2(PremulBlit & b) { draw_premul_rows<blend_premul_span_avx2>(b); }
+
+void _draw_sprite_premul(Canvas & canvas, Image & image, int cellx, int celly, int cx, int cy, bool flip) {
+    PremulImage & premul = *image.premul;
+    int width = premul.cellWidth, height = premul.cellHeight;
+
+    //destination coords
+    int minx = imax(0, cx);
+    int miny = imax(canvas.top, cy);
+    int maxx = imin(canvas.width, cx + width);
+    int maxy = imin(canvas.height, cy + height);
+    if (minx >= maxx || miny >= maxy) return;
+
+    //source coords, relative to the cell
+    int srcx = minx - cx;
+    int srcy = miny - cy;
+
+    PremulBlit b = {};
+    b.src = premul.pixels[flip] + (celly * height + srcy) * image.width + cellx * width + srcx;
+    b.dst = canvas[miny] + minx;
+    b.srcPitch = image.width;
+    b.dstPitch = canvas.pitch;
+    b.rows = premul.rows[flip] + (celly * height + srcy) * premul.cellsAcross + cellx;
+    b.rowStep = premul.cellsAcross;
+    b.srcx = srcx;
+    b.endx = maxx - cx;
+    b.height = maxy - miny;
+    switch (simdLevel) {
+        case SIMD_AVX2: draw_premul_rows_avx2(b); break;
+        case SIMD_SSE2: draw_premul_rows_sse2(b); break;
+        default: draw_premul_rows_scalar(b); break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// CANVAS PRESENTATION                                                                                              ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct TexVert { Vec2 pos, uv; };
+
+CanvasPresenter make_canvas_presenter(uint shader) {
+    CanvasPresenter p = {};
+    p.shader = shader;
+    p.texSizeLoc = glGetUniformLocation(shader, "texSize");
+    p.scaleLoc = glGetUniformLocation(shader, "scale");
+
+    glGenTextures(1, &p.tex);
+    glBindTexture(GL_TEXTURE_2D, p.tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glGenBuffers(PRESENT_BUFFERS, p.pbos);
+
+    glGenVertexArrays(1, &p.vao);
+    glGenBuffers(1, &p.vbo);
+    glBindVertexArray(p.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, p.vbo);
+    glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(TexVert), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TexVert), (void *) offsetof(TexVert, pos));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TexVert), (void *) offsetof(TexVert, uv));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
+    gl_error("make_canvas_presenter()");
+    return p;
+}
+
+void free_canvas_presenter(CanvasPresenter & p) {
+    glDeleteTextures(1, &p.tex);
+    glDeleteBuffers(PRESENT_BUFFERS, p.pbos);
+    glDeleteBuffers(1, &p.vbo);
+    glDeleteVertexArrays(1, &p.vao);
+    p = {};
+}
+
+void draw_canvas(CanvasPresenter & p, Canvas & canvas, float ww, float wh) {
+    int w = canvas.width + canvas.margin * 2, h = canvas.height + canvas.margin * 2;
+    int bytes = w * h * sizeof(Pixel);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, p.tex);
+    glUseProgram(p.shader);
+
+    //only (re)allocate when the canvas changes size, which in practice is just the first frame
+    bool resized = canvas.width != p.canvasWidth || canvas.height != p.canvasHeight || canvas.margin != p.canvasMargin;
+    if (resized) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        for (uint pbo : p.pbos) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        }
+        glUniform2f(p.texSizeLoc, w, h);
+        p.canvasWidth = canvas.width;
+        p.canvasHeight = canvas.height;
+        p.canvasMargin = canvas.margin;
+    }
+
+    //upload through the next buffer in the ring. invalidating it lets the driver hand us fresh memory
+    //if the GPU is still reading the frame that last went through it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, p.pbos[p.nextPbo]);
+    p.nextPbo = (p.nextPbo + 1) % PRESENT_BUFFERS;
+    void * mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        memcpy(mapped, canvas.basePointer(), bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+        //fall back to uploading straight from the canvas
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, canvas.basePointer());
+    }
+
+    //the quad only changes when the window is resized
+    if (resized || ww != p.windowWidth || wh != p.windowHeight) {
+        //NOTE: this still doesn't actually work to get rid of scaling artifacts
+        //      except at 2x scale where it kinda sorta accidentally mostly works by happenstance
+        float u1 = canvas.margin / (float) w - 0.5f / ww;
+        float v1 = canvas.margin / (float) h - 0.5f / wh;
+        float u2 = 1 - u1 - 1.0f / ww;
+        float v2 = 1 - v1 - 1.0f / wh;
+
+        float x = fminf(1, (wh / ww) / (canvas.height / (float) canvas.width));
+        float y = fminf(1, (ww / wh) / (canvas.width / (float) canvas.height));
+
+        TexVert verts[6] = {
+            { vec2(-x,  y), vec2(u1, v1) },
+            { vec2( x,  y), vec2(u2, v1) },
+            { vec2( x, -y), vec2(u2, v2) },
+            { vec2(-x,  y), vec2(u1, v1) },
+            { vec2( x, -y), vec2(u2, v2) },
+            { vec2(-x, -y), vec2(u1, v2) },
+        };
+        glBindBuffer(GL_ARRAY_BUFFER, p.vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(verts), verts);
+        glUniform1f(p.scaleLoc, fminf(ww / canvas.width, wh / canvas.height));
+        p.windowWidth = ww;
+        p.windowHeight = wh;
+    }
+
+    glBindVertexArray(p.vao);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+
+    gl_error("draw_canvas()");
+}
+
+bool write_canvas_raw(Canvas & canvas, const char * path) {
+    FILE * f = fopen(path, "wb");
+    if (!f) return false;
+    bool success = true;
+    for (int y = 0; y < canvas.height; ++y) {
+        success &= fwrite(canvas[y], sizeof(Pixel), canvas.width, f) == (size_t) canvas.width;
+    }
+    success &= fclose(f) == 0;
+    return success;
+}
+
+bool write_canvas_png(Canvas & canvas, const char * path) {
+    return stbi_write_png(path, canvas.width, canvas.height, 4, canvas.pixels, canvas.pitch * sizeof(Pixel));
 }
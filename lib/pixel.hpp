@@ -18,6 +18,7 @@ struct Canvas {
     int height;
     int pitch; //number of pixels, NOT number of bytes!
     int margin; //number of pixels, NOT number of bytes!
+    int top; //first row that may be drawn to, so that a canvas can be split into bands that are drawn separately
 
     //NOTE: indexed in [y][x] order!!!
     __attribute__((__always_inline__)) Pixel * operator[] (int row) {
@@ -33,10 +34,29 @@ struct Canvas {
 /// SPRITE OPS                                                                                                       ///
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+//the runs of pixels one row of a premultiplied sprite is drawn in: everything before `blendStart` and from
+//`blendEnd` on is fully transparent and gets skipped, [copyStart, copyEnd) is fully opaque and gets copied,
+//and the rest gets blended. a row with nothing to draw has all four set to 0
+struct PremulRow {
+    u16 blendStart, copyStart, copyEnd, blendEnd;
+};
+
+//an image preprocessed at load time for the fast alpha blending path: the pixels are premultiplied, and every row
+//of every cell (the whole image, or each tile of a tileset) has a `PremulRow`, so that only the edges of a sprite
+//pay for blending. index [1] of each array is the same thing with every cell mirrored horizontally, for drawing
+//flipped sprites
+struct PremulImage {
+    Pixel * pixels[2]; //same layout as the original image
+    PremulRow * rows[2]; //[y * cellsAcross + cellx], where `y` is the pixel row of the whole image
+    int cellWidth, cellHeight;
+    int cellsAcross, cellsDown;
+};
+
 struct Image {
     Pixel * pixels;
     int width;
     int height;
+    PremulImage * premul; //null if the image hasn't been preprocessed
 
     //NOTE: indexed in [y][x] order!!!
     __attribute__((__always_inline__)) Pixel * operator[] (int row) {
@@ -44,7 +64,11 @@ struct Image {
     }
 };
 
-static inline Image load_image(const char * filepath) {
+//builds `image.premul`, treating the image as a grid of `cellWidth` x `cellHeight` sprites
+void premultiply_image(Image & image, int cellWidth, int cellHeight);
+void free_image(Image & image);
+
+static inline Image load_image_unprocessed(const char * filepath) {
     int w, h, c;
     Pixel * pixels = (Pixel *) stbi_load(filepath, &w, &h, &c, 4);
     assert(pixels);
@@ -53,6 +77,12 @@ static inline Image load_image(const char * filepath) {
     return { pixels, w, h };
 }
 
+static inline Image load_image(const char * filepath) {
+    Image image = load_image_unprocessed(filepath);
+    premultiply_image(image, image.width, image.height);
+    return image;
+}
+
 static inline __attribute__((__always_inline__))
 void unsafe_blend(Canvas & canvas, int x, int y, Color color) {
     Pixel * row = canvas.pixels + y * canvas.pitch;
@@ -63,7 +93,7 @@ void unsafe_blend(Canvas & canvas, int x, int y, Color color) {
 
 static inline __attribute__((__always_inline__))
 void blend(Canvas canvas, int x, int y, Color color) {
-    if (x >= 0 && x < canvas.width && y >= 0 && y < canvas.height) {
+    if (x >= 0 && x < canvas.width && y >= canvas.top && y < canvas.height) {
         Pixel * row = canvas.pixels + y * canvas.pitch;
         row[x].r = (color.r * color.a + row[x].r * (255 - color.a)) >> 8;
         row[x].g = (color.g * color.a + row[x].g * (255 - color.a)) >> 8;
@@ -81,7 +111,7 @@ void unsafe_blend_add(Canvas & canvas, int x, int y, Color color) {
 
 static inline __attribute__((__always_inline__))
 void blend_add(Canvas canvas, int x, int y, Color color) {
-    if (x >= 0 && x < canvas.width && y >= 0 && y < canvas.height) {
+    if (x >= 0 && x < canvas.width && y >= canvas.top && y < canvas.height) {
         Pixel * row = canvas.pixels + y * canvas.pitch;
         row[x].r = imin(255, row[x].r + ((color.r * color.a) >> 8));
         row[x].g = imin(255, row[x].g + ((color.g * color.a) >> 8));
@@ -89,224 +119,39 @@ void blend_add(Canvas canvas, int x, int y, Color color) {
     }
 }
 
-// #define SSE_BLIT
-
-//TODO: refactor these to only differ in the blend function
-
+//all the sprite blitters share one clipping routine and one set of row kernels (scalar, SSE2 and AVX2),
+//which are picked at runtime based on `simdLevel` and are guaranteed to produce bit-identical output
+
+//alpha blends cell (cellx, celly) of a preprocessed image over the canvas, mirrored horizontally if `flip` is set
+//NOTE: this rounds correctly, unlike `unsafe_blend()` and the straight alpha blitters below, which are slightly too
+//      dark, so the two paths don't produce identical output
+void _draw_sprite_premul(Canvas & canvas, Image & image, int cellx, int celly, int cx, int cy, bool flip);
+
+//alpha blends the sprite over the canvas
+void _draw_sprite(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy);
+//same as above, but mirrored horizontally if `flip` is nonzero
+void _draw_sprite_flip(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy, int flip);
+//alpha blends the sprite with its alpha channel scaled by `alpha`, which must be in [0, 1]
+void _draw_sprite(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy, float alpha);
+//blends `fill` wherever the sprite is more than half opaque
+void _draw_sprite_silhouette(Canvas & canvas, Pixel * pixels,
+    int width, int height, int pitch, int cx, int cy, Color fill);
+//copies the sprite's pixels wherever they are more than half opaque, with no blending
 void _draw_sprite_a1(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy);
 
 static inline void draw_sprite_a1(Canvas & canvas, Image & image, int cx, int cy) {
     _draw_sprite_a1(canvas, image.pixels, image.width, image.height, image.width, cx, cy);
 }
 
-static inline void _draw_sprite(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy) {
-    //destination coords
-    int minx = imax(0, cx);
-    int miny = imax(0, cy);
-    int maxx = imin(canvas.width, cx + width);
-    int maxy = imin(canvas.height, cy + height);
-
-    if (minx >= maxx || miny >= maxy) return;
-
-    //source coords
-    int srcx = minx - cx;
-    int srcy = miny - cy;
-    int srcw = maxx - minx;
-    int srch = maxy - miny;
-
-    #ifdef SSE_BLIT
-        const __m128i i3210 = _mm_set_epi32(3, 2, 1, 0);
-        const __m128i rbMask1 = _mm_set1_epi32(0x00FF00FF);
-        const __m128i gMask1 = _mm_set1_epi32(0x0000FF00);
-        const __m128i iSrcw = _mm_set1_epi32(srcw);
-        const __m128i rbMask2 = _mm_set1_epi32(0xFF00FF00);
-
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; x += 4) {
-                //we use this to set the alpha of pixels outside the region to 0 so they will be ignored
-                __m128i inclusionMask = _mm_cmplt_epi32(_mm_add_epi32(i3210, _mm_set1_epi32(x)), iSrcw);
-
-                __m128i dst = _mm_loadu_si128((__m128i *) &canvas[miny + y][minx + x]);
-                __m128i src = _mm_loadu_si128((__m128i *) &pixels[(srcy + y) * pitch + srcx + x]);
-
-                //unpack alpha and 1-alpha into 16-bit lanes
-                //TODO: can we use shuffles for this?
-                __m128i a = _mm_and_si128(_mm_srli_epi32(src, 24), inclusionMask);
-                __m128i a1 = _mm_or_si128(a, _mm_slli_epi32(a, 16));
-                __m128i a2 = _mm_sub_epi16(_mm_set1_epi16(255), a1);
-
-                //unpack color channels into 16-bit lanes and multiple with alpha and 1-alpha
-                __m128i rb1 = _mm_mullo_epi16(_mm_and_si128(src, rbMask1), a1); //0x00FF00FF -> 0xFFFFFFFF
-                __m128i rb2 = _mm_mullo_epi16(_mm_and_si128(dst, rbMask1), a2); //0x00FF00FF -> 0xFFFFFFFF
-                __m128i g1 = _mm_mulhi_epu16(_mm_and_si128(src, gMask1), a1); //0x0000FF00 -> 0x000000FF
-                __m128i g2 = _mm_mulhi_epu16(_mm_and_si128(dst, gMask1), a2); //0x0000FF00 -> 0x000000FF
-
-                //add multiplied source and destination color channels
-                __m128i rb = _mm_and_si128(_mm_add_epi32(rb1, rb2), rbMask2);
-                __m128i g = _mm_slli_epi32(_mm_add_epi32(g1, g2), 16);
-
-                //recombine color channels and shift into place (destination alpha can be left as 0 since it's not used)
-                __m128i c = _mm_srli_epi32(_mm_or_si128(rb, g), 8);
-                _mm_storeu_si128((__m128i *) &canvas[miny + y][minx + x], c);
-            }
-        }
-    #else
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; ++x) {
-                unsafe_blend(canvas, minx + x, miny + y, pixels[(srcy + y) * pitch + srcx + x]);
-            }
-        }
-    #endif
-}
-
-static inline void _draw_sprite_flip(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy, int flip) {
-    //destination coords
-    int minx = imax(0, cx);
-    int miny = imax(0, cy);
-    int maxx = imin(canvas.width, cx + width);
-    int maxy = imin(canvas.height, cy + height);
-
-    if (minx >= maxx || miny >= maxy) return;
-
-    //source coords
-    int srcx = minx - cx;
-    int srcy = miny - cy;
-    int srcw = maxx - minx;
-    int srch = maxy - miny;
-
-    if (flip)
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; ++x) {
-                unsafe_blend(canvas, minx + x, miny + y, pixels[(srcy + y) * pitch + srcx + srcw - x]);
-            }
-        }
-    else
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; ++x) {
-                unsafe_blend(canvas, minx + x, miny + y, pixels[(srcy + y) * pitch + srcx + x]);
-            }
-        }
-}
-
 static inline void draw_sprite(Canvas & canvas, Image & image, int cx, int cy) {
-    _draw_sprite(canvas, image.pixels, image.width, image.height, image.width, cx, cy);
-}
-
-static inline
-void _draw_sprite(Canvas & canvas, Pixel * pixels, int width, int height, int pitch, int cx, int cy, float alpha) {
-    //destination coords
-    int minx = imax(0, cx);
-    int miny = imax(0, cy);
-    int maxx = imin(canvas.width, cx + width);
-    int maxy = imin(canvas.height, cy + height);
-
-    if (minx >= maxx || miny >= maxy) return;
-
-    //source coords
-    int srcx = minx - cx;
-    int srcy = miny - cy;
-    int srcw = maxx - minx;
-    int srch = maxy - miny;
-
-    #ifdef SSE_BLIT
-        const __m128i alpha16 = _mm_set1_epi16(alpha * 255);
-        const __m128i iSrcw = _mm_set1_epi32(srcw);
-        const __m128i i3210 = _mm_set_epi32(3, 2, 1, 0);
-        const __m128i allo = (__m128i) _mm_setr_epi32(0xff03ff03, 0xff03ff03, 0xff07ff07, 0x0ff7ff07);
-        const __m128i alhi = (__m128i) _mm_setr_epi32(0xff0bff0b, 0xff0bff0b, 0xff0fff0f, 0x0fffff0f);
-        const __m128i zero = (__m128i) _mm_setr_epi32(0x00000000, 0x00000000, 0x00000000, 0x00000000);
-        const __m128i i255 = (__m128i) _mm_setr_epi32(0xff00ff00, 0xff00ff00, 0xff00ff00, 0xff00ff00);
-
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; x += 4) {
-                __m128i inclusionMask = _mm_cmplt_epi32(_mm_add_epi32(i3210, _mm_set1_epi32(x)), iSrcw);
-
-                Pixel * canvSrc = &canvas[miny + y][minx + x];
-                __m128i under = _mm_loadu_si128((__m128i *) canvSrc);
-                Pixel * imgSrc = &pixels[(srcy + y) * pitch + srcx + x];
-                __m128i over = _mm_and_si128(_mm_loadu_si128((__m128i *) imgSrc), inclusionMask);
-
-                __m128i under0 = _mm_cvtepu8_epi16(under); //@SSE4.1
-                __m128i under1 = _mm_unpackhi_epi8(under, zero);
-                __m128i over0 = _mm_cvtepu8_epi16(over); //@SSE4.1
-                __m128i over1 = _mm_unpackhi_epi8(over, zero);
-                __m128i alpha0 = _mm_mullo_epi16(_mm_shuffle_epi8(over, allo), alpha16); //@SSSE3
-                __m128i alpha1 = _mm_mullo_epi16(_mm_shuffle_epi8(over, alhi), alpha16); //@SSSE3
-                __m128i invAlpha0 = _mm_sub_epi8(i255, alpha0);
-                __m128i invAlpha1 = _mm_sub_epi8(i255, alpha1);
-                __m128i underMul0 = _mm_mulhi_epu16(under0, invAlpha0);
-                __m128i underMul1 = _mm_mulhi_epu16(under1, invAlpha1);
-                __m128i overMul0 = _mm_mulhi_epu16(over0, alpha0);
-                __m128i overMul1 = _mm_mulhi_epu16(over1, alpha1);
-                __m128i underFinal = _mm_packus_epi16(underMul0, underMul1);
-                __m128i overFinal = _mm_packus_epi16(overMul0, overMul1);
-                __m128i c = _mm_adds_epu8(overFinal, underFinal);
-                _mm_storeu_si128((__m128i *) canvSrc, c);
-            }
-        }
-    #else
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; ++x) {
-                Color color = pixels[(srcy + y) * pitch + srcx + x];
-                color.a *= alpha;
-                unsafe_blend(canvas, minx + x, miny + y, color);
-            }
-        }
-    #endif
+    if (image.premul) _draw_sprite_premul(canvas, image, 0, 0, cx, cy, false);
+    else _draw_sprite(canvas, image.pixels, image.width, image.height, image.width, cx, cy);
 }
 
 static inline void draw_sprite(Canvas & canvas, Image & image, int cx, int cy, float alpha) {
     _draw_sprite(canvas, image.pixels, image.width, image.height, image.width, cx, cy, alpha);
 }
 
-static inline void _draw_sprite_silhouette(Canvas & canvas, Pixel * pixels,
-    int width, int height, int pitch, int cx, int cy, Color fill)
-{
-    //destination coords
-    int minx = imax(0, cx);
-    int miny = imax(0, cy);
-    int maxx = imin(canvas.width, cx + width);
-    int maxy = imin(canvas.height, cy + height);
-
-    //source coords
-    int srcx = minx - cx;
-    int srcy = miny - cy;
-    int srcw = maxx - minx;
-    int srch = maxy - miny;
-
-    // #ifdef SSE_BLIT
-    #if 0 //TODO: SSE version
-        const __m128i iSrcw = _mm_set1_epi32(srcw);
-        const __m128i i3210 = _mm_set_epi32(3, 2, 1, 0);
-        const __m128i zero = (__m128i) _mm_set1_epi32(0);
-
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; x += 4) {
-                __m128i ix = _mm_add_epi32(i3210, _mm_set1_epi32(x));
-                __m128i inclusionMask = _mm_cmplt_epi32(ix, iSrcw);
-
-                Pixel * canvSrc = &canvas[miny + y][minx + x];
-                __m128i src = _mm_loadu_si128((__m128i *) canvSrc);
-                Pixel * imgSrc = &pixels[(srcy + y) * pitch + srcx + x];
-                __m128i img = _mm_loadu_si128((__m128i *) imgSrc);
-
-                __m128i alphaMask = _mm_and_si128(_mm_cmplt_epi32(img, zero), inclusionMask);
-                __m128i c = _mm_blendv_epi8(src, img, alphaMask);
-                _mm_storeu_si128((__m128i *) canvSrc, c);
-            }
-        }
-    #else
-        for (int y = 0; y < srch; ++y) {
-            for (int x = 0; x < srcw; ++x) {
-                Color c = pixels[(srcy + y) * pitch + srcx + x];
-                if (c.a > 127) {
-                    unsafe_blend(canvas, minx + x, miny + y, fill);
-                }
-            }
-        }
-    #endif
-}
-
 static inline void draw_sprite_silhouette(Canvas & canvas, Image & image, int cx, int cy, Color fill) {
     _draw_sprite_silhouette(canvas, image.pixels, image.width, image.height, image.width, cx, cy, fill);
 }
@@ -325,17 +170,20 @@ struct Tileset {
 };
 
 static inline Tileset load_tileset(const char * filepath, int tileWidth, int tileHeight, float frame_time = 10000.0f) {
-    Image image = load_image(filepath);
+    Image image = load_image_unprocessed(filepath);
+    premultiply_image(image, tileWidth, tileHeight);
     return { tileWidth, tileHeight, image.width / tileWidth, image.height / tileHeight, frame_time, image };
 }
 
 static inline void draw_tile(Canvas & canvas, Tileset & set, int tx, int ty, int cx, int cy) {
-    _draw_sprite(canvas,
-        &set.image[ty * set.tileHeight][tx * set.tileWidth], set.tileWidth, set.tileHeight, set.image.width, cx, cy);
+    if (set.image.premul) _draw_sprite_premul(canvas, set.image, tx, ty, cx, cy, false);
+    else _draw_sprite(canvas, &set.image[ty * set.tileHeight][tx * set.tileWidth],
+        set.tileWidth, set.tileHeight, set.image.width, cx, cy);
 }
 
 static inline void draw_tile_flip(Canvas & canvas, Tileset & set, int tx, int ty, int cx, int cy, bool flip) {
-    _draw_sprite_flip(canvas, &set.image[ty * set.tileHeight][tx * set.tileWidth],
+    if (set.image.premul) _draw_sprite_premul(canvas, set.image, tx, ty, cx, cy, flip);
+    else _draw_sprite_flip(canvas, &set.image[ty * set.tileHeight][tx * set.tileWidth],
         set.tileWidth, set.tileHeight, set.image.width, cx, cy, flip);
 }
 
@@ -371,7 +219,7 @@ static inline void draw_animation_silhouette(Canvas & canvas,
 
 static inline void draw_rect(Canvas & canvas, int x, int y, int w, int h, Color color) {
     int minx = imax(0, x);
-    int miny = imax(0, y);
+    int miny = imax(canvas.top, y);
     int maxx = imin(canvas.width , x + w);
     int maxy = imin(canvas.height, y + h);
     for (int y = miny; y < maxy; ++y) {
@@ -407,105 +255,17 @@ static inline void draw_line(Canvas & canvas, int x1, int y1, int x2, int y2, Co
     }
 }
 
-static inline void draw_oval_f(Canvas & canvas, float x0, float y0, float w, float h, Color color) {
-    int minx = imax(0, lroundf(x0 - w));
-    int miny = imax(0, lroundf(y0 - h));
-    int maxx = imin(canvas.width  - 1, lroundf(x0 + w));
-    int maxy = imin(canvas.height - 1, lroundf(y0 + h));
-    if (maxx < minx || maxy < miny) return;
-    float xfactor = 1.0f / w;
-    float yfactor = 1.0f / h;
-    if (color.a < 250) {
-        for (int y = miny; y <= maxy; ++y) {
-            for (int x = minx; x <= maxx; ++x) {
-                float dx = (x - x0 + 0.5f) * xfactor;
-                float dy = (y - y0 + 0.5f) * yfactor;
-                if (dx * dx + dy * dy < 1) {
-                    unsafe_blend(canvas, x, y, color);
-                }
-            }
-        }
-    } else {
-        for (int y = miny; y <= maxy; ++y) {
-            for (int x = minx; x <= maxx; ++x) {
-                float dx = (x - x0 + 0.5f) * xfactor;
-                float dy = (y - y0 + 0.5f) * yfactor;
-                if (dx * dx + dy * dy < 1) {
-                    canvas.pixels[y * canvas.pitch + x] = color;
-                }
-            }
-        }
-    }
-}
-
+//NOTE: the ovals are filled a row at a time, but a pixel is inside exactly when its center is inside the ellipse
+//      with radii (w, h) centered on (x0, y0), the same as testing every pixel of the bounding box.
+//      colors with alpha >= 250 are drawn opaque
+void draw_oval_f(Canvas & canvas, float x0, float y0, float w, float h, Color color);
 static inline void draw_oval(Canvas & canvas, int x0, int y0, int w, int h, Color color) {
-    int minx = imax(0, x0 - w);
-    int miny = imax(0, y0 - h);
-    int maxx = imin(canvas.width  - 1, x0 + w);
-    int maxy = imin(canvas.height - 1, y0 + h);
-    if (maxx < minx || maxy < miny) return;
-    float xfactor = 1.0f / w;
-    float yfactor = 1.0f / h;
-    if (color.a < 250) {
-        for (int y = miny; y <= maxy; ++y) {
-            for (int x = minx; x <= maxx; ++x) {
-                float dx = (x - x0 + 0.5f) * xfactor;
-                float dy = (y - y0 + 0.5f) * yfactor;
-                if (dx * dx + dy * dy < 1) {
-                    unsafe_blend(canvas, x, y, color);
-                }
-            }
-        }
-    } else {
-        for (int y = miny; y <= maxy; ++y) {
-            for (int x = minx; x <= maxx; ++x) {
-                float dx = (x - x0 + 0.5f) * xfactor;
-                float dy = (y - y0 + 0.5f) * yfactor;
-                if (dx * dx + dy * dy < 1) {
-                    canvas.pixels[y * canvas.pitch + x] = color;
-                }
-            }
-        }
-    }
+    draw_oval_f(canvas, x0, y0, w, h, color);
 }
+void draw_oval_add(Canvas & canvas, int x0, int y0, int w, int h, Color color);
 
-static inline void draw_oval_add(Canvas & canvas, int x0, int y0, int w, int h, Color color) {
-    int minx = imax(0, x0 - w);
-    int miny = imax(0, y0 - h);
-    int maxx = imin(canvas.width  - 1, x0 + w);
-    int maxy = imin(canvas.height - 1, y0 + h);
-    if (maxx < minx || maxy < miny) return;
-    float xfactor = 1.0f / w;
-    float yfactor = 1.0f / h;
-    for (int y = miny; y <= maxy; ++y) {
-        for (int x = minx; x <= maxx; ++x) {
-            float dx = (x - x0 + 0.5f) * xfactor;
-            float dy = (y - y0 + 0.5f) * yfactor;
-            if (dx * dx + dy * dy < 1) {
-                unsafe_blend_add(canvas, x, y, color);
-            }
-        }
-    }
-}
-
-void add_light(Canvas & canvas, int x0, int y0, int w, int h, Color color);
-
-static inline void draw_triangle(Canvas & canvas, int x1, int y1, int x2, int y2, int x3, int y3, Color c) {
-    int minx = imax(0, imin(x1, imin(x2, x3)));
-    int miny = imax(0, imin(y1, imin(y2, y3)));
-    int maxx = imin(canvas.width  - 1, imax(x1, imax(x2, x3)));
-    int maxy = imin(canvas.height - 1, imax(y1, imax(y2, y3)));
-    for (int y = miny; y <= maxy; ++y) {
-        for (int x = minx; x <= maxx; ++x) {
-            int w0 = cross(coord2(x, y) - coord2(x1, y1), coord2(x2, y2) - coord2(x1, y1));
-            int w1 = cross(coord2(x, y) - coord2(x2, y2), coord2(x3, y3) - coord2(x2, y2));
-            int w2 = cross(coord2(x, y) - coord2(x3, y3), coord2(x1, y1) - coord2(x3, y3));
-            if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0)) {
-                canvas[y][x] = c;
-            }
-        }
-    }
-}
+//fills the triangle with `color`, drawing only the pixels exactly on its edges that are on top or left edges
+void draw_triangle(Canvas & canvas, int x1, int y1, int x2, int y2, int x3, int y3, Color color);
 
 void draw_textured_triangle(Canvas & canvas, Image & tex,
     int x1, int y1, int u1, int v1,
@@ -530,6 +290,38 @@ static inline void draw_transformed_sprite(Canvas & canvas, Image & sprite, Vec2
         verts[3].x, verts[3].y, 0, sprite.height);
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// LIGHTING                                                                                                         ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//adds a light with radii (w, h) centered on (x0, y0) straight into the canvas, evaluating the falloff for every pixel
+void add_light(Canvas & canvas, int x0, int y0, int w, int h, Color color);
+
+//lights are accumulated at half the canvas resolution on each axis, then smoothed back up to full resolution and
+//added onto the canvas all at once, so each light only costs a quarter as many pixels and the falloff is a table lookup
+//NOTE: the texels are in 8.8 fixed point, so lots of dim lights add up without the rounding error adding up too
+static const int LIGHT_SCALE = 2; //canvas pixels per light texel, on each axis
+static const int LIGHT_LUT_SIZE = 256;
+
+struct LightBuffer {
+    u16 * texels; //[(y * width + x) * 4 + channel], rgb and a fourth channel that's always 0
+    int width, height; //in texels
+    Color lutColor; //the color `lut` was built for
+    u64 lut[LIGHT_LUT_SIZE + 1]; //a texel's worth of light at each squared distance from the center, 0 past the edge
+};
+
+LightBuffer make_light_buffer(int canvasWidth, int canvasHeight);
+void free_light_buffer(LightBuffer & lights);
+void clear_light_buffer(LightBuffer & lights);
+
+//accumulates a light the same shape and brightness as `add_light(canvas, ...)`, the coordinates are in canvas pixels
+//NOTE: building the falloff table is cached on the color, so lights of the same color should be added together
+void add_light(LightBuffer & lights, float x0, float y0, float w, float h, Color color);
+
+//adds the lights, upsampled bilinearly, onto the canvas from `canvas.top` down
+//NOTE: this only reads the light buffer, so different bands of a canvas can be lit at the same time
+void composite_lights(Canvas & canvas, LightBuffer & lights);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// FONT OPS                                                                                                         ///
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -567,21 +359,25 @@ static inline MonoFont load_mono_font(const char * filepath, int rows, int colum
     return font;
 }
 
+//blends `color` over every pixel of the canvas where the (pitch * height) mask is nonzero
+void _draw_coverage(Canvas & canvas, u8 * mask, int width, int height, int pitch, int cx, int cy, Color color);
+
 static inline void draw_glyph(Canvas & canvas, MonoFont & font, int cx, int cy, Color color, int glyph) {
     int row = glyph / font.columns;
     int col = glyph % font.columns;
     int srcx = col * font.glyphWidth;
     int srcy = row * font.glyphHeight;
+    _draw_coverage(canvas, font.pixels + srcy * font.textureWidth + srcx,
+        font.glyphWidth, font.glyphHeight, font.textureWidth, cx, cy, color);
+}
 
-    //"blit" glyph to the screen
-    for (int y = 0; y < font.glyphHeight; ++y) {
-        for (int x = 0; x < font.glyphWidth; ++x) {
-            int idx = (srcy + y) * font.textureWidth + (srcx + x);
-            if (font.pixels[idx]) {
-                blend(canvas, cx + x, cy + y, color);
-            }
-        }
-    }
+//the glyph that's drawn on the line below a character to extend it below the baseline, or -1 if it doesn't have one
+static inline int descender_glyph(char c) {
+    if (c == 'g' || c == 'y') return 16;
+    if (c == 'j') return 19;
+    if (c == 'p') return 17;
+    if (c == 'q') return 18;
+    return -1;
 }
 
 static inline void draw_text(Canvas & canvas, MonoFont & font, int cx, int cy, Color color, const char * text) {
@@ -589,14 +385,9 @@ static inline void draw_text(Canvas & canvas, MonoFont & font, int cx, int cy, C
         draw_glyph(canvas, font, cx + i * font.glyphWidth, cy, color, text[i]);
 
         //draw extenders
-        if (text[i] == 'g' || text[i] == 'y') {
-            draw_glyph(canvas, font, cx + i * font.glyphWidth, cy + font.glyphHeight, color, 16);
-        } else if (text[i] == 'j') {
-            draw_glyph(canvas, font, cx + i * font.glyphWidth, cy + font.glyphHeight, color, 19);
-        } else if (text[i] == 'p') {
-            draw_glyph(canvas, font, cx + i * font.glyphWidth, cy + font.glyphHeight, color, 17);
-        } else if (text[i] == 'q') {
-            draw_glyph(canvas, font, cx + i * font.glyphWidth, cy + font.glyphHeight, color, 18);
+        int descender = descender_glyph(text[i]);
+        if (descender >= 0) {
+            draw_glyph(canvas, font, cx + i * font.glyphWidth, cy + font.glyphHeight, color, descender);
         }
     }
 }
@@ -609,6 +400,22 @@ static inline void draw_text_right(Canvas & canvas, MonoFont & font, int cx, int
     draw_text(canvas, font, cx - font.glyphWidth * strlen(text), cy, color, text);
 }
 
+//a string rasterized into a coverage mask once, so that text which doesn't change from frame to frame can be drawn
+//as a single masked blit, which looks exactly the same as drawing it glyph by glyph with `draw_text()`
+struct TextRun {
+    MonoFont * font;
+    char * text;
+    u8 * mask; //[y * width + x], nonzero wherever a glyph covers the pixel
+    int width, height; //in pixels, the height includes the second line of glyphs that descenders are drawn with
+};
+
+TextRun make_text_run(MonoFont & font, const char * text);
+void free_text_run(TextRun & run);
+
+static inline void draw_text_run(Canvas & canvas, TextRun & run, int cx, int cy, Color color) {
+    _draw_coverage(canvas, run.mask, run.width, run.height, run.width, cx, cy, color);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// CANVAS OPS                                                                                                       ///
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -629,74 +436,31 @@ static inline Canvas make_canvas(int width, int height, int margin) {
     return canvas;
 }
 
+//puts the canvas on screen through a texture, quad and uniforms that are created once and reused every frame.
+//each frame's pixels are copied into the next of a ring of pixel buffers and uploaded from there with
+//`glTexSubImage2D()`, so the upload can run asynchronously instead of stalling on the draw that read the last one
+//NOTE: the shader's uniforms are only set when they change, so nothing else should use it
+static const int PRESENT_BUFFERS = 3;
+
+struct CanvasPresenter {
+    uint shader;
+    uint tex, vao, vbo;
+    uint pbos[PRESENT_BUFFERS];
+    int nextPbo;
+    int texSizeLoc, scaleLoc;
+    int canvasWidth, canvasHeight, canvasMargin; //the canvas layout the texture and buffers were allocated for
+    float windowWidth, windowHeight; //the window size the quad was last laid out for
+};
+
+CanvasPresenter make_canvas_presenter(uint shader);
+void free_canvas_presenter(CanvasPresenter & presenter);
+
 //TODO: improve pixel blending by using an SRGB texture
-static inline void draw_canvas(int shader, Canvas & canvas, float ww, float wh) {
-    uint tex;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    int w = canvas.width + canvas.margin * 2, h = canvas.height + canvas.margin * 2;
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, canvas.basePointer());
-
-    //NOTE: this still doesn't actually work to get rid of scaling artifacts
-    //      except at 2x scale where it kinda sorta accidentally mostly works by happenstance
-    float u1 = canvas.margin / (float) w - 0.5f / ww;
-    float v1 = canvas.margin / (float) h - 0.5f / wh;
-    float u2 = 1 - u1 - 1.0f / ww;
-    float v2 = 1 - v1 - 1.0f / wh;
-
-    float x = fminf(1, (wh / ww) / (canvas.height / (float) canvas.width));
-    float y = fminf(1, (ww / wh) / (canvas.width / (float) canvas.height));
-
-    struct TexVert { Vec2 pos, uv; };
-    TexVert verts[6] = {
-        { vec2(-x,  y), vec2(u1, v1) },
-        { vec2( x,  y), vec2(u2, v1) },
-        { vec2( x, -y), vec2(u2, v2) },
-        { vec2(-x,  y), vec2(u1, v1) },
-        { vec2( x, -y), vec2(u2, v2) },
-        { vec2(-x, -y), vec2(u1, v2) },
-    };
+void draw_canvas(CanvasPresenter & presenter, Canvas & canvas, float ww, float wh);
 
-    uint vao, vbo;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_DYNAMIC_DRAW);
-
-    //setup vertex attributes
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TexVert), (void *) offsetof(TexVert, pos));
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TexVert), (void *) offsetof(TexVert, uv));
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-
-    //bind texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
-
-    //set uniforms and draw
-    glUseProgram(shader);
-    int texSizeLoc = glGetUniformLocation(shader, "texSize");
-    glUniform2f(texSizeLoc, w, h);
-    int scaleLoc = glGetUniformLocation(shader, "scale");
-    float scale = fminf(ww / canvas.width, wh / canvas.height);
-    glUniform1f(scaleLoc, scale);
-    glDrawArrays(GL_TRIANGLES, 0, ARR_SIZE(verts));
-
-    //delete temp resources
-    glDeleteTextures(1, &tex);
-    glDeleteBuffers(1, &vbo);
-    glDeleteVertexArrays(1, &vao);
-
-    gl_error("draw_canvas()");
-}
+//the headless counterparts of `draw_canvas()`, for machines with no window or GL: these write the visible part
+//of the canvas to a file as tightly packed RGBA rows, either raw or as a PNG, and return false if that failed
+bool write_canvas_raw(Canvas & canvas, const char * path);
+bool write_canvas_png(Canvas & canvas, const char * path);
 
 #endif //PIXEL_HPP
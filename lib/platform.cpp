@@ -77,6 +77,35 @@ void set_current_working_directory(const char * path) {
     assert(SetCurrentDirectory(path));
 }
 
+MappedFile map_entire_file(const char * filepath) {
+    HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return {};
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return {};
+    }
+
+    //NOTE: the view keeps the mapping (and the file) alive, so both handles can be closed right away
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return {};
+    void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) return {};
+    return { (const char *) data, (size_t) size.QuadPart };
+}
+
+void unmap_file(MappedFile & file) {
+    if (file.data) UnmapViewOfFile(file.data);
+    file = {};
+}
+
+//moves `from` over `to`, replacing it if it exists
+static bool replace_file(const char * from, const char * to) {
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+}
+
 void handle_dpi_awareness() {
     //NOTE: SetProcessDpiAwarenessContext isn't available on targets older than win10-1703
     //      and will therefore crash at startup on those systems if we call it normally,
@@ -141,6 +170,8 @@ void handle_dpi_awareness() {
 #include <errno.h>
 #include <dirent.h>
 #include <unistd.h> //chdir
+#include <fcntl.h> //open
+#include <sys/mman.h> //mmap
 
 //returns true on success
 bool create_dir_if_not_exist(const char * dirpath) {
@@ -192,6 +223,32 @@ void set_current_working_directory(const char * path) {
     assert(!chdir(path));
 }
 
+MappedFile map_entire_file(const char * filepath) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return {};
+    struct stat s;
+    if (fstat(fd, &s) || s.st_size == 0) {
+        close(fd);
+        return {};
+    }
+
+    //NOTE: the mapping stays valid after the file descriptor is closed
+    void * data = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return {};
+    return { (const char *) data, (size_t) s.st_size };
+}
+
+void unmap_file(MappedFile & file) {
+    if (file.data) munmap((void *) file.data, file.size);
+    file = {};
+}
+
+//moves `from` over `to`, replacing it if it exists
+static bool replace_file(const char * from, const char * to) {
+    return rename(from, to) == 0;
+}
+
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -211,6 +268,10 @@ bool is_directory(const char * filepath) {
     struct stat s;
     return stat(filepath, &s) == 0 && (s.st_mode & S_IFMT) == S_IFDIR;
 }
+long long file_modified_time(const char * filepath) {
+    struct stat s;
+    return stat(filepath, &s) == 0? s.st_mtime : 0;
+}
 
 //NOTE: the correct behavior of this function is unfortunately not guaranteed by the standard
 char * read_entire_file(const char * filepath, long *fileLength) {
@@ -268,6 +329,14 @@ bool write_entire_file(const char * filepath, const char * string, int len) {
     return true;
 }
 
+bool replace_entire_file(const char * filepath, const char * string, int len) {
+    char * tempPath = dsprintf(nullptr, "%s.tmp", filepath);
+    bool success = write_entire_file(tempPath, string, len) && replace_file(tempPath, filepath);
+    if (!success) remove(tempPath);
+    free(tempPath);
+    return success;
+}
+
 static void recursive_flatten(List<char *> & out, List<DirEnt> dir, const char * path) {
     for (DirEnt ent : dir) {
         if (ent.isDir) {
@@ -16,7 +16,20 @@ void deep_finalize(List<DirEnt> & dir);
 bool file_exists(const char * filepath);
 bool is_directory(const char * filepath);
 char * read_entire_file(const char * filepath, long * fileLength = nullptr);
-bool write_entire_file(const char * filepath, const char * string, int len = -1); //TODO: semi-atomic version of this?
+bool write_entire_file(const char * filepath, const char * string, int len = -1);
+//writes to a temporary file next to `filepath` and then moves it into place, so that a crash while writing
+//never leaves a half written `filepath` behind
+bool replace_entire_file(const char * filepath, const char * string, int len = -1);
+long long file_modified_time(const char * filepath); //in seconds since some epoch, returns 0 if the file doesn't exist
+
+//a read-only view of a whole file, which stays valid until it's unmapped
+struct MappedFile {
+    const char * data;
+    size_t size;
+};
+
+MappedFile map_entire_file(const char * filepath); //returns a null `data` pointer on failure
+void unmap_file(MappedFile & file);
 void view_file_in_system_file_browser(const char * path);
 void open_folder_in_system_file_browser(const char * path);
 void set_current_working_directory(const char * path);
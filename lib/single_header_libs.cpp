@@ -7,3 +7,6 @@
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 static uint64_t nanoStart;
 static uint64_t tscStart;
@@ -39,6 +40,10 @@ TraceEvent * instantEventList;
 TraceEvent * instantEventHead;
 TraceEvent * instantEventEnd;
 
+int traceBufferWraps;
+
+thread_local bool isTraceThread;
+
 void init_profiling_trace() {
 	#ifdef _WIN32
 		LARGE_INTEGER counter;
@@ -50,6 +55,7 @@ void init_profiling_trace() {
 		nanoStart = now.tv_sec * 1'000'000'000LL + now.tv_nsec;
 	#endif
 	tscStart = __rdtsc();
+	isTraceThread = true;
 
 	const size_t NUM_TRACE_EVENTS = 1024 * 1024;
 
@@ -110,3 +116,72 @@ void print_profiling_trace() {
 	}
 	fclose(out);
 }
+
+//throws away all events recorded so far, e.g. so that a benchmark doesn't count its own setup time
+void reset_profiling_trace() {
+	beginEventHead = beginEventList;
+	endEventHead = endEventList;
+	instantEventHead = instantEventList;
+	traceBufferWraps = 0;
+}
+
+//prints the total time spent in each named scope, instead of writing out the whole timeline
+void print_profiling_summary() {
+	uint64_t diffTime = get_nanos();
+	double elapsedSeconds = diffTime / 1'000'000'000.0;
+	double tscPerNano = (__rdtsc() - tscStart) / elapsedSeconds / 1'000'000'000;
+
+	struct Entry { const char * name; uint64_t count; uint64_t tsc; };
+	Entry entries[128];
+	int entryCount = 0;
+
+	//replay the events in timestamp order, matching each end event to the innermost open begin event
+	TraceEvent * stack[256];
+	int depth = 0;
+	int unmatchedEnds = 0;
+	TraceEvent * begin = beginEventList;
+	TraceEvent * end = endEventList;
+	while (begin != beginEventHead || end != endEventHead) {
+		if (end == endEventHead || (begin != beginEventHead && begin->timestamp < end->timestamp)) {
+			if (depth < 256) stack[depth] = begin;
+			++depth;
+			++begin;
+		} else {
+			//NOTE: an end event with no matching begin event means the buffers wrapped around, so we skip it
+			if (depth == 0) ++unmatchedEnds;
+			if (depth > 0 && --depth < 256) {
+				Entry * entry = nullptr;
+				for (int i = 0; i < entryCount; ++i) {
+					if (!strcmp(entries[i].name, stack[depth]->name)) {
+						entry = &entries[i];
+						break;
+					}
+				}
+				if (!entry && entryCount < 128) {
+					entry = &entries[entryCount++];
+					*entry = { stack[depth]->name };
+				}
+				if (entry) {
+					entry->count += 1;
+					entry->tsc += end->timestamp - stack[depth]->timestamp;
+				}
+			}
+			++end;
+		}
+	}
+
+	//NOTE: the buffers start over from scratch when one fills up, rather than acting as a ring buffer,
+	//		so after a wrap the summary is missing everything before it, and scopes that were open at the time
+	//		(like an enclosing loop) are missing entirely since their end events are the ones skipped above
+	if (traceBufferWraps) {
+		printf("WARNING: the trace buffers filled up and started over (%d wraps), so this summary only covers the last "
+			"%lld scopes and leaves out %d that were open at the time\n",
+			traceBufferWraps, (long long) (beginEventHead - beginEventList), unmatchedEnds);
+	}
+	printf("%-40s %10s %12s %12s\n", "scope", "count", "total ms", "avg ns");
+	for (int i = 0; i < entryCount; ++i) {
+		double nanos = entries[i].tsc / tscPerNano;
+		printf("%-40s %10llu %12.3f %12.1f\n", entries[i].name, (unsigned long long) entries[i].count,
+			nanos / 1'000'000, nanos / entries[i].count);
+	}
+}
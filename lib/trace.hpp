@@ -2,6 +2,7 @@
 #define TRACE_HPP
 
 #include <stdint.h>
+#include <x86intrin.h> //__rdtsc
 
 struct TraceEvent {
     const char * name;
@@ -20,25 +21,40 @@ extern TraceEvent * instantEventList;
 extern TraceEvent * instantEventHead;
 extern TraceEvent * instantEventEnd;
 
+//how many times the event buffers filled up and started over since the last reset, throwing away everything before
+extern int traceBufferWraps;
+
+//NOTE: the event buffers aren't thread-safe, so only the thread that called `init_profiling_trace()` records events,
+//      and timers on any other thread are no-ops
+extern thread_local bool isTraceThread;
+
 void init_profiling_trace();
+void reset_profiling_trace();
 void print_profiling_trace();
+void print_profiling_summary();
 
 static inline __attribute__((always_inline)) void trace_begin_event(const char * name) {
+    if (!isTraceThread) return;
     *beginEventHead++ = { name, __rdtsc() };
     if (beginEventHead == beginEventEnd)
-        { beginEventHead = beginEventList; endEventHead = endEventList; instantEventHead = instantEventList; }
+        { beginEventHead = beginEventList; endEventHead = endEventList; instantEventHead = instantEventList;
+          ++traceBufferWraps; }
 }
 
 static inline __attribute__((always_inline)) void trace_end_event(const char * name) {
+    if (!isTraceThread) return;
     *endEventHead++ = { name, __rdtsc() };
     if (endEventHead == endEventEnd)
-        { beginEventHead = beginEventList; endEventHead = endEventList; instantEventHead = instantEventList; }
+        { beginEventHead = beginEventList; endEventHead = endEventList; instantEventHead = instantEventList;
+          ++traceBufferWraps; }
 }
 
 static inline __attribute__((always_inline)) void trace_instant_event(const char * name) {
+    if (!isTraceThread) return;
     *instantEventHead++ = { name, __rdtsc() };
     if (instantEventHead == instantEventEnd)
-        { beginEventHead = beginEventList; endEventHead = endEventList; instantEventHead = instantEventList; }
+        { beginEventHead = beginEventList; endEventHead = endEventList; instantEventHead = instantEventList;
+          ++traceBufferWraps; }
 }
 
 struct ScopedTraceTimer {
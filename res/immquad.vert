@@ -0,0 +1,27 @@
+#version 330
+
+// one quad per instance, with its corners coming from the vertex index in a 4 vertex triangle strip
+layout (location = 0) in vec4 inRect; // x, y, width, height in eighths of a pixel
+layout (location = 1) in vec4 inTexRect; // u, v, width, height in texels
+layout (location = 2) in vec4 inColor;
+
+out vec4 color;
+out vec2 coords;
+out float factor;
+
+uniform mat4 transform;
+uniform vec2 scale;
+uniform float depth; // of the first quad in the batch, each one after it is a step closer
+
+const float DEPTH_STEP = 1.0 / 16384.0; // same as IMM_DEPTH_STEP
+
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 position = (inRect.xy + corner * inRect.zw) * 0.125;
+    gl_Position = transform * vec4(position, depth - gl_InstanceID * DEPTH_STEP, 1);
+    gl_Position.y = -gl_Position.y;
+
+    color = inColor;
+    coords = (inTexRect.xy + corner * inTexRect.zw) * scale;
+    factor = 1;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 330
+
+in vec2 local;
+flat in vec3 shape;
+flat in vec4 neighbors;
+flat in vec2 joined;
+in vec4 color;
+
+out vec4 outColor;
+
+float segment_distance(vec2 p, vec2 a, vec2 b) {
+    vec2 ab = b - a;
+    return length(p - a - ab * clamp(dot(p - a, ab) / dot(ab, ab), 0, 1));
+}
+
+void main() {
+    // distance to the segment, then how far outside the shape's edge that is, in pixels
+    float d = length(vec2(max(max(-local.x, local.x - shape.x), 0), local.y));
+    float edge = shape.z > 0 ? max(d - shape.y, shape.z - d) : d - shape.y;
+    float coverage = clamp(0.5 - edge / length(dFdx(local)), 0, 1);
+    if (coverage <= 0) discard;
+
+    // the legs of a line overlap where they join, so each pixel there is left to whichever leg is closest to it
+    // (the earlier one on a tie), which draws it with the coverage of the whole line
+    // NOTE: legs that aren't next to each other can still overlap, where a very short leg makes a tight turn
+    if (joined.x > 0 && segment_distance(local, neighbors.xy, vec2(0)) <= d) discard;
+    if (joined.y > 0 && segment_distance(local, vec2(shape.x, 0), neighbors.zw) < d) discard;
+
+    float gamma = 2.2;
+    outColor = vec4(pow(color.rgb, vec3(gamma)), color.a * coverage);
+}
\ No newline at end of file
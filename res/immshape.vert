@@ -0,0 +1,37 @@
+#version 330
+
+// one shape per instance, drawn on the quad around its segment, lined up with it
+layout (location = 0) in vec4 inEnds; // x1, y1, x2, y2
+layout (location = 1) in vec4 inNeighbors; // start of the leg before, end of the leg after, or the segment's own ends
+layout (location = 2) in vec3 inShape; // radius, inner radius, depth
+layout (location = 3) in vec4 inColor;
+
+out vec2 local; // position along and across the segment, from its first end
+flat out vec3 shape; // length, radius, inner radius
+flat out vec4 neighbors; // the neighboring legs' far ends, in the same space as `local`
+flat out vec2 joined; // whether there is a leg before and a leg after
+out vec4 color;
+
+uniform mat4 transform;
+uniform float pixelSize; // how far a pixel on screen is in the units the shape is in
+
+void main() {
+    vec2 axis = inEnds.zw - inEnds.xy;
+    float len = length(axis);
+    vec2 along = len > 0 ? axis / len : vec2(1, 0);
+    vec2 across = vec2(-along.y, along.x);
+
+    // a pixel of margin around the radius for the antialiasing
+    float extent = inShape.x + pixelSize;
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    local = vec2(mix(-extent, len + extent, corner.x), mix(-extent, extent, corner.y));
+    vec2 position = inEnds.xy + along * local.x + across * local.y;
+    gl_Position = transform * vec4(position, inShape.z, 1);
+    gl_Position.y = -gl_Position.y;
+
+    shape = vec3(len, inShape.xy);
+    vec2 prev = inNeighbors.xy - inEnds.xy, next = inNeighbors.zw - inEnds.xy;
+    neighbors = vec4(dot(prev, along), dot(prev, across), dot(next, along), dot(next, across));
+    joined = vec2(inNeighbors.xy != inEnds.xy, inNeighbors.zw != inEnds.zw);
+    color = inColor;
+}
\ No newline at end of file
@@ -0,0 +1,1424 @@
+#include "bench.hpp"
+#include "level.hpp"
+#include "trace.hpp"
+#include "cpu.hpp"
+#include "pregen.hpp"
+#include "jobs.hpp"
+#include "render.hpp"
+#include "common.hpp"
+#include "platform.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// SCRIPTED INPUT                                                                                                   ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//a real player dies within seconds, after which most of the simulation goes quiet,
+//so instead we fly the player through the middle of the level at a constant speed and revive them every tick.
+//this way every tick does a representative amount of work and the results are comparable between runs
+static const float AUTOPILOT_SPEED = 30; //units per second
+
+static void autopilot(Level & level, int tickIndex) {
+    float t = tickIndex * TICK_LENGTH;
+    level.player.dead = false;
+    level.player.pos = vec2(level.playerStartPos.x + t * AUTOPILOT_SPEED, level.tiles.height * UNITS_PER_TILE * 0.5f);
+    level.player.vel = vec2(AUTOPILOT_SPEED, 0);
+}
+
+//sweeps the shield back and forth so that it actually gets hit by bullets
+static TickInput scripted_input(int tickIndex) {
+    float t = tickIndex * TICK_LENGTH;
+    TickInput input = {};
+    input.mouseMotion = coord2(lroundf(cosf(t * 3) * 30), lroundf(sinf(t * 2) * 30));
+    return input;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// HEADLESS MODES                                                                                                   ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int run_simulation_benchmark(int ticks, int seed) {
+    uint64_t initStart = get_nanos();
+    Level level = init_level(seed); //the first level also loads the section prefabs
+    uint64_t initTime = get_nanos() - initStart;
+    start_level_pregen(seed + 1);
+    List<GameEvent> events = {};
+    Coord2 viewSize = coord2(CANVAS_WIDTH, CANVAS_HEIGHT);
+
+    int eventCount = 0;
+    reset_profiling_trace(); //don't count level init
+    uint64_t start = get_nanos();
+    for (int i = 0; i < ticks; ++i) { TimeScope("tick loop")
+        autopilot(level, i);
+        tick_level(level, scripted_input(i), TICK_LENGTH, viewSize, events);
+        eventCount += events.len;
+        events.len = 0;
+    }
+    uint64_t elapsed = get_nanos() - start;
+
+    //restart the way the game does, by which point the next level has long since been generated in the background
+    int runTableLen = (level.tiles.width + RUN_TABLE_GRANULARITY - 1) / RUN_TABLE_GRANULARITY;
+    int runCount = level.tiles.runCount, enemyCount = level.enemies.len, walkerCount = level.walkers.len;
+    int bulletCount = level.bullets.len;
+    uint64_t restartStart = get_nanos();
+    swap_in_pregenerated_level(level, seed + 2);
+    uint64_t restartTime = get_nanos() - restartStart;
+
+    printf("[] headless simulation: %d ticks (%.1f seconds of game time), seed %d\n", ticks, ticks * TICK_LENGTH, seed);
+    printf("[] level init: %.3f ms first time, %.3f ms on restart (pregenerated)\n",
+        initTime / 1'000'000.0, restartTime / 1'000'000.0);
+    printf("[] level layout: %d section runs, %.1f KB\n", runCount,
+        (runCount * sizeof(SectionRun) + runTableLen * sizeof(u16)) / 1024.0);
+    printf("[] %.0f ticks/sec, %.0f ns/tick\n", ticks / (elapsed / 1'000'000'000.0), elapsed / (double) ticks);
+    printf("[] final state: %d enemies, %d walkers, %d bullets, %d events fired\n",
+        enemyCount, walkerCount, bulletCount, eventCount);
+    print_profiling_summary();
+    events.finalize();
+    retire_level(level);
+    return 0;
+}
+
+static BulletPool make_random_bullets(int count) {
+    BulletPool pool = {};
+    for (int i = 0; i < count; ++i) {
+        Vec2 dir = noz(vec2(rand_float(-1, 1), rand_float(-1, 1)));
+        pool.add(vec2(rand_float(-50, 50), rand_float(-50, 50)), dir * rand_float(BULLET_VEL_MIN, BULLET_VEL_MAX));
+    }
+    return pool;
+}
+
+//times the bullet integration kernel on each code path the CPU supports, across a range of bullet counts,
+//and checks that every vector path produces bit-identical results to the scalar path
+static int run_bullet_benchmark(int seed) {
+    static const int counts[] = { 100, 300, 1000, 3000, 10000, 30000, 100000 };
+    static const int UPDATES_PER_RUN = 20'000'000; //bullet updates per measurement, so small counts get enough reps
+    SimdLevel maxLevel = max_simd_level();
+    bool mismatch = false;
+
+    printf("[] bullet integration benchmark, max simd level: %s\n", simdLevelNames[maxLevel]);
+    printf("%-10s", "bullets");
+    for (int level = 0; level <= maxLevel; ++level) printf("%18s", dsprintf(nullptr, "%s ns/bullet", simdLevelNames[level]));
+    printf("\n");
+
+    for (int count : counts) {
+        int reps = UPDATES_PER_RUN / count;
+        BulletPool results[SIMD_LEVEL_COUNT] = {};
+        printf("%-10d", count);
+        for (int level = 0; level <= maxLevel; ++level) {
+            global_pcg_state = seed;
+            BulletPool pool = make_random_bullets(count);
+            set_simd_level((SimdLevel) level);
+            uint64_t start = get_nanos();
+            for (int rep = 0; rep < reps; ++rep) {
+                integrate_bullets(pool, TICK_LENGTH, vec2(0, 0), 1000);
+            }
+            uint64_t elapsed = get_nanos() - start;
+            printf("%18.3f", elapsed / ((double) reps * count));
+            results[level] = pool;
+        }
+        printf("\n");
+
+        for (int level = 1; level <= maxLevel; ++level) {
+            BulletPool & a = results[0], & b = results[level];
+            if (memcmp(a.posx, b.posx, count * sizeof(float)) || memcmp(a.posy, b.posy, count * sizeof(float)) ||
+                memcmp(a.velx, b.velx, count * sizeof(float)) || memcmp(a.vely, b.vely, count * sizeof(float)) ||
+                memcmp(a.despawn, b.despawn, count))
+            {
+                printf("[] ERROR: %s path does not match scalar path at %d bullets\n", simdLevelNames[level], count);
+                mismatch = true;
+            }
+        }
+        for (int level = 0; level <= maxLevel; ++level) results[level].finalize();
+    }
+
+    set_simd_level(maxLevel);
+    return mismatch? 1 : 0;
+}
+
+//every sprite blitter variant, so the benchmark can loop over them
+enum SpriteOp { OP_BLEND, OP_FLIP, OP_FADE, OP_SILHOUETTE, OP_A1, OP_COUNT };
+static const char * spriteOpNames[OP_COUNT] = { "blend", "flip", "fade", "silhouette", "a1" };
+
+static void draw_sprite_op(SpriteOp op, Canvas & canvas, Image & sprite, int cx, int cy, Color fill, float alpha) {
+    Pixel * p = sprite.pixels;
+    int w = sprite.width, h = sprite.height;
+    switch (op) {
+        case OP_BLEND: _draw_sprite(canvas, p, w, h, w, cx, cy); break;
+        case OP_FLIP: _draw_sprite_flip(canvas, p, w, h, w, cx, cy, true); break;
+        case OP_FADE: _draw_sprite(canvas, p, w, h, w, cx, cy, alpha); break;
+        case OP_SILHOUETTE: _draw_sprite_silhouette(canvas, p, w, h, w, cx, cy, fill); break;
+        default: _draw_sprite_a1(canvas, p, w, h, w, cx, cy); break;
+    }
+}
+
+//random pixels, biased towards the alpha values that sprites actually have and the ones right at the thresholds
+static Pixel random_pixel() {
+    static const u8 alphas[] = { 0, 0, 255, 255, 127, 128, 1, 254 };
+    Pixel p = { (u8) rand_int(256), (u8) rand_int(256), (u8) rand_int(256), (u8) rand_int(256) };
+    if (rand_int(2)) p.a = alphas[rand_int(ARR_SIZE(alphas))];
+    return p;
+}
+
+static Image make_random_sprite(int width, int height) {
+    Image image = { (Pixel *) malloc(width * height * sizeof(Pixel)), width, height };
+    for (int i = 0; i < width * height; ++i) image.pixels[i] = random_pixel();
+    return image;
+}
+
+//checks every vector blitter against the scalar one on random sprites drawn at random places on small canvases
+//(so that most of them get clipped), where each canvas is a window into a bigger buffer so that writes outside the
+//canvas are caught too, then times each blitter drawing 16x16 tiles and 48x48 sprites onto a full-size canvas
+static int run_blit_benchmark(int seed) {
+    static const int CASES = 20000;
+    static const int SPRITES_PER_RUN = 200000;
+    static const int BUFFER_WIDTH = 96, BUFFER_HEIGHT = 80;
+    SimdLevel maxLevel = max_simd_level();
+    global_pcg_state = seed;
+
+    printf("[] sprite blit benchmark, max simd level: %s\n", simdLevelNames[maxLevel]);
+    int mismatches = 0;
+    Pixel * initial = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * buffers[SIMD_LEVEL_COUNT] = {};
+    for (Pixel *& buffer : buffers) buffer = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    for (int i = 0; i < CASES; ++i) {
+        SpriteOp op = (SpriteOp) rand_int(OP_COUNT);
+        Image sprite = make_random_sprite(rand_int(1, 41), rand_int(1, 41));
+        int canvasWidth = rand_int(1, 65), canvasHeight = rand_int(1, 49);
+        int canvasX = rand_int(1 + BUFFER_WIDTH - canvasWidth), canvasY = rand_int(1 + BUFFER_HEIGHT - canvasHeight);
+        int cx = rand_int(-sprite.width - 2, canvasWidth + 3), cy = rand_int(-sprite.height - 2, canvasHeight + 3);
+        Color fill = random_pixel();
+        float alpha = rand_float();
+
+        for (int j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; ++j) initial[j] = random_pixel();
+        for (int level = 0; level <= maxLevel; ++level) {
+            memcpy(buffers[level], initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+            Canvas canvas = { buffers[level] + canvasY * BUFFER_WIDTH + canvasX, canvasWidth, canvasHeight, BUFFER_WIDTH, 0 };
+            set_simd_level((SimdLevel) level);
+            draw_sprite_op(op, canvas, sprite, cx, cy, fill, alpha);
+        }
+        for (int level = 1; level <= maxLevel; ++level) {
+            if (memcmp(buffers[0], buffers[level], BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel))) {
+                if (mismatches < 10) {
+                    printf("[] ERROR: %s %s blit does not match scalar: %dx%d sprite at %d,%d on %dx%d canvas\n",
+                        simdLevelNames[level], spriteOpNames[op], sprite.width, sprite.height, cx, cy,
+                        canvasWidth, canvasHeight);
+                }
+                mismatches += 1;
+            }
+        }
+        free(sprite.pixels);
+    }
+    for (Pixel * buffer : buffers) free(buffer);
+    free(initial);
+    printf("[] %d random blits checked, %d mismatches\n", CASES, mismatches);
+
+    Canvas canvas = make_canvas(640, 360, 16);
+    Image sizes[2] = { make_random_sprite(16, 16), make_random_sprite(48, 48) };
+    List<Coord2> positions = {};
+    for (int i = 0; i < SPRITES_PER_RUN; ++i) positions.add(coord2(rand_int(-24, 640), rand_int(-24, 360)));
+
+    printf("%-12s%-8s", "op", "size");
+    for (int level = 0; level <= maxLevel; ++level) printf("%16s", dsprintf(nullptr, "%s ns/px", simdLevelNames[level]));
+    printf("\n");
+    for (int op = 0; op < OP_COUNT; ++op) {
+        for (Image & sprite : sizes) {
+            printf("%-12s%-8s", spriteOpNames[op], dsprintf(nullptr, "%dx%d", sprite.width, sprite.height));
+            for (int level = 0; level <= maxLevel; ++level) {
+                set_simd_level((SimdLevel) level);
+                uint64_t start = get_nanos();
+                for (Coord2 pos : positions) {
+                    draw_sprite_op((SpriteOp) op, canvas, sprite, pos.x, pos.y, { 255, 0, 0, 128 }, 0.5f);
+                }
+                uint64_t elapsed = get_nanos() - start;
+                printf("%16.3f", elapsed / ((double) SPRITES_PER_RUN * sprite.width * sprite.height));
+            }
+            printf("\n");
+        }
+    }
+
+    positions.finalize();
+    for (Image & sprite : sizes) free(sprite.pixels);
+    free(canvas.basePointer());
+    set_simd_level(maxLevel);
+    return mismatches? 1 : 0;
+}
+
+//the premultiplied blend done one pixel at a time straight from the premultiplied pixels, ignoring the row tables,
+//as a reference for the run-based blitter
+static void draw_premul_per_pixel(Canvas & canvas, Image & image, int cellx, int celly, int cx, int cy, bool flip) {
+    PremulImage & premul = *image.premul;
+    for (int y = imax(canvas.top, cy); y < imin(canvas.height, cy + premul.cellHeight); ++y) {
+        for (int x = imax(0, cx); x < imin(canvas.width, cx + premul.cellWidth); ++x) {
+            int sx = flip? premul.cellWidth - 1 - (x - cx) : x - cx;
+            Pixel s = premul.pixels[0][(celly * premul.cellHeight + y - cy) * image.width + cellx * premul.cellWidth + sx];
+            Pixel & d = canvas[y][x];
+            int inv = 255 - s.a;
+            d = { (u8) (s.r + (d.r * inv + 127) / 255), (u8) (s.g + (d.g * inv + 127) / 255),
+                  (u8) (s.b + (d.b * inv + 127) / 255), (u8) (s.a + (d.a * inv + 127) / 255) };
+        }
+    }
+}
+
+//checks the run-based premultiplied blitter against a per-pixel reference on the game's actual sprites,
+//at random places (so that plenty of them are clipped) and on every SIMD level, then times it against the
+//straight alpha blitter, which blends every pixel of the sprite
+static int run_sprite_benchmark(int seed) {
+    static const int CASES = 20000;
+    static const int SPRITES_PER_RUN = 200000;
+    SimdLevel maxLevel = max_simd_level();
+    global_pcg_state = seed;
+    Graphics graphics = load_graphics();
+    struct { const char * name; Tileset set; } sprites[] = {
+        { "ghost", { graphics.ghost.width, graphics.ghost.height, 1, 1, 0, graphics.ghost } },
+        { "player", { graphics.player.width, graphics.player.height, 1, 1, 0, graphics.player } },
+        { "cursor", { graphics.cursor.width, graphics.cursor.height, 1, 1, 0, graphics.cursor } },
+        { "walker", graphics.walkerWalk },
+        { "walker attack", graphics.walkerAttack },
+        { "ground tiles", graphics.tileset },
+    };
+
+    printf("[] premultiplied sprite benchmark, max simd level: %s\n", simdLevelNames[maxLevel]);
+    Canvas reference = make_canvas(80, 60, 16);
+    Canvas canvas = make_canvas(80, 60, 16);
+    Pixel * background = (Pixel *) malloc(canvas.width * canvas.height * sizeof(Pixel));
+    int mismatches = 0;
+    for (int i = 0; i < CASES; ++i) {
+        auto & sprite = sprites[rand_int(ARR_SIZE(sprites))];
+        int tx = rand_int(sprite.set.width), ty = rand_int(sprite.set.height);
+        int cx = rand_int(-sprite.set.tileWidth, canvas.width + 1), cy = rand_int(-sprite.set.tileHeight, canvas.height + 1);
+        bool flip = rand_int(2);
+        for (int j = 0; j < canvas.width * canvas.height; ++j) background[j] = random_pixel();
+
+        for (int y = 0; y < canvas.height; ++y) memcpy(reference[y], background + y * canvas.width, canvas.width * 4);
+        draw_premul_per_pixel(reference, sprite.set.image, tx, ty, cx, cy, flip);
+        for (int level = 0; level <= maxLevel; ++level) {
+            set_simd_level((SimdLevel) level);
+            for (int y = 0; y < canvas.height; ++y) memcpy(canvas[y], background + y * canvas.width, canvas.width * 4);
+            draw_tile_flip(canvas, sprite.set, tx, ty, cx, cy, flip);
+            for (int y = 0; y < canvas.height; ++y) {
+                if (memcmp(reference[y], canvas[y], canvas.width * sizeof(Pixel))) {
+                    if (mismatches < 10) {
+                        printf("[] ERROR: %s %s tile %d,%d%s at %d,%d does not match the per-pixel reference\n",
+                            simdLevelNames[level], sprite.name, tx, ty, flip? " flipped" : "", cx, cy);
+                    }
+                    mismatches += 1;
+                    break;
+                }
+            }
+        }
+    }
+    printf("[] %d random blits checked, %d mismatches\n", CASES, mismatches);
+    free(background);
+    free(reference.basePointer());
+    free(canvas.basePointer());
+
+    Canvas screen = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    List<Coord2> positions = {};
+    for (int i = 0; i < SPRITES_PER_RUN; ++i) positions.add(coord2(rand_int(-24, CANVAS_WIDTH), rand_int(-24, CANVAS_HEIGHT)));
+    set_simd_level(maxLevel);
+    printf("%-16s%-8s%12s%20s%20s\n", "sprite", "size", "opaque", "straight ns/sprite", "premul ns/sprite");
+    for (auto & sprite : sprites) {
+        Tileset & set = sprite.set;
+        int opaque = 0, transparent = 0;
+        for (int y = 0; y < set.tileHeight; ++y) {
+            for (int x = 0; x < set.tileWidth; ++x) {
+                u8 a = set.image[y][x].a;
+                opaque += a == 255;
+                transparent += a == 0;
+            }
+        }
+
+        uint64_t start = get_nanos();
+        for (int i = 0; i < SPRITES_PER_RUN; ++i) {
+            _draw_sprite(screen, set.image.pixels, set.tileWidth, set.tileHeight, set.image.width, positions[i].x, positions[i].y);
+        }
+        uint64_t straightTime = get_nanos() - start;
+
+        start = get_nanos();
+        for (int i = 0; i < SPRITES_PER_RUN; ++i) {
+            draw_tile_flip(screen, set, 0, 0, positions[i].x, positions[i].y, i & 1);
+        }
+        uint64_t premulTime = get_nanos() - start;
+
+        printf("%-16s%-8s%11.0f%%%20.1f%20.1f\n", sprite.name, dsprintf(nullptr, "%dx%d", set.tileWidth, set.tileHeight),
+            100.0 * opaque / (set.tileWidth * set.tileHeight),
+            straightTime / (double) SPRITES_PER_RUN, premulTime / (double) SPRITES_PER_RUN);
+    }
+    positions.finalize();
+    free(screen.basePointer());
+    return mismatches? 1 : 0;
+}
+
+//the original flat triangle fill, which evaluates all three edge functions from scratch at every pixel of the
+//bounding box and draws pixels on every edge, kept to time the rasterizer against
+static void draw_triangle_cross_products(Canvas & canvas, Coord2 p[3], Color c) {
+    int minx = imax(0, imin(p[0].x, imin(p[1].x, p[2].x)));
+    int miny = imax(canvas.top, imin(p[0].y, imin(p[1].y, p[2].y)));
+    int maxx = imin(canvas.width  - 1, imax(p[0].x, imax(p[1].x, p[2].x)));
+    int maxy = imin(canvas.height - 1, imax(p[0].y, imax(p[1].y, p[2].y)));
+    for (int y = miny; y <= maxy; ++y) {
+        for (int x = minx; x <= maxx; ++x) {
+            int w0 = cross(coord2(x, y) - p[0], p[1] - p[0]);
+            int w1 = cross(coord2(x, y) - p[1], p[2] - p[1]);
+            int w2 = cross(coord2(x, y) - p[2], p[0] - p[2]);
+            if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0)) {
+                canvas[y][x] = c;
+            }
+        }
+    }
+}
+
+//the original textured triangle, which also divides twice per pixel, kept to time the rasterizer against
+static void draw_textured_triangle_divisions(Canvas & canvas, Image & tex, Coord2 p[3], Coord2 uv[3]) {
+    int area = cross(p[0] - p[1], p[2] - p[1]);
+    if (area == 0) return;
+    int minx = imax(0, imin(p[0].x, imin(p[1].x, p[2].x)));
+    int miny = imax(canvas.top, imin(p[0].y, imin(p[1].y, p[2].y)));
+    int maxx = imin(canvas.width - 1, imax(p[0].x, imax(p[1].x, p[2].x)));
+    int maxy = imin(canvas.height - 1, imax(p[0].y, imax(p[1].y, p[2].y)));
+    for (int y = miny; y <= maxy; ++y) {
+        for (int x = minx; x <= maxx; ++x) {
+            int w1 = cross(coord2(x, y) - p[1], p[2] - p[1]);
+            int w2 = cross(coord2(x, y) - p[2], p[0] - p[2]);
+            int w3 = cross(coord2(x, y) - p[0], p[1] - p[0]);
+            if ((w1 >= 0 && w2 >= 0 && w3 >= 0) || (w1 <= 0 && w2 <= 0 && w3 <= 0)) {
+                int u = (w1 * uv[0].x + w2 * uv[1].x + w3 * uv[2].x) / area;
+                int v = (w1 * uv[0].y + w2 * uv[1].y + w3 * uv[2].y) / area;
+                if (u >= 0 && u < tex.width && v >= 0 && v < tex.height) {
+                    unsafe_blend(canvas, x, y, tex[v][u]);
+                }
+            }
+        }
+    }
+}
+
+//the top-left fill rule and texture mapping applied to every pixel of the canvas independently, straight from the
+//definitions, as a reference for the rasterizer. draws a flat color if `tex` is null
+static void draw_triangle_per_pixel(Canvas & canvas, Coord2 p[3], Color color, Image * tex, Coord2 uv[3]) {
+    int area = cross(p[1] - p[0], p[2] - p[0]);
+    if (area == 0) return;
+    int sign = area > 0? 1 : -1;
+    for (int y = canvas.top; y < canvas.height; ++y) {
+        for (int x = 0; x < canvas.width; ++x) {
+            bool inside = true;
+            i64 u = 0, v = 0;
+            for (int i = 0; i < 3; ++i) {
+                Coord2 from = p[(i + 1) % 3], dir = (p[(i + 2) % 3] - from) * sign;
+                int w = cross(dir, coord2(x, y) - from);
+                //with +y pointing down, a left edge points up and a top edge points right
+                bool topLeft = dir.y < 0 || (dir.y == 0 && dir.x > 0);
+                inside &= w > 0 || (w == 0 && topLeft);
+                u += (i64) w * uv[i].x, v += (i64) w * uv[i].y;
+            }
+            if (!inside) continue;
+            if (!tex) {
+                canvas[y][x] = color;
+                continue;
+            }
+            i64 d = area * sign;
+            i64 tu = u / d - (u % d < 0), tv = v / d - (v % d < 0);
+            if (tu >= 0 && tu < tex->width && tv >= 0 && tv < tex->height) unsafe_blend(canvas, x, y, (*tex)[tv][tu]);
+        }
+    }
+}
+
+//checks the triangle rasterizer against a per-pixel reference on random triangles, flat and textured, on random
+//bands of small canvases that are windows into a bigger buffer (so that writes outside the band are caught too),
+//at every SIMD level, then times it against the original per-pixel code on shield-sized and big triangles
+static int run_triangle_benchmark(int seed) {
+    static const int CASES = 20000;
+    static const int TRIANGLES_PER_RUN = 20000;
+    static const int BUFFER_WIDTH = 96, BUFFER_HEIGHT = 80;
+    SimdLevel maxLevel = max_simd_level();
+    global_pcg_state = seed;
+    Image tex = make_random_sprite(24, 24);
+
+    printf("[] triangle rasterizer benchmark, max simd level: %s\n", simdLevelNames[maxLevel]);
+    int mismatches = 0;
+    Pixel * initial = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * reference = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * buffer = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    for (int i = 0; i < CASES; ++i) {
+        int canvasWidth = rand_int(1, 65), canvasHeight = rand_int(1, 49);
+        int canvasX = rand_int(1 + BUFFER_WIDTH - canvasWidth), canvasY = rand_int(1 + BUFFER_HEIGHT - canvasHeight);
+        int size = rand_int(2) ? 8 : 80; //plenty of small triangles, so that edges and corners land on pixels
+        Coord2 p[3], uv[3];
+        for (int j = 0; j < 3; ++j) {
+            p[j] = coord2(rand_int(-size / 2, canvasWidth + size / 2), rand_int(-size / 2, canvasHeight + size / 2));
+            uv[j] = coord2(rand_int(-4, tex.width + 4), rand_int(-4, tex.height + 4));
+        }
+        bool textured = rand_int(2);
+        Color color = random_pixel();
+
+        for (int j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; ++j) initial[j] = random_pixel();
+        memcpy(reference, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+        Canvas canvas = { reference + canvasY * BUFFER_WIDTH + canvasX, canvasWidth, canvasHeight, BUFFER_WIDTH, 0 };
+        canvas.top = rand_int(canvasHeight);
+        draw_triangle_per_pixel(canvas, p, color, textured? &tex : nullptr, uv);
+        for (int level = 0; level <= maxLevel; ++level) {
+            set_simd_level((SimdLevel) level);
+            memcpy(buffer, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+            canvas.pixels = buffer + canvasY * BUFFER_WIDTH + canvasX;
+            if (textured) {
+                draw_textured_triangle(canvas, tex, p[0].x, p[0].y, uv[0].x, uv[0].y,
+                    p[1].x, p[1].y, uv[1].x, uv[1].y, p[2].x, p[2].y, uv[2].x, uv[2].y);
+            } else {
+                draw_triangle(canvas, p[0].x, p[0].y, p[1].x, p[1].y, p[2].x, p[2].y, color);
+            }
+            if (memcmp(reference, buffer, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel))) {
+                if (mismatches < 10) {
+                    printf("[] ERROR: %s %s triangle (%d,%d) (%d,%d) (%d,%d) on %dx%d canvas does not match reference\n",
+                        simdLevelNames[level], textured? "textured" : "flat", p[0].x, p[0].y, p[1].x, p[1].y,
+                        p[2].x, p[2].y, canvasWidth, canvasHeight);
+                }
+                mismatches += 1;
+            }
+        }
+    }
+    free(initial);
+    free(reference);
+    free(buffer);
+    printf("[] %d random triangles checked, %d mismatches\n", CASES, mismatches);
+
+    Canvas screen = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    struct { const char * name; int size; bool textured; } cases[] = {
+        { "flat", 24, false }, { "flat", 240, false }, { "textured", 24, true }, { "textured", 240, true },
+    };
+    set_simd_level(maxLevel);
+    printf("%-12s%-8s%20s%20s\n", "triangle", "size", "per-pixel ns/tri", "rasterizer ns/tri");
+    for (auto & c : cases) {
+        List<Coord2> verts = {};
+        for (int i = 0; i < TRIANGLES_PER_RUN; ++i) {
+            Coord2 center = coord2(rand_int(CANVAS_WIDTH), rand_int(CANVAS_HEIGHT));
+            for (int j = 0; j < 3; ++j) verts.add(center + coord2(rand_int(-c.size / 2, c.size / 2), rand_int(-c.size / 2, c.size / 2)));
+        }
+        Coord2 uv[3] = { coord2(0, 0), coord2(tex.width, 0), coord2(tex.width, tex.height) };
+
+        uint64_t start = get_nanos();
+        for (int i = 0; i < TRIANGLES_PER_RUN; ++i) {
+            if (c.textured) draw_textured_triangle_divisions(screen, tex, &verts[i * 3], uv);
+            else draw_triangle_cross_products(screen, &verts[i * 3], { 128, 255, 128, 255 });
+        }
+        uint64_t oldTime = get_nanos() - start;
+
+        start = get_nanos();
+        for (int i = 0; i < TRIANGLES_PER_RUN; ++i) {
+            Coord2 * p = &verts[i * 3];
+            if (c.textured) {
+                draw_textured_triangle(screen, tex, p[0].x, p[0].y, uv[0].x, uv[0].y,
+                    p[1].x, p[1].y, uv[1].x, uv[1].y, p[2].x, p[2].y, uv[2].x, uv[2].y);
+            } else {
+                draw_triangle(screen, p[0].x, p[0].y, p[1].x, p[1].y, p[2].x, p[2].y, { 128, 255, 128, 255 });
+            }
+        }
+        uint64_t newTime = get_nanos() - start;
+
+        printf("%-12s%-8s%20.1f%20.1f\n", c.name, dsprintf(nullptr, "%d", c.size),
+            oldTime / (double) TRIANGLES_PER_RUN, newTime / (double) TRIANGLES_PER_RUN);
+        verts.finalize();
+    }
+    free(screen.basePointer());
+    free(tex.pixels);
+    return mismatches? 1 : 0;
+}
+
+//the original per-pixel oval, kept as a reference to check and time the span version against
+static void draw_oval_per_pixel(Canvas & canvas, float x0, float y0, float w, float h, Color color, bool add) {
+    int minx = imax(0, lroundf(x0 - w));
+    int miny = imax(canvas.top, lroundf(y0 - h));
+    int maxx = imin(canvas.width  - 1, lroundf(x0 + w));
+    int maxy = imin(canvas.height - 1, lroundf(y0 + h));
+    if (maxx < minx || maxy < miny) return;
+    float xfactor = 1.0f / w;
+    float yfactor = 1.0f / h;
+    for (int y = miny; y <= maxy; ++y) {
+        for (int x = minx; x <= maxx; ++x) {
+            float dx = (x - x0 + 0.5f) * xfactor;
+            float dy = (y - y0 + 0.5f) * yfactor;
+            if (dx * dx + dy * dy < 1) {
+                if (add) unsafe_blend_add(canvas, x, y, color);
+                else if (color.a < 250) unsafe_blend(canvas, x, y, color);
+                else canvas.pixels[y * canvas.pitch + x] = color;
+            }
+        }
+    }
+}
+
+static void draw_bullet_ovals(Canvas & canvas, float x, float y) {
+    draw_oval_per_pixel(canvas, x, y, BULLET_OUTER_RADIUS, BULLET_OUTER_RADIUS, BULLET_OUTER_COLOR, false);
+    draw_oval_per_pixel(canvas, x, y, BULLET_INNER_RADIUS, BULLET_INNER_RADIUS, BULLET_INNER_COLOR, false);
+}
+
+static void draw_bullet_stamp(Canvas & canvas, Tileset & stamps, float x, float y) {
+    int sx = lroundf(x * BULLET_STAMP_SUBPIXELS);
+    int sy = lroundf(y * BULLET_STAMP_SUBPIXELS);
+    draw_tile(canvas, stamps, floor_mod2(sx, BULLET_STAMP_SUBPIXELS), floor_mod2(sy, BULLET_STAMP_SUBPIXELS),
+        floor_div2(sx, BULLET_STAMP_SUBPIXELS) - stamps.tileWidth  / 2,
+        floor_div2(sy, BULLET_STAMP_SUBPIXELS) - stamps.tileHeight / 2);
+}
+
+//checks the span ovals against the per-pixel reference on random ovals (float, int and additive) on random bands of
+//small canvases that are windows into a bigger buffer, at every SIMD level, then checks that the bullet stamps match
+//the two ovals they replace wherever bullets land on a stamp's subpixel, and times all three ways of drawing bullets
+static int run_oval_benchmark(int seed) {
+    static const int CASES = 20000;
+    static const int BULLETS_PER_RUN = 20000;
+    static const int BUFFER_WIDTH = 96, BUFFER_HEIGHT = 80;
+    SimdLevel maxLevel = max_simd_level();
+    global_pcg_state = seed;
+    Tileset stamps = make_bullet_stamps();
+
+    printf("[] oval benchmark, max simd level: %s\n", simdLevelNames[maxLevel]);
+    int mismatches = 0;
+    Pixel * initial = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * reference = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * buffer = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    for (int i = 0; i < CASES; ++i) {
+        int canvasWidth = rand_int(1, 65), canvasHeight = rand_int(1, 49);
+        int canvasX = rand_int(1 + BUFFER_WIDTH - canvasWidth), canvasY = rand_int(1 + BUFFER_HEIGHT - canvasHeight);
+        enum { FLOAT, INT, ADD } kind = (decltype(kind)) rand_int(3);
+        float x0 = rand_float(-8, canvasWidth + 8), y0 = rand_float(-8, canvasHeight + 8);
+        float w = rand_float(0.1f, 20), h = rand_float(0.1f, 20);
+        if (kind != FLOAT) x0 = lroundf(x0), y0 = lroundf(y0), w = rand_int(1, 20), h = rand_int(1, 20);
+        Color color = random_pixel();
+        if (rand_int(2)) color.a = 255;
+
+        for (int j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; ++j) initial[j] = random_pixel();
+        memcpy(reference, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+        Canvas canvas = { reference + canvasY * BUFFER_WIDTH + canvasX, canvasWidth, canvasHeight, BUFFER_WIDTH, 0 };
+        canvas.top = rand_int(canvasHeight);
+        draw_oval_per_pixel(canvas, x0, y0, w, h, color, kind == ADD);
+        for (int level = 0; level <= maxLevel; ++level) {
+            set_simd_level((SimdLevel) level);
+            memcpy(buffer, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+            canvas.pixels = buffer + canvasY * BUFFER_WIDTH + canvasX;
+            if (kind == FLOAT) draw_oval_f(canvas, x0, y0, w, h, color);
+            else if (kind == INT) draw_oval(canvas, x0, y0, w, h, color);
+            else draw_oval_add(canvas, x0, y0, w, h, color);
+            if (memcmp(reference, buffer, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel))) {
+                if (mismatches < 10) {
+                    printf("[] ERROR: %s oval (%f, %f) radii (%f, %f) on %dx%d canvas does not match reference\n",
+                        simdLevelNames[level], x0, y0, w, h, canvasWidth, canvasHeight);
+                }
+                mismatches += 1;
+            }
+        }
+    }
+    set_simd_level(maxLevel);
+
+    //stamps are exact where bullets land on a subpixel, elsewhere their edges can be off by a pixel here and there
+    int offPixels = 0;
+    for (int i = 0; i < CASES; ++i) {
+        bool quantized = i % 2;
+        float x = rand_float(-4, BUFFER_WIDTH + 4), y = rand_float(-4, BUFFER_HEIGHT + 4);
+        if (quantized) {
+            x = lroundf(x * BULLET_STAMP_SUBPIXELS) / (float) BULLET_STAMP_SUBPIXELS;
+            y = lroundf(y * BULLET_STAMP_SUBPIXELS) / (float) BULLET_STAMP_SUBPIXELS;
+        }
+        for (int j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; ++j) initial[j] = random_pixel();
+        memcpy(reference, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+        memcpy(buffer, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+        Canvas canvas = { reference, BUFFER_WIDTH, BUFFER_HEIGHT, BUFFER_WIDTH, 0 };
+        draw_bullet_ovals(canvas, x, y);
+        canvas.pixels = buffer;
+        draw_bullet_stamp(canvas, stamps, x, y);
+        int differ = 0;
+        for (int j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; ++j) differ += memcmp(&reference[j], &buffer[j], 4) != 0;
+        if (!quantized) {
+            offPixels += differ;
+        } else if (differ) {
+            if (mismatches < 10) printf("[] ERROR: bullet stamp at (%f, %f) does not match its ovals\n", x, y);
+            mismatches += 1;
+        }
+    }
+    free(initial);
+    free(reference);
+    free(buffer);
+    printf("[] %d random ovals and %d bullet stamps checked, %d mismatches\n", CASES, CASES / 2, mismatches);
+    printf("[] unquantized bullets: %.2f pixels per bullet differ from the exact ovals\n", offPixels / (CASES / 2.0));
+
+    Canvas screen = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    List<Vec2> bullets = {};
+    for (int i = 0; i < BULLETS_PER_RUN; ++i) bullets.add(vec2(rand_float(CANVAS_WIDTH), rand_float(CANVAS_HEIGHT)));
+    uint64_t start = get_nanos();
+    for (Vec2 b : bullets) draw_bullet_ovals(screen, b.x, b.y);
+    uint64_t perPixelTime = get_nanos() - start;
+    start = get_nanos();
+    for (Vec2 b : bullets) {
+        draw_oval_f(screen, b.x, b.y, BULLET_OUTER_RADIUS, BULLET_OUTER_RADIUS, BULLET_OUTER_COLOR);
+        draw_oval_f(screen, b.x, b.y, BULLET_INNER_RADIUS, BULLET_INNER_RADIUS, BULLET_INNER_COLOR);
+    }
+    uint64_t spanTime = get_nanos() - start;
+    start = get_nanos();
+    for (Vec2 b : bullets) draw_bullet_stamp(screen, stamps, b.x, b.y);
+    uint64_t stampTime = get_nanos() - start;
+    printf("%20s%20s%20s\n", "per-pixel ns/bullet", "spans ns/bullet", "stamp ns/bullet");
+    printf("%20.1f%20.1f%20.1f\n", perPixelTime / (double) BULLETS_PER_RUN, spanTime / (double) BULLETS_PER_RUN,
+        stampTime / (double) BULLETS_PER_RUN);
+
+    bullets.finalize();
+    free(screen.basePointer());
+    free_image(stamps.image);
+    return mismatches? 1 : 0;
+}
+
+static void add_random_lights(LightBuffer & lights, int count, int canvasWidth, int canvasHeight, float maxRadius) {
+    for (int i = 0; i < count; ++i) {
+        float x0 = rand_float(-8, canvasWidth + 8), y0 = rand_float(-8, canvasHeight + 8);
+        add_light(lights, x0, y0, rand_float(0.5f, maxRadius), rand_float(0.5f, maxRadius), random_pixel());
+    }
+}
+
+//checks that accumulating and compositing lights gives the same result at every SIMD level on random bands of canvases
+//with odd and even sizes, measures how far the half resolution lights are from lights drawn at full resolution,
+//and times both ways of drawing lots of lights
+static int run_light_benchmark(int seed) {
+    static const int CASES = 2000;
+    static const int BUFFER_WIDTH = 96, BUFFER_HEIGHT = 80;
+    static const int LIGHT_COUNTS[] = { 16, 256, 2048 };
+    static const int LIGHT_RADII[] = { 12, 48 };
+    SimdLevel maxLevel = max_simd_level();
+    global_pcg_state = seed;
+
+    printf("[] light benchmark, max simd level: %s\n", simdLevelNames[maxLevel]);
+    int mismatches = 0;
+    Pixel * initial = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * reference = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * buffer = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    for (int i = 0; i < CASES; ++i) {
+        int canvasWidth = rand_int(1, 65), canvasHeight = rand_int(1, 49);
+        int canvasX = rand_int(1 + BUFFER_WIDTH - canvasWidth), canvasY = rand_int(1 + BUFFER_HEIGHT - canvasHeight);
+        int top = rand_int(canvasHeight), lightCount = rand_int(1, 9);
+        for (int j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; ++j) initial[j] = random_pixel();
+        u32 lightSeed = global_pcg_state;
+
+        LightBuffer scalar = {};
+        for (int level = 0; level <= maxLevel; ++level) {
+            set_simd_level((SimdLevel) level);
+            global_pcg_state = lightSeed;
+            LightBuffer lights = make_light_buffer(canvasWidth, canvasHeight);
+            add_random_lights(lights, lightCount, canvasWidth, canvasHeight, 30);
+            Pixel * pixels = level? buffer : reference;
+            memcpy(pixels, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+            Canvas canvas = { pixels + canvasY * BUFFER_WIDTH + canvasX, canvasWidth, canvasHeight, BUFFER_WIDTH, 0 };
+            canvas.top = top;
+            composite_lights(canvas, lights);
+
+            if (!level) {
+                scalar = lights;
+                continue;
+            }
+            if (memcmp(scalar.texels, lights.texels, lights.width * lights.height * 4 * sizeof(u16)) ||
+                memcmp(reference, buffer, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel)))
+            {
+                if (mismatches < 10) {
+                    printf("[] ERROR: %s lights on %dx%d canvas from row %d do not match scalar\n",
+                        simdLevelNames[level], canvasWidth, canvasHeight, top);
+                }
+                mismatches += 1;
+            }
+            free_light_buffer(lights);
+        }
+        free_light_buffer(scalar);
+    }
+    set_simd_level(maxLevel);
+    free(initial);
+    free(reference);
+    free(buffer);
+    printf("[] %d random sets of lights checked, %d mismatches\n", CASES, mismatches);
+
+    //the half resolution lights are smoother than the originals, so compare them one light at a time on black
+    Canvas full = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    Canvas half = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    LightBuffer lights = make_light_buffer(CANVAS_WIDTH, CANVAS_HEIGHT);
+    for (int radius : LIGHT_RADII) {
+        u64 totalError = 0, litPixels = 0;
+        int maxError = 0;
+        for (int i = 0; i < 100; ++i) {
+            int x0 = rand_int(CANVAS_WIDTH), y0 = rand_int(CANVAS_HEIGHT);
+            Color color = random_pixel();
+            for (int y = 0; y < CANVAS_HEIGHT; ++y) {
+                memset(full[y], 0, CANVAS_WIDTH * sizeof(Pixel));
+                memset(half[y], 0, CANVAS_WIDTH * sizeof(Pixel));
+            }
+            clear_light_buffer(lights);
+            add_light(full, x0, y0, radius, radius, color);
+            add_light(lights, x0, y0, radius, radius, color);
+            composite_lights(half, lights);
+            for (int y = 0; y < CANVAS_HEIGHT; ++y) {
+                for (int x = 0; x < CANVAS_WIDTH; ++x) {
+                    Pixel a = full[y][x], b = half[y][x];
+                    int error = imax(abs(a.r - b.r), imax(abs(a.g - b.g), abs(a.b - b.b)));
+                    if (a.r || a.g || a.b) litPixels += 1, totalError += error;
+                    maxError = imax(maxError, error);
+                }
+            }
+        }
+        printf("[] radius %d: mean error %.2f over lit pixels, max error %d (out of 255)\n",
+            radius, totalError / (double) imax(1, litPixels), maxError);
+    }
+
+    printf("%8s%8s%24s%24s\n", "lights", "radius", "full res ms/frame", "half res ms/frame");
+    for (int radius : LIGHT_RADII) {
+        for (int count : LIGHT_COUNTS) {
+            List<Vec2> positions = {};
+            for (int i = 0; i < count; ++i) positions.add(vec2(rand_float(CANVAS_WIDTH), rand_float(CANVAS_HEIGHT)));
+            Color color = { 255, 160, 64, 96 };
+            uint64_t start = get_nanos();
+            for (Vec2 p : positions) add_light(full, p.x, p.y, radius, radius, color);
+            uint64_t fullTime = get_nanos() - start;
+            start = get_nanos();
+            clear_light_buffer(lights);
+            for (Vec2 p : positions) add_light(lights, p.x, p.y, radius, radius, color);
+            composite_lights(half, lights);
+            uint64_t halfTime = get_nanos() - start;
+            printf("%8d%8d%24.3f%24.3f\n", count, radius, fullTime / 1000000.0, halfTime / 1000000.0);
+            positions.finalize();
+        }
+    }
+
+    free_light_buffer(lights);
+    free(full.basePointer());
+    free(half.basePointer());
+    return mismatches? 1 : 0;
+}
+
+//the original glyph-by-glyph text drawing, kept as a reference to check and time the coverage masks against
+static void draw_text_per_pixel(Canvas & canvas, MonoFont & font, int cx, int cy, Color color, const char * text) {
+    auto draw_glyph = [&] (int x0, int y0, int glyph) {
+        int srcx = glyph % font.columns * font.glyphWidth;
+        int srcy = glyph / font.columns * font.glyphHeight;
+        for (int y = 0; y < font.glyphHeight; ++y) {
+            for (int x = 0; x < font.glyphWidth; ++x) {
+                if (font.pixels[(srcy + y) * font.textureWidth + (srcx + x)]) blend(canvas, x0 + x, y0 + y, color);
+            }
+        }
+    };
+    for (int i = 0; text[i] != '\0'; ++i) {
+        draw_glyph(cx + i * font.glyphWidth, cy, text[i]);
+        int descender = descender_glyph(text[i]);
+        if (descender >= 0) draw_glyph(cx + i * font.glyphWidth, cy + font.glyphHeight, descender);
+    }
+}
+
+//checks drawing text glyph by glyph and from a text run against the per-pixel reference on random strings on random
+//bands of canvases that are windows into a bigger buffer, at every SIMD level, then times drawing the game's HUD text
+static int run_text_benchmark(int seed) {
+    static const int CASES = 5000;
+    static const int FRAMES = 2000;
+    static const int BUFFER_WIDTH = 320, BUFFER_HEIGHT = 80;
+    SimdLevel maxLevel = max_simd_level();
+    global_pcg_state = seed;
+    MonoFont font = load_mono_font("res/font-16-white.png", 8, 16);
+
+    printf("[] text benchmark, max simd level: %s\n", simdLevelNames[maxLevel]);
+    int mismatches = 0;
+    Pixel * initial = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * reference = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    Pixel * buffer = (Pixel *) malloc(BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+    for (int i = 0; i < CASES; ++i) {
+        int canvasWidth = rand_int(1, 257), canvasHeight = rand_int(1, 49);
+        int canvasX = rand_int(1 + BUFFER_WIDTH - canvasWidth), canvasY = rand_int(1 + BUFFER_HEIGHT - canvasHeight);
+        char text[40] = {};
+        int len = rand_int(1, sizeof(text));
+        for (int j = 0; j < len; ++j) text[j] = rand_int(2)? rand_int(' ', '~' + 1) : "gyjpq "[rand_int(6)];
+        int cx = rand_int(-len * font.glyphWidth, canvasWidth), cy = rand_int(-2 * font.glyphHeight, canvasHeight);
+        Color color = random_pixel();
+        TextRun run = make_text_run(font, text);
+
+        for (int j = 0; j < BUFFER_WIDTH * BUFFER_HEIGHT; ++j) initial[j] = random_pixel();
+        memcpy(reference, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+        Canvas canvas = { reference + canvasY * BUFFER_WIDTH + canvasX, canvasWidth, canvasHeight, BUFFER_WIDTH, 0 };
+        canvas.top = rand_int(canvasHeight);
+        draw_text_per_pixel(canvas, font, cx, cy, color, text);
+        for (int level = 0; level <= maxLevel; ++level) {
+            set_simd_level((SimdLevel) level);
+            for (int cached = 0; cached < 2; ++cached) {
+                memcpy(buffer, initial, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel));
+                canvas.pixels = buffer + canvasY * BUFFER_WIDTH + canvasX;
+                if (cached) draw_text_run(canvas, run, cx, cy, color);
+                else draw_text(canvas, font, cx, cy, color, text);
+                if (memcmp(reference, buffer, BUFFER_WIDTH * BUFFER_HEIGHT * sizeof(Pixel))) {
+                    if (mismatches < 10) {
+                        printf("[] ERROR: %s %s \"%s\" at (%d, %d) on %dx%d canvas does not match reference\n",
+                            simdLevelNames[level], cached? "text run" : "glyphs", text, cx, cy, canvasWidth, canvasHeight);
+                    }
+                    mismatches += 1;
+                }
+            }
+        }
+        free_text_run(run);
+    }
+    free(initial);
+    free(reference);
+    free(buffer);
+    printf("[] %d random strings checked, %d mismatches\n", CASES, mismatches);
+
+    //what's on screen during the tutorial, with the distance counter changing every few frames
+    const char * lines[] = {
+        "ENEMIES CAN'T HURT YOU", "BUT THE GROUND CAN", "ESCAPE THE CAVERNS", "\x14\x14\x14\x14\x14\x14\x14\x14\x14\x14\x14\x14",
+    };
+    Canvas screen = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    set_simd_level(maxLevel);
+    uint64_t times[3] = {};
+    DrawList list = {};
+    for (int method = 0; method < 3; ++method) {
+        uint64_t start = get_nanos();
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            char distance[50], fps[20];
+            snprintf(distance, sizeof(distance), "distance: %d meters", frame / 4);
+            snprintf(fps, sizeof(fps), "%dfps", 60 + frame % 3);
+            auto draw = [&] (int cx, int cy, Color color, const char * text) {
+                if (method == 0) draw_text_per_pixel(screen, font, cx, cy, color, text);
+                else if (method == 1) draw_text(screen, font, cx, cy, color, text);
+                else draw_text(list, font, cx, cy, color, text);
+            };
+            draw(CANVAS_WIDTH / 2 - 100 + 1, font.glyphHeight + 1, { 0, 0, 0, 255 }, distance);
+            draw(CANVAS_WIDTH / 2 - 100, font.glyphHeight, { 255, 255, 255, 255 }, distance);
+            for (int i = 0; i < (int) ARR_SIZE(lines); ++i) {
+                draw(CANVAS_WIDTH / 2 - 100, CANVAS_HEIGHT / 2 + (i * 4 - 6) * font.glyphHeight, { 255, 255, 255, 255 }, lines[i]);
+            }
+            draw(CANVAS_WIDTH - 8 * font.glyphWidth, font.glyphHeight, { 255, 255, 255, 255 }, fps);
+            if (method == 2) execute_draw_list(list, screen, 1);
+        }
+        times[method] = get_nanos() - start;
+    }
+    printf("%20s%20s%20s\n", "per-pixel us/frame", "glyphs us/frame", "text runs us/frame");
+    printf("%20.2f%20.2f%20.2f\n", times[0] / 1000.0 / FRAMES, times[1] / 1000.0 / FRAMES, times[2] / 1000.0 / FRAMES);
+
+    list.finalize();
+    free(screen.basePointer());
+    free(font.pixels);
+    return mismatches? 1 : 0;
+}
+
+//the original per-tile collision loop, kept as a reference to check and time the bitmap version against
+static bool collide_with_tile_lookups(TileGrid & tiles, Rect hitbox) {
+    int minx = imax(0, floorf(hitbox.x / UNITS_PER_TILE));
+    int miny = imax(0, floorf(hitbox.y / UNITS_PER_TILE));
+    int maxx = imin(tiles.width , ceilf((hitbox.x + hitbox.w) / UNITS_PER_TILE));
+    int maxy = imin(tiles.height, ceilf((hitbox.y + hitbox.h) / UNITS_PER_TILE));
+    for (int y = miny; y < maxy; ++y) {
+        for (int x = minx; x < maxx; ++x) {
+            if (get_tile(tiles, x, y).layer[2] >= 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+//times tile collision queries at random places in a level, with both per-tile lookups and the solidity bitmaps
+static int run_collision_benchmark(int seed) {
+    static const int QUERIES = 4'000'000;
+    global_pcg_state = seed;
+    Level level = init_level(seed);
+
+    float maxX = level.tiles.width * UNITS_PER_TILE, maxY = level.tiles.height * UNITS_PER_TILE;
+    List<Rect> rects = {};
+    for (int i = 0; i < QUERIES; ++i) {
+        Vec2 pos = vec2(rand_float(maxX), rand_float(maxY));
+        rects.add(i % 2? bullet_hitbox(pos) : player_hitbox(pos));
+    }
+
+    printf("[] tile collision benchmark: %d random bullet and player sized queries\n", QUERIES);
+    uint64_t start = get_nanos();
+    int lookupHits = 0;
+    for (Rect & rect : rects) lookupHits += collide_with_tile_lookups(level.tiles, rect);
+    uint64_t lookupTime = get_nanos() - start;
+
+    start = get_nanos();
+    int bitmapHits = 0;
+    for (Rect & rect : rects) bitmapHits += collide_with_tiles(level.tiles, rect);
+    uint64_t bitmapTime = get_nanos() - start;
+
+    printf("[] tile lookups: %6.1f ns/query, %d hits\n", lookupTime / (double) QUERIES, lookupHits);
+    printf("[] bitmap:       %6.1f ns/query, %d hits\n", bitmapTime / (double) QUERIES, bitmapHits);
+
+    int mismatches = 0;
+    for (Rect & rect : rects) {
+        mismatches += collide_with_tile_lookups(level.tiles, rect) != collide_with_tiles(level.tiles, rect);
+    }
+    if (mismatches) printf("[] ERROR: bitmap disagrees with tile lookups on %d queries\n", mismatches);
+    rects.finalize();
+    free_level(level);
+    return mismatches? 1 : 0;
+}
+
+//the original way of drawing the background, clearing the canvas and then drawing every visible tile every frame,
+//kept as a reference to check and time the tile cache against
+static void draw_background_per_tile(Canvas & canvas, TileGrid & tiles, Tileset & tileset, int offx, int offy) {
+    for (int y = 0; y < canvas.height; ++y) {
+        for (int x = 0; x < canvas.width; ++x) {
+            canvas[y][x] = background_pixel(x + offx, y + offy);
+        }
+    }
+
+    int minx = imax(0, floor_div2(offx, TILE_PIXELS));
+    int miny = imax(0, floor_div2(offy, TILE_PIXELS));
+    int maxx = imin(tiles.width , floor_div2(offx + canvas.width  - 1, TILE_PIXELS) + 1);
+    int maxy = imin(tiles.height, floor_div2(offy + canvas.height - 1, TILE_PIXELS) + 1);
+    for (int y = miny; y < maxy; ++y) {
+        for (int x = minx; x < maxx; ++x) {
+            Tile tile = get_tile(tiles, x, y);
+            for (int i = 0; i < 3; ++i) {
+                if (tile.layer[i] >= 0) {
+                    int tx = tile.layer[i] % tileset.width;
+                    int ty = tile.layer[i] / tileset.width;
+                    draw_tile_a1(canvas, tileset, tx, ty, x * TILE_PIXELS - offx, y * TILE_PIXELS - offy);
+                }
+            }
+        }
+    }
+}
+
+//scrolls a canvas-sized camera through the level the way the game does (including screenshake and a vertical sweep
+//that goes past the top and bottom of the level) and draws the background both ways, checking they match exactly
+static int run_tile_cache_benchmark(int seed) {
+    static const int FRAMES = 5000;
+    static const float SCROLL_SPEED = AUTOPILOT_SPEED * PIXELS_PER_UNIT / 60; //pixels per frame at 60fps
+    global_pcg_state = seed;
+    Level level = init_level(seed);
+    Tileset tileset = load_tileset("res/groundilesheet.png", TILE_PIXELS, TILE_PIXELS);
+    Canvas reference = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    Canvas cached = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    TileCache cache = make_tile_cache(CANVAS_WIDTH, level.tiles.height);
+
+    List<Coord2> offsets = {};
+    for (int i = 0; i < FRAMES; ++i) {
+        float shake = i % 300 < 20? 6 : 0;
+        offsets.add(coord2(level.playerStartPos.x * PIXELS_PER_UNIT + i * SCROLL_SPEED + rand_float(-shake, shake),
+                           sinf(i * 0.01f) * level.tiles.height * TILE_PIXELS * 0.6f + rand_float(-shake, shake)));
+    }
+
+    printf("[] tile cache benchmark: %d frames of %dx%d scrolling at %.1f px/frame\n",
+        FRAMES, CANVAS_WIDTH, CANVAS_HEIGHT, SCROLL_SPEED);
+    uint64_t referenceTime = 0, cachedTime = 0;
+    int mismatches = 0;
+    for (Coord2 off : offsets) {
+        uint64_t start = get_nanos();
+        draw_background_per_tile(reference, level.tiles, tileset, off.x, off.y);
+        referenceTime += get_nanos() - start;
+
+        start = get_nanos();
+        draw_tile_cache(cached, cache, level, tileset, off.x, off.y);
+        cachedTime += get_nanos() - start;
+
+        for (int y = 0; y < CANVAS_HEIGHT; ++y) {
+            if (memcmp(reference[y], cached[y], CANVAS_WIDTH * sizeof(Pixel))) {
+                mismatches += 1;
+                break;
+            }
+        }
+    }
+
+    printf("[] per tile:   %8.1f us/frame\n", referenceTime / 1000.0 / FRAMES);
+    printf("[] tile cache: %8.1f us/frame\n", cachedTime / 1000.0 / FRAMES);
+    if (mismatches) printf("[] ERROR: tile cache differs from per-tile drawing on %d frames\n", mismatches);
+
+    offsets.finalize();
+    free_tile_cache(cache);
+    free(reference.basePointer());
+    free(cached.basePointer());
+    free(tileset.image.pixels);
+    free_level(level);
+    return mismatches? 1 : 0;
+}
+
+static u64 checksum(u64 sum, const void * data, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) sum = (sum ^ ((const u8 *) data)[i]) * 1099511628211ull; //FNV-1a
+    return sum;
+}
+
+//ticks a level packed with far more active enemies and walkers than the game ever has, with the player held in place,
+//and returns a checksum of the resulting state so that different thread counts can be checked against each other
+static u64 run_crowded_ticks(int seed, int ticks, uint64_t & elapsed) {
+    static const int CROWD_SIZE = 20000;
+    Level level = init_level(seed);
+    Rng rng = { seed };
+    for (int i = 0; i < CROWD_SIZE; ++i) {
+        Vec2 pos = vec2(rand_float(rng, 0, 180), rand_float(rng, 0, LEVEL_HEIGHT * UNITS_PER_TILE));
+        level.enemies.add({ .pos = pos, .timer = rand_float(rng), .rng = { rand_int(rng) } });
+        Vec2 home = vec2(rand_float(rng, 0, 180), rand_float(rng, 0, LEVEL_HEIGHT * UNITS_PER_TILE));
+        level.walkers.add({ .home = home, .pos = home });
+    }
+    sort_by_x(level.enemies);
+    sort_by_x(level.walkers);
+
+    List<GameEvent> events = {};
+    u64 sum = 14695981039346656037ull;
+    uint64_t start = get_nanos();
+    for (int i = 0; i < ticks; ++i) {
+        level.player.dead = false;
+        level.player.pos = level.playerStartPos;
+        tick_level(level, scripted_input(i), TICK_LENGTH, coord2(CANVAS_WIDTH, CANVAS_HEIGHT), events);
+        sum = checksum(sum, &level.player.vel, sizeof(Vec2));
+        sum = checksum(sum, &events.len, sizeof(events.len));
+        sum = checksum(sum, &level.bullets.len, sizeof(level.bullets.len));
+        sum = checksum(sum, level.bullets.posx, level.bullets.len * sizeof(float));
+        sum = checksum(sum, level.bullets.posy, level.bullets.len * sizeof(float));
+        events.len = 0;
+        level.bullets.len = 0; //otherwise the serial bullet update would come to dominate
+    }
+    elapsed = get_nanos() - start;
+
+    for (Enemy & enemy : level.enemies) sum = checksum(sum, &enemy, sizeof(Enemy));
+    for (Walker & walker : level.walkers) {
+        sum = checksum(sum, &walker.pos, sizeof(walker.pos));
+        sum = checksum(sum, &walker.walkTimer, sizeof(walker.walkTimer));
+        sum = checksum(sum, &walker.attackTimer, sizeof(walker.attackTimer));
+    }
+    events.finalize();
+    free_level(level);
+    return sum;
+}
+
+//measures how the parallel parts of the game scale from one thread up to all of them,
+//and checks that they produce identical results no matter how many threads are used
+static int run_thread_scaling_benchmark(int seed) {
+    static const int TICKS = 250;
+    //NOTE: the level's sections stay mapped from res/sections.bin, so the timed bakes go somewhere else
+    static const char * BAKE_PATH = "res/sections-bench.bin";
+    int maxThreads = job_thread_count();
+    bool mismatch = false;
+    u64 baseSum = 0;
+    Level warmup = init_level(seed); //make sure the sections are loaded before timing anything
+    free_level(warmup);
+
+    printf("[] thread scaling benchmark, up to %d threads\n", maxThreads);
+    printf("%-10s%18s%18s%18s\n", "threads", "bake ms", "crowd tick us", "tick speedup");
+    double baseTick = 0;
+    for (int threads = 1;; threads = imin(threads * 2, maxThreads)) {
+        set_job_thread_limit(threads);
+
+        uint64_t start = get_nanos();
+        bake_sections(BAKE_PATH);
+        uint64_t bakeTime = get_nanos() - start;
+
+        uint64_t tickTime = 0;
+        u64 sum = run_crowded_ticks(seed, TICKS, tickTime);
+        double tickUs = tickTime / 1000.0 / TICKS;
+        if (threads == 1) {
+            baseSum = sum;
+            baseTick = tickUs;
+        } else if (sum != baseSum) {
+            printf("[] ERROR: result with %d threads differs from result with 1 thread\n", threads);
+            mismatch = true;
+        }
+        printf("%-10d%18.2f%18.1f%18.2f\n", threads, bakeTime / 1'000'000.0, tickUs, baseTick / tickUs);
+        if (threads == maxThreads) break;
+    }
+
+    remove(BAKE_PATH);
+    set_job_thread_limit(maxThreads);
+    return mismatch? 1 : 0;
+}
+
+//records a representative frame: the level, a translucent full-screen overlay like the tutorial and menus have,
+//and some HUD text
+static void record_frame(DrawList & list, Level & level, Graphics & graphics, MonoFont & font, TileCache & cache,
+                         Canvas & canvas)
+{
+    int offx = level.camCenter.x * PIXELS_PER_UNIT - canvas.width  * 0.5f;
+    int offy = level.camCenter.y * PIXELS_PER_UNIT - canvas.height * 0.5f;
+    draw_level(list, level, graphics, cache, offx, offy, coord2(canvas.width, canvas.height), false);
+    draw_rect(list, 0, 0, canvas.width, canvas.height, { 0, 0, 0, 160 });
+    for (int i = 0; i < 4; ++i) {
+        draw_text_center(list, font, canvas.width / 2, canvas.height / 2 + (i * 4 - 6) * font.glyphHeight,
+                         { 255, 255, 255, 255 }, "Press R to try again. Or don't, it's up to you really.");
+    }
+}
+
+//times rasterizing the same recorded frame with the canvas split into 1, 2, 4 and 8 bands (one job thread per band,
+//as far as there are threads) at 1x and 4x the game's canvas resolution, and checks every band count's output is
+//identical to drawing with a single band
+static int run_raster_benchmark(int seed) {
+    static const int FRAMES = 200;
+    static const int WARMUP_TICKS = 2000;
+    static const int bandCounts[] = { 1, 2, 4, 8 };
+    int maxThreads = job_thread_count();
+    bool mismatch = false;
+
+    global_pcg_state = seed;
+    Level level = init_level(seed);
+    List<GameEvent> events = {};
+    for (int i = 0; i < WARMUP_TICKS; ++i) {
+        autopilot(level, i);
+        tick_level(level, scripted_input(i), TICK_LENGTH, coord2(CANVAS_WIDTH, CANVAS_HEIGHT), events);
+        events.len = 0;
+    }
+    Graphics graphics = load_graphics();
+    MonoFont font = load_mono_font("res/font-16-white.png", 8, 16);
+    DrawList list = {};
+
+    printf("[] raster benchmark: %d frames, %d bullets, up to %d threads\n", FRAMES, level.bullets.len, maxThreads);
+    printf("%-12s%-8s%16s%16s\n", "canvas", "bands", "ms/frame", "speedup");
+    for (int scale = 1; scale <= 2; ++scale) {
+        Canvas canvas = make_canvas(CANVAS_WIDTH * scale, CANVAS_HEIGHT * scale, 16);
+        TileCache cache = make_tile_cache(canvas.width, level.tiles.height);
+        Pixel * reference = (Pixel *) malloc(canvas.width * canvas.height * sizeof(Pixel));
+        double baseTime = 0;
+        for (int bands : bandCounts) {
+            set_job_thread_limit(imin(bands, maxThreads));
+            uint64_t elapsed = 0;
+            for (int frame = 0; frame < FRAMES; ++frame) {
+                record_frame(list, level, graphics, font, cache, canvas);
+                uint64_t start = get_nanos();
+                execute_draw_list(list, canvas, bands);
+                elapsed += get_nanos() - start;
+            }
+
+            for (int y = 0; y < canvas.height; ++y) {
+                Pixel * row = reference + y * canvas.width;
+                if (bands == 1) {
+                    memcpy(row, canvas[y], canvas.width * sizeof(Pixel));
+                } else if (memcmp(row, canvas[y], canvas.width * sizeof(Pixel))) {
+                    printf("[] ERROR: output with %d bands differs from output with 1 band\n", bands);
+                    mismatch = true;
+                    break;
+                }
+            }
+
+            double ms = elapsed / 1'000'000.0 / FRAMES;
+            if (bands == 1) baseTime = ms;
+            printf("%-12s%-8d%16.3f%16.2f\n", dsprintf(nullptr, "%dx%d", canvas.width, canvas.height), bands, ms, baseTime / ms);
+        }
+        free(reference);
+        free_tile_cache(cache);
+        free(canvas.basePointer());
+    }
+
+    set_job_thread_limit(maxThreads);
+    list.finalize();
+    events.finalize();
+    free_level(level);
+    return mismatch? 1 : 0;
+}
+
+static const int TICKS_PER_FRAME = 4; //62.5 frames per second at 250 ticks per second
+
+//records a frame the way the game draws one mid-run: the level and the distance counter, minus the screenshake
+static void record_game_frame(DrawList & list, Level & level, Graphics & graphics, MonoFont & font, TileCache & cache,
+                              Canvas & canvas)
+{
+    int offx = level.camCenter.x * PIXELS_PER_UNIT - canvas.width  * 0.5f;
+    int offy = level.camCenter.y * PIXELS_PER_UNIT - canvas.height * 0.5f;
+    draw_level(list, level, graphics, cache, offx, offy, coord2(canvas.width, canvas.height), false);
+    draw_distance_counter(list, level, font, coord2(canvas.width, canvas.height));
+}
+
+//returns how many pixels of the canvas differ from a frame written earlier by `write_canvas_raw()` or
+//`write_canvas_png()`, or -1 if the file is missing or isn't the same size as the canvas
+static int compare_canvas_with_file(Canvas & canvas, const char * path, bool raw) {
+    if (!file_exists(path)) return -1;
+    Pixel * pixels = nullptr;
+    bool sizeMatches = false;
+    if (raw) {
+        long len = 0;
+        pixels = (Pixel *) read_entire_file(path, &len);
+        sizeMatches = len == canvas.width * canvas.height * (long) sizeof(Pixel);
+    } else {
+        int w, h, n;
+        pixels = (Pixel *) stbi_load(path, &w, &h, &n, 4);
+        sizeMatches = pixels && w == canvas.width && h == canvas.height;
+    }
+    int differ = -1;
+    if (sizeMatches) {
+        differ = 0;
+        for (int y = 0; y < canvas.height; ++y) {
+            for (int x = 0; x < canvas.width; ++x) {
+                differ += memcmp(&canvas[y][x], &pixels[y * canvas.width + x], sizeof(Pixel)) != 0;
+            }
+        }
+    }
+    free(pixels);
+    return differ;
+}
+
+//plays the game with the scripted input and renders every frame into a canvas, with no window or GL context,
+//timing the recording and rasterization of each frame. the frames can be dumped as raw RGBA or PNG files and/or
+//checked against ones dumped earlier, so renderer changes can be checked for exact output on a machine with no GPU
+static int run_render(int frames, int seed, const char * dumpDir, const char * goldenDir, bool raw) {
+    Level level = init_level(seed);
+    Graphics graphics = load_graphics();
+    MonoFont font = load_mono_font("res/font-16-white.png", 8, 16);
+    Canvas canvas = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    TileCache cache = make_tile_cache(canvas.width, level.tiles.height);
+    DrawList list = {};
+    List<GameEvent> events = {};
+    List<uint64_t> rasterTimes = {};
+    if (dumpDir && !create_dir_if_not_exist(dumpDir)) {
+        printf("[] ERROR: could not create directory %s\n", dumpDir);
+        return 1;
+    }
+
+    printf("[] headless render: %d frames of %dx%d with %d job threads, seed %d\n",
+        frames, canvas.width, canvas.height, job_thread_count(), seed);
+    uint64_t recordTime = 0;
+    int failedWrites = 0, goldenMismatches = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        for (int i = 0; i < TICKS_PER_FRAME; ++i) {
+            int tick = frame * TICKS_PER_FRAME + i;
+            autopilot(level, tick);
+            tick_level(level, scripted_input(tick), TICK_LENGTH, coord2(canvas.width, canvas.height), events);
+            events.len = 0;
+        }
+
+        uint64_t start = get_nanos();
+        record_game_frame(list, level, graphics, font, cache, canvas);
+        uint64_t recorded = get_nanos();
+        execute_draw_list(list, canvas, job_thread_count());
+        recordTime += recorded - start;
+        rasterTimes.add(get_nanos() - recorded);
+
+        char path[1024];
+        if (dumpDir) {
+            snprintf(path, sizeof(path), "%s/frame-%04d.%s", dumpDir, frame, raw? "raw" : "png");
+            if (!(raw? write_canvas_raw(canvas, path) : write_canvas_png(canvas, path))) {
+                if (failedWrites < 10) printf("[] ERROR: could not write %s\n", path);
+                failedWrites += 1;
+            }
+        }
+        if (goldenDir) {
+            snprintf(path, sizeof(path), "%s/frame-%04d.%s", goldenDir, frame, raw? "raw" : "png");
+            int differ = compare_canvas_with_file(canvas, path, raw);
+            if (differ) {
+                if (goldenMismatches < 10) {
+                    if (differ < 0) printf("[] ERROR: %s is missing or the wrong size\n", path);
+                    else printf("[] ERROR: frame %d differs from %s in %d pixels\n", frame, path, differ);
+                }
+                goldenMismatches += 1;
+            }
+        }
+    }
+
+    std::sort(rasterTimes.begin(), rasterTimes.end());
+    uint64_t rasterTotal = 0;
+    for (uint64_t t : rasterTimes) rasterTotal += t;
+    printf("[] record:    %8.3f ms/frame\n", recordTime / 1'000'000.0 / frames);
+    printf("[] rasterize: %8.3f ms/frame average, %.3f median, %.3f 99th percentile, %.3f worst\n",
+        rasterTotal / 1'000'000.0 / frames, rasterTimes[frames / 2] / 1'000'000.0,
+        rasterTimes[frames * 99 / 100] / 1'000'000.0, rasterTimes[frames - 1] / 1'000'000.0);
+    if (dumpDir) printf("[] wrote %d frames to %s\n", frames - failedWrites, dumpDir);
+    if (goldenDir) printf("[] %d of %d frames differ from %s\n", goldenMismatches, frames, goldenDir);
+
+    rasterTimes.finalize();
+    events.finalize();
+    list.finalize();
+    free_tile_cache(cache);
+    free(canvas.basePointer());
+    free(font.pixels);
+    free_level(level);
+    return failedWrites || goldenMismatches? 1 : 0;
+}
+
+//FNV-1a over whole pixels rather than bytes, which is plenty to tell frames apart and a lot faster
+static u64 canvas_checksum(Canvas & canvas) {
+    u64 sum = 14695981039346656037ull;
+    for (int y = 0; y < canvas.height; ++y) {
+        for (int x = 0; x < canvas.width; ++x) {
+            u32 p;
+            memcpy(&p, &canvas[y][x], sizeof(p));
+            sum = (sum ^ p) * 1099511628211ull;
+        }
+    }
+    return sum;
+}
+
+//plays the same frames of scripted play (ticks, recording and rasterizing) with the render pipeline rasterizing inline
+//and on its own thread, checking that every frame comes out the same both ways, and times them
+static int run_pipeline_benchmark(int seed) {
+    static const int FRAMES = 1000;
+    Graphics graphics = load_graphics();
+    MonoFont font = load_mono_font("res/font-16-white.png", 8, 16);
+    List<GameEvent> events = {};
+    List<u64> sums[2] = {};
+
+    printf("[] render pipeline benchmark: %d frames, %d ticks per frame, %d job threads\n",
+        FRAMES, TICKS_PER_FRAME, job_thread_count());
+    printf("%-16s%16s\n", "rasterize", "ms/frame");
+    for (int threaded = 0; threaded < 2; ++threaded) {
+        Level level = init_level(seed);
+        RenderPipeline * pipeline = make_render_pipeline(CANVAS_WIDTH, CANVAS_HEIGHT, level.tiles.height, threaded);
+        uint64_t start = get_nanos();
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            for (int i = 0; i < TICKS_PER_FRAME; ++i) {
+                int tick = frame * TICKS_PER_FRAME + i;
+                autopilot(level, tick);
+                tick_level(level, scripted_input(tick), TICK_LENGTH, coord2(CANVAS_WIDTH, CANVAS_HEIGHT), events);
+                events.len = 0;
+            }
+            FrameSlot & slot = next_frame_slot(*pipeline);
+            record_game_frame(slot.list, level, graphics, font, slot.tileCache, slot.canvas);
+            submit_frame(*pipeline);
+            //stands in for presenting, which reads the whole canvas
+            if (Canvas * finished = finished_frame(*pipeline)) sums[threaded].add(canvas_checksum(*finished));
+        }
+        uint64_t elapsed = get_nanos() - start;
+        printf("%-16s%16.3f\n", threaded? "own thread" : "inline", elapsed / 1'000'000.0 / FRAMES);
+        free_render_pipeline(pipeline);
+        free_level(level);
+    }
+
+    //the threaded pipeline is a frame behind, so it has one fewer finished frame
+    int mismatches = 0;
+    for (int i = 0; i < (int) sums[1].len; ++i) mismatches += sums[0][i] != sums[1][i];
+    printf("[] %d frames compared, %d differ\n", sums[1].len, mismatches);
+
+    sums[0].finalize();
+    sums[1].finalize();
+    events.finalize();
+    free(font.pixels);
+    return mismatches? 1 : 0;
+}
+
+int run_headless(int argc, char ** argv) {
+    bool headless = false;
+    int ticks = 25000;
+    int seed = 1;
+    const char * bench = nullptr;
+    bool render = false, raw = false;
+    int frames = 600;
+    const char * dumpDir = nullptr, * goldenDir = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--headless")) {
+            headless = true;
+        } else if (!strcmp(argv[i], "--render")) {
+            render = true;
+        } else if (!strcmp(argv[i], "--raw")) {
+            raw = true;
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = imax(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--dump") && i + 1 < argc) {
+            dumpDir = argv[++i];
+        } else if (!strcmp(argv[i], "--golden") && i + 1 < argc) {
+            goldenDir = argv[++i];
+        } else if (!strcmp(argv[i], "--ticks") && i + 1 < argc) {
+            ticks = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--bench") && i + 1 < argc) {
+            bench = argv[++i];
+        }
+    }
+
+    if (bench) {
+        if (!strcmp(bench, "bullets")) return run_bullet_benchmark(seed);
+        if (!strcmp(bench, "blit")) return run_blit_benchmark(seed);
+        if (!strcmp(bench, "sprites")) return run_sprite_benchmark(seed);
+        if (!strcmp(bench, "triangles")) return run_triangle_benchmark(seed);
+        if (!strcmp(bench, "ovals")) return run_oval_benchmark(seed);
+        if (!strcmp(bench, "lights")) return run_light_benchmark(seed);
+        if (!strcmp(bench, "text")) return run_text_benchmark(seed);
+        if (!strcmp(bench, "collide")) return run_collision_benchmark(seed);
+        if (!strcmp(bench, "threads")) return run_thread_scaling_benchmark(seed);
+        if (!strcmp(bench, "tiles")) return run_tile_cache_benchmark(seed);
+        if (!strcmp(bench, "raster")) return run_raster_benchmark(seed);
+        if (!strcmp(bench, "pipeline")) return run_pipeline_benchmark(seed);
+        if (int ret = run_gl_benchmark(bench, seed); ret >= 0) return ret;
+        printf("[] unknown benchmark: %s\n", bench);
+        return 1;
+    }
+    if (render) return run_render(frames, seed, dumpDir, goldenDir, raw);
+    if (!headless) return -1;
+    return run_simulation_benchmark(ticks, seed);
+}
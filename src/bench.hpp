@@ -0,0 +1,39 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+//runs the game's simulation (and eventually other subsystems) with no window, GL context or audio,
+//so that performance can be measured and regressions caught on machines that have no GPU
+//  --headless [--ticks N] [--seed S]   times the full simulation tick with scripted input
+//  --render [--frames N] [--seed S] [--dump DIR] [--golden DIR] [--raw]
+//                                      renders frames of scripted play into a canvas and times their rasterization,
+//                                      optionally writing each one to DIR/frame-NNNN.png (or .raw, plain RGBA rows)
+//                                      and/or checking each one against the same files written by an earlier run
+//  --bench bullets [--seed S]          times the bullet integration kernel on each SIMD path at various bullet counts
+//  --bench blit [--seed S]             checks every SIMD path of each sprite blitter against scalar, then times them
+//  --bench sprites [--seed S]          checks the premultiplied run blitter against a per-pixel reference and times it
+//  --bench triangles [--seed S]        checks the triangle rasterizer against a per-pixel reference and times it
+//  --bench ovals [--seed S]            checks the span ovals against a per-pixel reference, then times bullet drawing
+//  --bench lights [--seed S]           checks the half resolution light buffer at every SIMD level and times it against
+//                                      drawing lights at full resolution
+//  --bench text [--seed S]             checks glyphs and cached text runs against a per-pixel reference and times them
+//  --bench collide [--seed S]          compares tile collision queries done tile by tile and with the solidity bitmaps
+//  --bench threads [--seed S]          times section baking and a crowded simulation tick at 1 to N job threads
+//  --bench tiles [--seed S]            compares drawing the scrolling level background tile by tile and from the cache
+//  --bench raster [--seed S]           times rasterizing a recorded frame in 1 to 8 parallel bands at 1x and 4x resolution
+//  --bench pipeline [--seed S]         checks and times rasterizing frames on the render thread against doing it inline
+//  --bench present [--seed S]          compares presenting the canvas through the persistent presenter with creating
+//                                      everything every frame, in a hidden window (needs GL 3.3, llvmpipe works)
+//  --bench imm [--seed S]              compares flushing `Imm` through the vertex ring and state cache with uploading
+//                                      and binding everything per batch, in a hidden window
+//  --bench atlas [--seed S]            compares drawing text and images from their own textures and from the atlas
+//  --bench quads [--seed S]            compares drawing text, rects and images as instanced quads and as vertices
+//  --bench shapes [--seed S]           compares drawing circles and round lines as antialiased shapes and as triangles
+//  --bench fonts [--seed S]            times loading a font from its .fnt and from the baked file, and measuring text
+//returns -1 if the command line didn't ask for a headless mode, otherwise the process exit code
+int run_headless(int argc, char ** argv);
+
+//runs one of the benchmarks above that need a GL context (present, imm, atlas, quads, shapes, fonts),
+//returns -1 if `bench` isn't one of them. the game build gets it from bench_gl.cpp, the headless build from headless.cpp
+int run_gl_benchmark(const char * bench, int seed);
+
+#endif //BENCH_HPP
@@ -0,0 +1,793 @@
+#include "bench.hpp"
+#include "graphics.hpp"
+#include "trace.hpp"
+#include "common.hpp"
+#include "platform.hpp"
+#include "glutil.hpp"
+#include "imm.hpp"
+#include <SDL.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// GL BENCHMARKS                                                                                                    ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//these need SDL and a GL context, so they live apart from the CPU benchmarks in bench.cpp,
+//which the headless build (`bob -headless`) compiles without either
+
+//opens a hidden window with the same kind of GL context the game uses, returns null if that didn't work
+static SDL_Window * open_hidden_window(const char * title, int width, int height, SDL_GLContext & context) {
+    if (SDL_Init(SDL_INIT_VIDEO)) {
+        printf("[] ERROR: SDL failed to init: %s\n", SDL_GetError());
+        return nullptr;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_Window * window = SDL_CreateWindow(title, 0, 0, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    context = window? SDL_GL_CreateContext(window) : nullptr;
+    if (!context || !gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+        printf("[] ERROR: could not create a GL context: %s\n", SDL_GetError());
+        if (window) SDL_DestroyWindow(window);
+        SDL_Quit();
+        return nullptr;
+    }
+    SDL_GL_SetSwapInterval(0);
+    return window;
+}
+
+//the original canvas upload, which creates and deletes everything every frame,
+//kept as a reference to check and time the presenter against
+static void draw_canvas_per_frame(int shader, Canvas & canvas, float ww, float wh) {
+    uint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    int w = canvas.width + canvas.margin * 2, h = canvas.height + canvas.margin * 2;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, canvas.basePointer());
+
+    float u1 = canvas.margin / (float) w - 0.5f / ww;
+    float v1 = canvas.margin / (float) h - 0.5f / wh;
+    float u2 = 1 - u1 - 1.0f / ww;
+    float v2 = 1 - v1 - 1.0f / wh;
+    float x = fminf(1, (wh / ww) / (canvas.height / (float) canvas.width));
+    float y = fminf(1, (ww / wh) / (canvas.width / (float) canvas.height));
+    struct TexVert { Vec2 pos, uv; };
+    TexVert verts[6] = {
+        { vec2(-x,  y), vec2(u1, v1) },
+        { vec2( x,  y), vec2(u2, v1) },
+        { vec2( x, -y), vec2(u2, v2) },
+        { vec2(-x,  y), vec2(u1, v1) },
+        { vec2( x, -y), vec2(u2, v2) },
+        { vec2(-x, -y), vec2(u1, v2) },
+    };
+
+    uint vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TexVert), (void *) offsetof(TexVert, pos));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TexVert), (void *) offsetof(TexVert, uv));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    glUseProgram(shader);
+    glUniform2f(glGetUniformLocation(shader, "texSize"), w, h);
+    glUniform1f(glGetUniformLocation(shader, "scale"), fminf(ww / canvas.width, wh / canvas.height));
+    glDrawArrays(GL_TRIANGLES, 0, ARR_SIZE(verts));
+
+    glDeleteTextures(1, &tex);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    gl_error("draw_canvas_per_frame()");
+}
+
+//every GL function presenting the canvas and flushing `Imm` call, wrapped so that the calls can be counted
+#define COUNTED_GL_FUNCTIONS(X) \
+    X(glGenTextures) X(glDeleteTextures) X(glBindTexture) X(glTexParameteri) X(glTexImage2D) X(glTexSubImage2D) \
+    X(glGenVertexArrays) X(glDeleteVertexArrays) X(glBindVertexArray) X(glVertexAttribPointer) \
+    X(glEnableVertexAttribArray) X(glGenBuffers) X(glDeleteBuffers) X(glBindBuffer) X(glBufferData) \
+    X(glBufferSubData) X(glMapBufferRange) X(glUnmapBuffer) X(glActiveTexture) X(glUseProgram) \
+    X(glGetUniformLocation) X(glUniform1i) X(glUniform2f) X(glUniform1f) X(glUniformMatrix4fv) X(glDrawArrays) X(glGetError) \
+    X(glDrawArraysInstanced) X(glFenceSync) X(glClientWaitSync) X(glDeleteSync)
+
+static int glCallCount;
+#define COUNTED_GL_FUNCTION(name) \
+    static decltype(glad_##name) real_##name; \
+    template <typename... ARGS> static auto APIENTRY counted_##name(ARGS... args) -> decltype(real_##name(args...)) { \
+        glCallCount += 1; \
+        return real_##name(args...); \
+    }
+COUNTED_GL_FUNCTIONS(COUNTED_GL_FUNCTION)
+
+static void count_gl_calls(bool count) {
+    #define SWAP_GL_FUNCTION(name) \
+        if (count) real_##name = glad_##name, glad_##name = counted_##name; else glad_##name = real_##name;
+    COUNTED_GL_FUNCTIONS(SWAP_GL_FUNCTION)
+    glCallCount = 0;
+}
+
+//presents a changing canvas in a hidden window the old way and through the presenter, checking that both put the
+//same image on screen, and reports the time to submit a frame, the time until the GPU has finished drawing it,
+//and the GL calls made per frame.
+//with no display or GPU this runs on Mesa's software renderer: SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1
+static int run_present_benchmark(int seed) {
+    static const int FRAMES = 500;
+    static const int WINDOW_WIDTH = CANVAS_WIDTH * 2, WINDOW_HEIGHT = CANVAS_HEIGHT * 2;
+    global_pcg_state = seed;
+
+    SDL_GLContext context;
+    SDL_Window * window = open_hidden_window("present benchmark", WINDOW_WIDTH, WINDOW_HEIGHT, context);
+    if (!window) return 1;
+    printf("[] present benchmark: %d frames of %dx%d to %dx%d on %s\n", FRAMES, CANVAS_WIDTH, CANVAS_HEIGHT,
+        WINDOW_WIDTH, WINDOW_HEIGHT, glGetString(GL_RENDERER));
+
+    uint shader = create_program_from_files("res/blit.vert", "res/blit.frag");
+    CanvasPresenter presenter = make_canvas_presenter(shader);
+    Canvas canvas = make_canvas(CANVAS_WIDTH, CANVAS_HEIGHT, 16);
+    int frameBytes = WINDOW_WIDTH * WINDOW_HEIGHT * 4;
+    u8 * screens[2] = { (u8 *) malloc(frameBytes), (u8 *) malloc(frameBytes) };
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glEnable(GL_FRAMEBUFFER_SRGB);
+
+    int mismatches = 0;
+    uint64_t submitTimes[2] = {}, totalTimes[2] = {};
+    int calls[2] = {};
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        //scribble over part of the canvas so every frame has something new to upload
+        for (int i = 0; i < 1000; ++i) canvas[rand_int(canvas.height)][rand_int(canvas.width)] =
+            { (u8) rand_int(256), (u8) rand_int(256), (u8) rand_int(256), 255 };
+        for (int method = 0; method < 2; ++method) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            count_gl_calls(true);
+            uint64_t start = get_nanos();
+            if (method == 0) draw_canvas_per_frame(shader, canvas, WINDOW_WIDTH, WINDOW_HEIGHT);
+            else draw_canvas(presenter, canvas, WINDOW_WIDTH, WINDOW_HEIGHT);
+            submitTimes[method] += get_nanos() - start;
+            glFinish();
+            totalTimes[method] += get_nanos() - start;
+            calls[method] += glCallCount;
+            count_gl_calls(false);
+            //reading back every frame would swamp the timings
+            if (frame % 50 == 0) glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, screens[method]);
+            SDL_GL_SwapWindow(window);
+        }
+        if (frame % 50 == 0 && memcmp(screens[0], screens[1], frameBytes)) {
+            if (mismatches < 10) printf("[] ERROR: frame %d looks different through the presenter\n", frame);
+            mismatches += 1;
+        }
+    }
+    printf("%-16s%16s%16s%16s\n", "upload", "submit ms/frame", "total ms/frame", "GL calls/frame");
+    for (int method = 0; method < 2; ++method) {
+        printf("%-16s%16.3f%16.3f%16.1f\n", method? "presenter" : "per frame", submitTimes[method] / 1'000'000.0 / FRAMES,
+            totalTimes[method] / 1'000'000.0 / FRAMES, calls[method] / (double) FRAMES);
+    }
+
+    free(screens[0]);
+    free(screens[1]);
+    free(canvas.basePointer());
+    free_canvas_presenter(presenter);
+    glDeleteProgram(shader);
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return mismatches? 1 : 0;
+}
+
+//`Imm::flush()` as it was before the vertex ring and the state cache, kept as a reference to check and time against
+static void flush_imm_per_batch(Imm & imm) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, imm.tex.handle);
+    glUseProgram(imm.program.handle);
+    glUniform2f(glGetUniformLocation(imm.program.handle, "scale"), 1.0f / imm.tex.width, 1.0f / imm.tex.height);
+    glBindBuffer(GL_ARRAY_BUFFER, imm.ring.vbo);
+    glBufferData(GL_ARRAY_BUFFER, imm.used * sizeof(Vertex), imm.data, GL_DYNAMIC_DRAW);
+    glUseProgram(imm.program.handle);
+    glBindVertexArray(imm.vao);
+    glUniformMatrix4fv(glGetUniformLocation(imm.program.handle, "transform"), 1, GL_TRUE, (float *)(&imm.matrix));
+    glDrawArrays(GL_TRIANGLES, 0, imm.used);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    imm.used = 0;
+    gl_error("flush_imm_per_batch()");
+}
+
+//the vertex batches a frame of `imm` drawing got flushed in, caught at the draw calls so they can be replayed
+//NOTE: quad batches are drawn instanced, so they aren't caught and only the vertex batches get compared
+struct ImmBatch {
+    Texture tex;
+    int count;
+};
+
+static Imm * capturedImm;
+static List<ImmBatch> capturedBatches;
+static List<Vertex> capturedVertices;
+static decltype(glad_glDrawArrays) uncapturedDrawArrays;
+
+static void APIENTRY capture_draw_arrays(GLenum mode, GLint first, GLsizei count) {
+    capturedBatches.add({ capturedImm->tex, count });
+    for (int i = 0; i < count; ++i) capturedVertices.add(capturedImm->data[i]);
+    uncapturedDrawArrays(mode, first, count);
+}
+
+//a frame of the sort of overlay `imm` is for: rows of icons and labels on boxes, then some circles and curvy lines
+static void draw_imm_overlay(Imm & imm, AtlasImage icons[2], int frame) {
+    char text[64];
+    for (int row = 0; row < 24; ++row) {
+        float y = 8 + row * 30;
+        imm.rect(8, y, 420, 26, { 20, 20, 40, 160 });
+        imm.drawImage(icons[row % 2], 12, y);
+        snprintf(text, sizeof(text), "row %d, frame %d: %d bullets", row, frame, row * 37 + frame);
+        imm.drawText(text, 60, y, 0.5f, { 255, 255, 255, 255 });
+    }
+
+    imm.r = 2;
+    imm.cap = ROUND;
+    imm.join = ROUND;
+    imm.lineColor = { 255, 200, 80, 255 };
+    for (int i = 0; i < 30; ++i) {
+        float x = 500 + i % 6 * 120, y = 60 + i / 6 * 120 + frame % 10;
+        imm.circle(x, y, 20 + i, { 80, 160, 255, 128 }, { 255, 255, 255, 255 });
+        imm.beginLine();
+        for (int j = 0; j < 8; ++j) imm.lineVertex(x - 40 + j * 12, y + 40 + (j % 2) * 15);
+        imm.endLine(false);
+    }
+}
+
+//draws an overlay through `Imm`, then replays its batches through both the old flush and `Imm::flush()` in a hidden
+//window, checking that both put the same image on screen, and reports what flushing sends to GL per frame and how
+//long it takes
+static int run_imm_benchmark(int seed) {
+    static const int FRAMES = 200;
+    static const int WINDOW_WIDTH = CANVAS_WIDTH * 2, WINDOW_HEIGHT = CANVAS_HEIGHT * 2;
+    global_pcg_state = seed;
+
+    SDL_GLContext context;
+    SDL_Window * window = open_hidden_window("imm benchmark", WINDOW_WIDTH, WINDOW_HEIGHT, context);
+    if (!window) return 1;
+    printf("[] imm benchmark: %d frames at %dx%d on %s\n", FRAMES, WINDOW_WIDTH, WINDOW_HEIGHT,
+        glGetString(GL_RENDERER));
+
+    //the reference gets its own buffers, since the old flush would re-specify the ring
+    Imm imm = {}, reference = {};
+    imm.init(500); //small batches, so that there are plenty of flushes to compare
+    imm.tessellateCurves = true; //the circles and lines are the vertex batches that get replayed
+    reference.init(500);
+    //the font has its own texture, so the texture switches back and forth on every row
+    AtlasImage icons[2] = { load_atlas_image(imm.atlas, "res/shield.png"),
+                            load_atlas_image(imm.atlas, "res/ghost.png") };
+    imm.font = load_font("res/nova.fnt");
+    capturedImm = &imm;
+    int frameBytes = WINDOW_WIDTH * WINDOW_HEIGHT * 4;
+    u8 * screens[2] = { (u8 *) malloc(frameBytes), (u8 *) malloc(frameBytes) };
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    int mismatches = 0;
+    uint64_t submitTimes[2] = {}, totalTimes[2] = {};
+    int calls[2] = {};
+    ImmStats stats = {};
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        capturedBatches.len = capturedVertices.len = 0;
+        uncapturedDrawArrays = glad_glDrawArrays;
+        glad_glDrawArrays = capture_draw_arrays;
+        imm.begin(WINDOW_WIDTH, WINDOW_HEIGHT);
+        draw_imm_overlay(imm, icons, frame);
+        imm.end();
+        glad_glDrawArrays = uncapturedDrawArrays;
+
+        for (int method = 0; method < 2; ++method) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            count_gl_calls(true);
+            uint64_t start = get_nanos();
+            //both replay the same batches, so that the times are only the flushing and not building the batches
+            Imm & target = method? imm : reference;
+            target.begin(WINDOW_WIDTH, WINDOW_HEIGHT);
+            Vertex * vertices = capturedVertices.begin();
+            for (ImmBatch & batch : capturedBatches) {
+                memcpy(target.data, vertices, batch.count * sizeof(Vertex));
+                target.used = batch.count;
+                target.tex = batch.tex;
+                if (method) imm.flush();
+                else flush_imm_per_batch(reference);
+                vertices += batch.count;
+            }
+            glEnable(GL_CULL_FACE);
+            submitTimes[method] += get_nanos() - start;
+            glFinish();
+            totalTimes[method] += get_nanos() - start;
+            calls[method] += glCallCount;
+            count_gl_calls(false);
+            if (method == 1) {
+                stats.flushes += imm.stats.flushes;
+                stats.drawCalls += imm.stats.drawCalls;
+                stats.stateChanges += imm.stats.stateChanges;
+                stats.bytesUploaded += imm.stats.bytesUploaded;
+            }
+            //reading back every frame would swamp the timings
+            if (frame % 20 == 0) glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, screens[method]);
+            SDL_GL_SwapWindow(window);
+        }
+        if (frame % 20 == 0 && memcmp(screens[0], screens[1], frameBytes)) {
+            if (mismatches < 10) printf("[] ERROR: frame %d looks different through the vertex ring\n", frame);
+            mismatches += 1;
+        }
+    }
+    printf("[] per frame: %.1f flushes, %.1f draw calls, %.1f state changes, %.1f KB uploaded\n",
+        stats.flushes / (double) FRAMES, stats.drawCalls / (double) FRAMES, stats.stateChanges / (double) FRAMES,
+        stats.bytesUploaded / 1024.0 / FRAMES);
+    printf("%-16s%16s%16s%16s\n", "flush", "submit ms/frame", "total ms/frame", "GL calls/frame");
+    for (int method = 0; method < 2; ++method) {
+        printf("%-16s%16.3f%16.3f%16.1f\n", method? "ring + cache" : "per batch", submitTimes[method] / 1'000'000.0 / FRAMES,
+            totalTimes[method] / 1'000'000.0 / FRAMES, calls[method] / (double) FRAMES);
+    }
+
+    capturedBatches.finalize();
+    capturedVertices.finalize();
+    free(screens[0]);
+    free(screens[1]);
+    free_font(imm.font);
+    imm.finalize();
+    reference.finalize();
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return mismatches? 1 : 0;
+}
+
+//draws the same overlay with the font and icons in their own textures, and with everything packed into the atlas,
+//in a hidden window, and reports how many draw calls and GL calls each takes per frame and how far apart they look
+static int run_atlas_benchmark(int seed) {
+    static const int FRAMES = 200;
+    static const int WINDOW_WIDTH = CANVAS_WIDTH * 2, WINDOW_HEIGHT = CANVAS_HEIGHT * 2;
+    global_pcg_state = seed;
+
+    SDL_GLContext context;
+    SDL_Window * window = open_hidden_window("atlas benchmark", WINDOW_WIDTH, WINDOW_HEIGHT, context);
+    if (!window) return 1;
+    printf("[] atlas benchmark: %d frames at %dx%d on %s\n", FRAMES, WINDOW_WIDTH, WINDOW_HEIGHT,
+        glGetString(GL_RENDERER));
+
+    Imm imms[2] = {};
+    AtlasImage icons[2][2] = {};
+    const char * iconPaths[2] = { "res/shield.png", "res/ghost.png" };
+    for (int method = 0; method < 2; ++method) {
+        imms[method].init(1 << 14);
+        for (int i = 0; i < 2; ++i) {
+            if (method) {
+                icons[method][i] = load_atlas_image(imms[method].atlas, iconPaths[i]);
+            } else {
+                Texture tex = load_texture(iconPaths[i]);
+                icons[method][i] = { tex, 0, 0, (u16) tex.width, (u16) tex.height };
+            }
+        }
+        imms[method].font = method? load_font("res/nova.fnt", imms[method].atlas) : load_font("res/nova.fnt");
+    }
+    int frameBytes = WINDOW_WIDTH * WINDOW_HEIGHT * 4;
+    u8 * screens[2] = { (u8 *) malloc(frameBytes), (u8 *) malloc(frameBytes) };
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    int differentPixels = 0, maxDifference = 0;
+    uint64_t submitTimes[2] = {}, totalTimes[2] = {};
+    int calls[2] = {}, drawCalls[2] = {};
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        for (int method = 0; method < 2; ++method) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            count_gl_calls(true);
+            uint64_t start = get_nanos();
+            imms[method].begin(WINDOW_WIDTH, WINDOW_HEIGHT);
+            draw_imm_overlay(imms[method], icons[method], frame);
+            imms[method].end();
+            submitTimes[method] += get_nanos() - start;
+            glFinish();
+            totalTimes[method] += get_nanos() - start;
+            calls[method] += glCallCount;
+            drawCalls[method] += imms[method].stats.drawCalls;
+            count_gl_calls(false);
+            if (frame % 20 == 0) glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, screens[method]);
+            SDL_GL_SwapWindow(window);
+        }
+        //text is drawn at half size, so it's filtered, and the atlas page being a different size than the font's
+        //own texture can round the sample positions a little differently
+        if (frame % 20 == 0) {
+            for (int i = 0; i < frameBytes; i += 4) {
+                int difference = 0;
+                for (int c = 0; c < 4; ++c) difference = imax(difference, abs(screens[0][i + c] - screens[1][i + c]));
+                differentPixels += difference != 0;
+                maxDifference = imax(maxDifference, difference);
+            }
+        }
+    }
+    printf("[] %.1f pixels per frame differ, by at most %d\n", differentPixels / (FRAMES / 20.0), maxDifference);
+    printf("%-16s%16s%16s%16s%16s\n", "textures", "draws/frame", "submit ms/frame", "total ms/frame", "GL calls/frame");
+    for (int method = 0; method < 2; ++method) {
+        printf("%-16s%16.1f%16.3f%16.3f%16.1f\n", method? "atlas" : "separate", drawCalls[method] / (double) FRAMES,
+            submitTimes[method] / 1'000'000.0 / FRAMES, totalTimes[method] / 1'000'000.0 / FRAMES,
+            calls[method] / (double) FRAMES);
+    }
+    //the overlay is all quads and shapes, so with everything in the atlas it should go out in one draw of each
+    bool batched = drawCalls[1] <= 2 * FRAMES;
+    if (!batched) printf("[] ERROR: the atlas frame took more than 2 draws\n");
+
+    free(screens[0]);
+    free(screens[1]);
+    glDeleteTextures(1, &icons[0][0].tex.handle);
+    glDeleteTextures(1, &icons[0][1].tex.handle);
+    for (Imm & imm : imms) {
+        free_font(imm.font);
+        imm.finalize();
+    }
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    //NOTE: small differences in filtering aren't a failure, anything else would be
+    return maxDifference > 32 || !batched? 1 : 0;
+}
+
+//`Imm::rect()`, `Imm::drawImage()` and `Imm::drawText()` as they were before quads, six vertices each,
+//kept as a reference to check and measure against
+//NOTE: the corners get snapped to eighths of a pixel like quads do, otherwise minified text without mipmaps
+//      would alias differently and hide any actual difference
+static void draw_vertex_quad(Imm & imm, float x0, float y0, float x1, float y1,
+                             float u0, float v0, float u1, float v1, float f, Color color)
+{
+    assert(imm.depth > -0.9999f); //the benchmark never draws enough to need the depth buffer reset
+    float w = roundf((x1 - x0) * 8) / 8, h = roundf((y1 - y0) * 8) / 8;
+    x0 = roundf(x0 * 8) / 8;
+    y0 = roundf(y0 * 8) / 8;
+    x1 = x0 + w;
+    y1 = y0 + h;
+    imm.depth -= IMM_DEPTH_STEP;
+    if (imm.quadsUsed || imm.used + 6 > imm.total) imm.flush();
+    Vertex * v = imm.data + imm.used;
+    v[0] = { x0, y0, imm.depth, color, u0, v0, f };
+    v[1] = { x0, y1, imm.depth, color, u0, v1, f };
+    v[2] = { x1, y0, imm.depth, color, u1, v0, f };
+    v[3] = { x0, y1, imm.depth, color, u0, v1, f };
+    v[4] = { x1, y0, imm.depth, color, u1, v0, f };
+    v[5] = { x1, y1, imm.depth, color, u1, v1, f };
+    imm.used += 6;
+}
+
+//a frame of rows of icons and labels on boxes, next to a page of small print, drawn as quads or as vertices
+//returns the number of quads drawn
+static int draw_quad_overlay(Imm & imm, AtlasImage icons[2], int frame, bool vertices) {
+    int count = 0;
+    char text[128];
+    auto draw_text = [&] (float x, float y, float s, Color color) {
+        if (!vertices) {
+            imm.drawText(text, x, y, s, color);
+        } else {
+            imm.useTexture(imm.font.tex);
+            for (char * c = text; *c; ++c) {
+                Char * ch = imm.font.chars + *c;
+                float x0 = x + ch->xoffset * s, y0 = y + ch->yoffset * s;
+                draw_vertex_quad(imm, x0, y0, x0 + ch->width * s, y0 + ch->height * s,
+                    ch->x, ch->y, ch->x + ch->width, ch->y + ch->height, 1, color);
+                x += imm.font.advances[(int) *c] * s;
+            }
+        }
+        count += strlen(text);
+    };
+
+    for (int row = 0; row < 24; ++row) {
+        float y = 8 + row * 30;
+        Color box = { 20, 20, 40, 160 };
+        AtlasImage & icon = icons[row % 2];
+        if (!vertices) {
+            imm.rect(8, y, 420, 26, box);
+            imm.drawImage(icon, 12, y);
+        } else {
+            draw_vertex_quad(imm, 8, y, 428, y + 26, 0, 0, 0, 0, 0, box);
+            imm.useTexture(icon.tex);
+            draw_vertex_quad(imm, 12, y, 12 + icon.width, y + icon.height, icon.x, icon.y + icon.height,
+                icon.x + icon.width, icon.y, 1, { 255, 255, 255, 255 });
+        }
+        count += 2;
+        snprintf(text, sizeof(text), "row %d, frame %d: %d bullets", row, frame, row * 37 + frame);
+        draw_text(60, y, 0.5f, { 255, 255, 255, 255 });
+    }
+    for (int line = 0; line < 48; ++line) {
+        snprintf(text, sizeof(text), "%3d: the quick brown fox jumps over the lazy dog %d times", line, frame + line);
+        draw_text(700, 8 + line * 15, 0.3f, { 200, 255, 200, 255 });
+    }
+    return count;
+}
+
+//draws text, rects and images as instanced quads and as six vertices each in a hidden window, and reports how much
+//each uploads per quad and per frame, how long each takes, and how far apart they look
+static int run_quad_benchmark(int seed) {
+    static const int FRAMES = 200;
+    static const int WINDOW_WIDTH = CANVAS_WIDTH * 2, WINDOW_HEIGHT = CANVAS_HEIGHT * 2;
+    global_pcg_state = seed;
+
+    SDL_GLContext context;
+    SDL_Window * window = open_hidden_window("quad benchmark", WINDOW_WIDTH, WINDOW_HEIGHT, context);
+    if (!window) return 1;
+    printf("[] quad benchmark: %d frames at %dx%d on %s\n", FRAMES, WINDOW_WIDTH, WINDOW_HEIGHT,
+        glGetString(GL_RENDERER));
+
+    Imm imm = {};
+    imm.init(1 << 14);
+    AtlasImage icons[2] = { load_atlas_image(imm.atlas, "res/shield.png"),
+                            load_atlas_image(imm.atlas, "res/ghost.png") };
+    imm.font = load_font("res/nova.fnt", imm.atlas);
+    int frameBytes = WINDOW_WIDTH * WINDOW_HEIGHT * 4;
+    u8 * screens[2] = { (u8 *) malloc(frameBytes), (u8 *) malloc(frameBytes) };
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    int differentPixels = 0, maxDifference = 0;
+    uint64_t submitTimes[2] = {}, totalTimes[2] = {};
+    int calls[2] = {}, drawCalls[2] = {};
+    size_t bytes[2] = {};
+    int quads = 0;
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        for (int method = 0; method < 2; ++method) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            count_gl_calls(true);
+            uint64_t start = get_nanos();
+            imm.begin(WINDOW_WIDTH, WINDOW_HEIGHT);
+            int count = draw_quad_overlay(imm, icons, frame, !method);
+            imm.end();
+            submitTimes[method] += get_nanos() - start;
+            glFinish();
+            totalTimes[method] += get_nanos() - start;
+            calls[method] += glCallCount;
+            drawCalls[method] += imm.stats.drawCalls;
+            bytes[method] += imm.stats.bytesUploaded;
+            if (method) quads += count;
+            count_gl_calls(false);
+            if (frame % 20 == 0) glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, screens[method]);
+            SDL_GL_SwapWindow(window);
+        }
+        //the texture coordinates get interpolated differently across the triangles, which can round differently
+        if (frame % 20 == 0) {
+            for (int i = 0; i < frameBytes; i += 4) {
+                int difference = 0;
+                for (int c = 0; c < 4; ++c) difference = imax(difference, abs(screens[0][i + c] - screens[1][i + c]));
+                differentPixels += difference != 0;
+                maxDifference = imax(maxDifference, difference);
+            }
+        }
+    }
+    printf("[] %.1f quads per frame, %.1f pixels per frame differ, by at most %d\n", quads / (double) FRAMES,
+        differentPixels / (FRAMES / 20.0), maxDifference);
+    printf("%-16s%16s%16s%16s%16s%16s\n", "drawn as", "bytes/quad", "KB/frame", "draws/frame",
+        "submit ms/frame", "total ms/frame");
+    for (int method = 0; method < 2; ++method) {
+        printf("%-16s%16.1f%16.1f%16.1f%16.3f%16.3f\n", method? "quads" : "vertices", bytes[method] / (double) quads,
+            bytes[method] / 1024.0 / FRAMES, drawCalls[method] / (double) FRAMES,
+            submitTimes[method] / 1'000'000.0 / FRAMES, totalTimes[method] / 1'000'000.0 / FRAMES);
+    }
+
+    free(screens[0]);
+    free(screens[1]);
+    free_font(imm.font);
+    imm.finalize();
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    //NOTE: small differences in filtering aren't a failure, anything else would be
+    return maxDifference > 32? 1 : 0;
+}
+
+//a frame of filled and outlined circles, round capped lines and wavy arcs, the sort of curvy overlay `Imm` gets
+//used for
+static void draw_shape_overlay(Imm & imm, int frame) {
+    imm.r = 2;
+    imm.cap = ROUND;
+    imm.join = ROUND;
+    for (int i = 0; i < 40; ++i) {
+        float x = 60 + i % 8 * 150, y = 70 + i / 8 * 140 + frame % 10;
+        imm.circle(x, y, 15 + i, { 80, 160, 255, 128 }, { 255, 255, 255, 255 });
+        imm.lineColor = { 255, 200, 80, 255 };
+        imm.beginLine();
+        for (int j = 0; j < 8; ++j) imm.lineVertex(x - 50 + j * 14, y + 45 + (j % 2) * 15);
+        imm.endLine(false);
+        imm.lineColor = { 120, 255, 120, 160 };
+        imm.arc(x, y, 0, -(30 + i), 30 + i, 0);
+        imm.r = 1;
+        imm.line(x - 60, y - 60, x + 60, y - 50 + i, { 255, 80, 80, 255 });
+        imm.r = 2;
+    }
+}
+
+//draws circles and round lines as shapes and as triangles in a hidden window, and reports what each uploads and
+//how long each takes per frame, and how far apart they look
+static int run_shape_benchmark(int seed) {
+    static const int FRAMES = 200;
+    static const int WINDOW_WIDTH = CANVAS_WIDTH * 2, WINDOW_HEIGHT = CANVAS_HEIGHT * 2;
+    global_pcg_state = seed;
+
+    SDL_GLContext context;
+    SDL_Window * window = open_hidden_window("shape benchmark", WINDOW_WIDTH, WINDOW_HEIGHT, context);
+    if (!window) return 1;
+    printf("[] shape benchmark: %d frames at %dx%d on %s\n", FRAMES, WINDOW_WIDTH, WINDOW_HEIGHT,
+        glGetString(GL_RENDERER));
+
+    Imm imm = {};
+    imm.init(1 << 14);
+    int frameBytes = WINDOW_WIDTH * WINDOW_HEIGHT * 4;
+    u8 * screens[2] = { (u8 *) malloc(frameBytes), (u8 *) malloc(frameBytes) };
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    int differentPixels = 0, maxBlockDifference = 0;
+    uint64_t drawTimes[2] = {}, submitTimes[2] = {}, totalTimes[2] = {};
+    int drawCalls[2] = {};
+    size_t bytes[2] = {};
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        for (int method = 0; method < 2; ++method) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            imm.tessellateCurves = !method;
+            uint64_t start = get_nanos();
+            imm.begin(WINDOW_WIDTH, WINDOW_HEIGHT);
+            draw_shape_overlay(imm, frame);
+            drawTimes[method] += get_nanos() - start;
+            imm.end();
+            submitTimes[method] += get_nanos() - start;
+            glFinish();
+            totalTimes[method] += get_nanos() - start;
+            drawCalls[method] += imm.stats.drawCalls;
+            bytes[method] += imm.stats.bytesUploaded;
+            if (frame % 20 == 0) glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, screens[method]);
+            SDL_GL_SwapWindow(window);
+        }
+        //the shapes are antialiased and the triangles aren't, so single pixels on the edges can be far apart,
+        //but averaged over 4x4 blocks only a shape that's in the wrong place or the wrong size stands out
+        if (frame % 20 == 0) {
+            for (int i = 0; i < frameBytes; i += 4) {
+                for (int c = 0; c < 4; ++c) {
+                    if (screens[0][i + c] != screens[1][i + c]) {
+                        differentPixels += 1;
+                        break;
+                    }
+                }
+            }
+            for (int by = 0; by < WINDOW_HEIGHT; by += 4) {
+                for (int bx = 0; bx < WINDOW_WIDTH; bx += 4) {
+                    for (int c = 0; c < 4; ++c) {
+                        int sums[2] = {};
+                        for (int y = by; y < by + 4; ++y) {
+                            for (int x = bx; x < bx + 4; ++x) {
+                                sums[0] += screens[0][(y * WINDOW_WIDTH + x) * 4 + c];
+                                sums[1] += screens[1][(y * WINDOW_WIDTH + x) * 4 + c];
+                            }
+                        }
+                        maxBlockDifference = imax(maxBlockDifference, abs(sums[0] - sums[1]) / 16);
+                    }
+                }
+            }
+        }
+    }
+    printf("[] %.1f pixels per frame differ, 4x4 blocks by at most %d\n", differentPixels / (FRAMES / 20.0),
+        maxBlockDifference);
+    printf("%-16s%16s%16s%16s%16s%16s\n", "drawn as", "KB/frame", "draws/frame", "record ms/frame",
+        "submit ms/frame", "total ms/frame");
+    for (int method = 0; method < 2; ++method) {
+        printf("%-16s%16.1f%16.1f%16.3f%16.3f%16.3f\n", method? "shapes" : "triangles",
+            bytes[method] / 1024.0 / FRAMES, drawCalls[method] / (double) FRAMES, drawTimes[method] / 1'000'000.0 / FRAMES,
+            submitTimes[method] / 1'000'000.0 / FRAMES, totalTimes[method] / 1'000'000.0 / FRAMES);
+    }
+
+    free(screens[0]);
+    free(screens[1]);
+    imm.finalize();
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return maxBlockDifference > 96? 1 : 0;
+}
+
+//loads the font from the .fnt, which bakes it first, and from the baked file, in a hidden window (for the texture
+//upload), and times measuring text with the advance table, with kerning off and on
+static int run_font_benchmark(int seed) {
+    static const int LOADS = 20;
+    static const int STRINGS = 1000;
+    static const char * FONT_PATH = "res/nova.fnt";
+    global_pcg_state = seed;
+
+    SDL_GLContext context;
+    SDL_Window * window = open_hidden_window("font benchmark", 64, 64, context);
+    if (!window) return 1;
+    printf("[] font benchmark: %s, %d loads, %d strings\n", FONT_PATH, LOADS, STRINGS);
+
+    char * bakedPath = dsprintf(nullptr, "%s.bin", FONT_PATH);
+    uint64_t loadTimes[2] = {};
+    Font font = {};
+    for (int method = 0; method < 2; ++method) {
+        for (int i = 0; i < LOADS; ++i) {
+            if (!method) remove(bakedPath);
+            uint64_t start = get_nanos();
+            font = load_font(FONT_PATH);
+            loadTimes[method] += get_nanos() - start;
+            if (i < LOADS - 1 || !method) free_font(font);
+        }
+    }
+
+    //a font with a single kerning pair, which has to add exactly its amount to the width of text that has the pair
+    //in it, and only in the order it's given in (so "AAVV" gets it once, and only once the pair isn't swapped)
+    static const char * KERNING_FONT_PATH = "res/bench-kerning.fnt";
+    static const char * KERNING_FONT =
+        "common lineHeight=124 base=96 scaleW=512 scaleH=512 pages=1\n"
+        "page id=0 file=\"nova.png\"\n"
+        "char id=65 x=0 y=0 width=40 height=60 xoffset=0 yoffset=0 xadvance=49\n"
+        "char id=86 x=40 y=0 width=40 height=60 xoffset=0 yoffset=0 xadvance=51\n"
+        "kerning first=65 second=86 amount=-5\n";
+    int mismatches = 0;
+    if (!write_entire_file(KERNING_FONT_PATH, KERNING_FONT)) {
+        printf("[] ERROR: could not write %s\n", KERNING_FONT_PATH);
+        mismatches += 1;
+    } else {
+        Font kerningFont = load_font(KERNING_FONT_PATH);
+        float scale = 0.5f;
+        float plain = text_width(kerningFont, scale, "AAVV");
+        kerningFont.kerning = true;
+        float kerned = text_width(kerningFont, scale, "AAVV");
+        if (kerningFont.kerningPairs == nullptr || kerned - plain != -5 * scale) {
+            printf("[] ERROR: kerning changed the width of \"AAVV\" by %f instead of %f\n", kerned - plain, -5 * scale);
+            mismatches += 1;
+        }
+        free_font(kerningFont);
+        char * kerningBakedPath = dsprintf(nullptr, "%s.bin", KERNING_FONT_PATH);
+        remove(KERNING_FONT_PATH);
+        remove(kerningBakedPath);
+        free(kerningBakedPath);
+    }
+
+    List<char *> strings = {};
+    int chars = 0;
+    for (int i = 0; i < STRINGS; ++i) {
+        int len = rand_int(4, 80);
+        char * text = (char *) malloc(len + 1);
+        for (int j = 0; j < len; ++j) text[j] = rand_int(32, 127);
+        text[len] = '\0';
+        strings.add(text);
+        chars += len;
+    }
+    uint64_t widthTimes[2] = {};
+    float widths[2] = {};
+    for (int kerning = 0; kerning < 2; ++kerning) {
+        font.kerning = kerning;
+        uint64_t start = get_nanos();
+        for (int rep = 0; rep < 100; ++rep) {
+            for (char * text : strings) widths[kerning] += text_width(font, 0.5f, text);
+        }
+        widthTimes[kerning] += get_nanos() - start;
+    }
+
+    printf("[] %s %s kerning pairs\n", FONT_PATH, font.kerningPairs? "has" : "doesn't have any");
+    printf("%-20s%16s\n", "load from", "ms/load");
+    printf("%-20s%16.3f\n", ".fnt (baking)", loadTimes[0] / 1'000'000.0 / LOADS);
+    printf("%-20s%16.3f\n", "baked file", loadTimes[1] / 1'000'000.0 / LOADS);
+    printf("%-20s%16s\n", "text_width", "ns/char");
+    for (int kerning = 0; kerning < 2; ++kerning) {
+        printf("%-20s%16.3f\n", kerning? "kerning on" : "kerning off", widthTimes[kerning] / (100.0 * chars));
+    }
+
+    for (char * text : strings) free(text);
+    strings.finalize();
+    free(bakedPath);
+    free_font(font);
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return mismatches? 1 : 0;
+}
+
+int run_gl_benchmark(const char * bench, int seed) {
+    if (!strcmp(bench, "present")) return run_present_benchmark(seed);
+    if (!strcmp(bench, "imm")) return run_imm_benchmark(seed);
+    if (!strcmp(bench, "atlas")) return run_atlas_benchmark(seed);
+    if (!strcmp(bench, "quads")) return run_quad_benchmark(seed);
+    if (!strcmp(bench, "shapes")) return run_shape_benchmark(seed);
+    if (!strcmp(bench, "fonts")) return run_font_benchmark(seed);
+    return -1;
+}
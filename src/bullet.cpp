@@ -0,0 +1,143 @@
+#include "bullet.hpp"
+#include "cpu.hpp"
+#include "trace.hpp"
+#include <immintrin.h>
+#include <string.h>
+
+void BulletPool::add(Vec2 pos, Vec2 vel) {
+    if (len == max) {
+        max = max * 2 + 64;
+        posx = (float *) realloc(posx, max * sizeof(float));
+        posy = (float *) realloc(posy, max * sizeof(float));
+        velx = (float *) realloc(velx, max * sizeof(float));
+        vely = (float *) realloc(vely, max * sizeof(float));
+        despawn = (u8 *) realloc(despawn, max * sizeof(u8));
+    }
+
+    posx[len] = pos.x;
+    posy[len] = pos.y;
+    velx[len] = vel.x;
+    vely[len] = vel.y;
+    despawn[len] = 0;
+    ++len;
+}
+
+void BulletPool::finalize() {
+    free(posx);
+    free(posy);
+    free(velx);
+    free(vely);
+    free(despawn);
+    *this = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// INTEGRATION KERNELS                                                                                              ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//NOTE: the vector paths must do exactly the same sequence of IEEE operations as the scalar path, in the same order,
+//      so that they round identically. in particular nothing here may be contracted into an FMA,
+//      which is why the AVX2 path doesn't also enable the FMA target feature
+
+struct BulletStep {
+    float tick;
+    float decay; //how much of the speed above BULLET_VEL_MIN is left after one tick
+    float cx, cy;
+    float despawnRadius2;
+};
+
+static void integrate_bullets_scalar(BulletPool & pool, BulletStep step, int first, int last) {
+    for (int i = first; i < last; ++i) {
+        float vx = pool.velx[i], vy = pool.vely[i];
+        float speed = sqrtf(vx * vx + vy * vy);
+        float scale = speed == 0? 0 : (BULLET_VEL_MIN + (speed - BULLET_VEL_MIN) * step.decay) / speed;
+        vx = vx * scale;
+        vy = vy * scale;
+        float px = pool.posx[i] + vx * step.tick;
+        float py = pool.posy[i] + vy * step.tick;
+        float dx = px - step.cx, dy = py - step.cy;
+        pool.velx[i] = vx;
+        pool.vely[i] = vy;
+        pool.posx[i] = px;
+        pool.posy[i] = py;
+        pool.despawn[i] = dx * dx + dy * dy > step.despawnRadius2;
+    }
+}
+
+//expands the low 4 bits of a movemask into one 0/1 byte per bit
+static inline u32 spread_mask_bits(int mask) {
+    return (mask & 1) | (mask & 2) << 7 | (mask & 4) << 14 | (mask & 8) << 21;
+}
+
+static void integrate_bullets_sse2(BulletPool & pool, BulletStep step, int first, int last) {
+    __m128 tick = _mm_set1_ps(step.tick);
+    __m128 decay = _mm_set1_ps(step.decay);
+    __m128 velMin = _mm_set1_ps(BULLET_VEL_MIN);
+    __m128 cx = _mm_set1_ps(step.cx), cy = _mm_set1_ps(step.cy);
+    __m128 radius2 = _mm_set1_ps(step.despawnRadius2);
+    __m128 zero = _mm_setzero_ps();
+
+    int i = first;
+    for (; i + 4 <= last; i += 4) {
+        __m128 vx = _mm_loadu_ps(pool.velx + i), vy = _mm_loadu_ps(pool.vely + i);
+        __m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+        __m128 newSpeed = _mm_add_ps(velMin, _mm_mul_ps(_mm_sub_ps(speed, velMin), decay));
+        __m128 scale = _mm_and_ps(_mm_cmpneq_ps(speed, zero), _mm_div_ps(newSpeed, speed));
+        vx = _mm_mul_ps(vx, scale);
+        vy = _mm_mul_ps(vy, scale);
+        __m128 px = _mm_add_ps(_mm_loadu_ps(pool.posx + i), _mm_mul_ps(vx, tick));
+        __m128 py = _mm_add_ps(_mm_loadu_ps(pool.posy + i), _mm_mul_ps(vy, tick));
+        __m128 dx = _mm_sub_ps(px, cx), dy = _mm_sub_ps(py, cy);
+        __m128 far = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), radius2);
+        _mm_storeu_ps(pool.velx + i, vx);
+        _mm_storeu_ps(pool.vely + i, vy);
+        _mm_storeu_ps(pool.posx + i, px);
+        _mm_storeu_ps(pool.posy + i, py);
+        u32 flags = spread_mask_bits(_mm_movemask_ps(far));
+        memcpy(pool.despawn + i, &flags, 4);
+    }
+    integrate_bullets_scalar(pool, step, i, last);
+}
+
+__attribute__((target("avx2")))
+static void integrate_bullets_avx2(BulletPool & pool, BulletStep step, int first, int last) {
+    __m256 tick = _mm256_set1_ps(step.tick);
+    __m256 decay = _mm256_set1_ps(step.decay);
+    __m256 velMin = _mm256_set1_ps(BULLET_VEL_MIN);
+    __m256 cx = _mm256_set1_ps(step.cx), cy = _mm256_set1_ps(step.cy);
+    __m256 radius2 = _mm256_set1_ps(step.despawnRadius2);
+    __m256 zero = _mm256_setzero_ps();
+
+    int i = first;
+    for (; i + 8 <= last; i += 8) {
+        __m256 vx = _mm256_loadu_ps(pool.velx + i), vy = _mm256_loadu_ps(pool.vely + i);
+        __m256 speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)));
+        __m256 newSpeed = _mm256_add_ps(velMin, _mm256_mul_ps(_mm256_sub_ps(speed, velMin), decay));
+        __m256 scale = _mm256_and_ps(_mm256_cmp_ps(speed, zero, _CMP_NEQ_UQ), _mm256_div_ps(newSpeed, speed));
+        vx = _mm256_mul_ps(vx, scale);
+        vy = _mm256_mul_ps(vy, scale);
+        __m256 px = _mm256_add_ps(_mm256_loadu_ps(pool.posx + i), _mm256_mul_ps(vx, tick));
+        __m256 py = _mm256_add_ps(_mm256_loadu_ps(pool.posy + i), _mm256_mul_ps(vy, tick));
+        __m256 dx = _mm256_sub_ps(px, cx), dy = _mm256_sub_ps(py, cy);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        __m256 far = _mm256_cmp_ps(d2, radius2, _CMP_GT_OQ);
+        _mm256_storeu_ps(pool.velx + i, vx);
+        _mm256_storeu_ps(pool.vely + i, vy);
+        _mm256_storeu_ps(pool.posx + i, px);
+        _mm256_storeu_ps(pool.posy + i, py);
+        int mask = _mm256_movemask_ps(far);
+        u32 flags[2] = { spread_mask_bits(mask & 15), spread_mask_bits(mask >> 4) };
+        memcpy(pool.despawn + i, flags, 8);
+    }
+    integrate_bullets_scalar(pool, step, i, last);
+}
+
+void integrate_bullets(BulletPool & pool, float tick, Vec2 center, float despawnRadius) { TimeFunc
+    //NOTE: decay is computed once per tick rather than per bullet, since it only depends on the tick length
+    BulletStep step = { tick, powf(0.4f, tick), center.x, center.y, despawnRadius * despawnRadius };
+    switch (simdLevel) {
+        case SIMD_AVX2: integrate_bullets_avx2(pool, step, 0, pool.len); break;
+        case SIMD_SSE2: integrate_bullets_sse2(pool, step, 0, pool.len); break;
+        default: integrate_bullets_scalar(pool, step, 0, pool.len); break;
+    }
+}
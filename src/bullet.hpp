@@ -0,0 +1,34 @@
+#ifndef BULLET_HPP
+#define BULLET_HPP
+
+#include "math.hpp"
+#include "types.hpp"
+
+static const float BULLET_RADIUS = 0.5f;
+static const float BULLET_VEL_MAX = 40.0f;
+static const float BULLET_VEL_MIN = 16.0f;
+
+//bullets are stored as a structure of arrays so the per-tick movement update can be done several bullets at a time
+//NOTE: this struct zero-initializes to a valid state, like List
+struct BulletPool {
+    float * posx;
+    float * posy;
+    float * velx;
+    float * vely;
+    u8 * despawn; //written by `integrate_bullets()`, only valid until the bullets are next compacted
+    int len;
+    int max;
+
+    void add(Vec2 pos, Vec2 vel);
+    void finalize();
+
+    inline Vec2 pos(int i) { return vec2(posx[i], posy[i]); }
+    inline Vec2 vel(int i) { return vec2(velx[i], vely[i]); }
+};
+
+//moves every bullet forward by one tick, decaying its speed toward BULLET_VEL_MIN,
+//and flags bullets further than `despawnRadius` from `center` in `pool.despawn`
+//NOTE: all code paths give bit-identical results, so the choice of path never affects the simulation
+void integrate_bullets(BulletPool & pool, float tick, Vec2 center, float despawnRadius);
+
+#endif // BULLET_HPP
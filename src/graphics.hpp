@@ -1,9 +1,22 @@
 #ifndef GRAPHICS_HPP
 #define GRAPHICS_HPP
 
+#include "pixel.hpp"
+#include "bullet.hpp"
+
 //NOTE: positive y goes down in this game, defying established convention, because that makes my life easier
 static const float PIXELS_PER_UNIT = 8;
 
+static const int CANVAS_WIDTH = 640;
+static const int CANVAS_HEIGHT = 360;
+
+//bullets are drawn as a red circle with a darker one over it that's a little bigger than their hitbox
+static const float BULLET_OUTER_RADIUS = BULLET_RADIUS * PIXELS_PER_UNIT * 1.5f; //in pixels
+static const float BULLET_INNER_RADIUS = BULLET_RADIUS * PIXELS_PER_UNIT * 1.1f; //in pixels
+static const Color BULLET_OUTER_COLOR = { 255, 0, 0, 255 };
+static const Color BULLET_INNER_COLOR = { 127, 0, 0, 255 };
+static const int BULLET_STAMP_SUBPIXELS = 4; //per axis
+
 struct Graphics {
     Image player;
     Image cursor;
@@ -12,8 +25,28 @@ struct Graphics {
     Tileset ghostAnim;
     Tileset walkerWalk;
     Tileset walkerAttack;
+    Tileset bulletStamps;
 };
 
+//a bullet pre-drawn at every subpixel offset, so that drawing one is a single sprite blit instead of two ovals:
+//tile (fx, fy) has the bullet centered on (tileWidth / 2 + fx / BULLET_STAMP_SUBPIXELS, tileHeight / 2 + ...)
+static inline Tileset make_bullet_stamps() {
+    int size = 2 * ((int) ceilf(BULLET_OUTER_RADIUS) + 1);
+    int across = size * BULLET_STAMP_SUBPIXELS;
+    Image image = { (Pixel *) calloc(across * across, sizeof(Pixel)), across, across };
+    for (int fy = 0; fy < BULLET_STAMP_SUBPIXELS; ++fy) {
+        for (int fx = 0; fx < BULLET_STAMP_SUBPIXELS; ++fx) {
+            Canvas cell = { &image[fy * size][fx * size], size, size, across, 0 };
+            float x0 = size / 2 + fx / (float) BULLET_STAMP_SUBPIXELS;
+            float y0 = size / 2 + fy / (float) BULLET_STAMP_SUBPIXELS;
+            draw_oval_f(cell, x0, y0, BULLET_OUTER_RADIUS, BULLET_OUTER_RADIUS, BULLET_OUTER_COLOR);
+            draw_oval_f(cell, x0, y0, BULLET_INNER_RADIUS, BULLET_INNER_RADIUS, BULLET_INNER_COLOR);
+        }
+    }
+    premultiply_image(image, size, size);
+    return { size, size, BULLET_STAMP_SUBPIXELS, BULLET_STAMP_SUBPIXELS, 10000.0f, image };
+}
+
 static inline Graphics load_graphics() {
     Graphics g = {};
     g.player = load_image("res/player-placeholder.png");
@@ -23,6 +56,7 @@ static inline Graphics load_graphics() {
     g.ghostAnim = load_tileset("res/ghost-anim.png", 16, 16);
     g.walkerWalk = load_tileset("res/walker.png", 16, 32);
     g.walkerAttack = load_tileset("res/walker-attack.png", 48, 48);
+    g.bulletStamps = make_bullet_stamps();
     return g;
 }
 
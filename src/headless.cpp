@@ -0,0 +1,43 @@
+//entry point of the headless build (`bob -headless`), which leaves out SDL, GL, audio and imgui
+//so that the CPU benchmarks and the --render golden checks can build and run on a Linux CI machine.
+//the game build doesn't compile this file, its main() in main.cpp runs the same modes before opening a window
+
+#include "bench.hpp"
+#include "trace.hpp"
+#include "jobs.hpp"
+#include "platform.hpp"
+#include "common.hpp"
+#include "math.hpp"
+#include <time.h>
+
+int run_gl_benchmark(const char * bench, int seed) {
+    static const char * glBenchmarks[] = { "present", "imm", "atlas", "quads", "shapes", "fonts" };
+    for (int i = 0; i < ARR_SIZE(glBenchmarks); ++i) {
+        if (!strcmp(bench, glBenchmarks[i])) {
+            printf("[] the %s benchmark needs a GL context, which only the game build has\n", bench);
+            return 1;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char ** argv) {
+    init_profiling_trace();
+    init_job_system();
+    global_pcg_state = time(NULL);
+
+    //set the current working directory to the folder containing the executable, like the game does
+    char * slash = strrchr(argv[0], '/');
+    if (slash) {
+        *slash = '\0';
+        set_current_working_directory(argv[0]);
+        *slash = '/';
+    }
+
+    int ret = run_headless(argc, argv);
+    if (ret < 0) {
+        printf("usage: %s --headless | --render | --bench NAME [options], see src/bench.hpp\n", argv[0]);
+        return 1;
+    }
+    return ret;
+}
@@ -2,6 +2,8 @@
 #include "platform.hpp"
 #include "trace.hpp"
 #include "deep.hpp"
+#include "hash.hpp"
+#include "jobs.hpp"
 #include <algorithm>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -29,8 +31,10 @@ struct Serializer {
     bool writing;
 
     //reader state
+    char * start;
     char * head;
     char * end;
+    bool failed; //set instead of reading past `end`, and everything read after that comes out zeroed
 
     //writer state
     List<char> writer;
@@ -38,8 +42,10 @@ struct Serializer {
     inline void go(void * mem, size_t bytes) {
         if (writing) {
             writer.add((char *) mem, bytes);
+        } else if (failed || (size_t) (end - head) < bytes) {
+            failed = true;
+            memset(mem, 0, bytes);
         } else {
-            assert(head + bytes <= end);
             memcpy(mem, head, bytes);
             head += bytes;
         }
@@ -47,12 +53,37 @@ struct Serializer {
 
     template <typename TYPE>
     inline void go(TYPE * x) {
-        go(x, sizeof(x));
+        go(x, sizeof(*x));
     }
 
+    //big arrays are stored 8-byte aligned, so that instead of copying them out when reading,
+    //we can point straight at them. this only works if the data being read stays alive (e.g. mapped) after reading
+    template <typename TYPE>
+    inline void go_in_place(TYPE ** x, int32_t count) {
+        static_assert(alignof(TYPE) <= 8, "in-place arrays are only 8-byte aligned");
+        if (writing) {
+            while (writer.len % 8) writer.add(0);
+            writer.add((char *) *x, count * sizeof(TYPE));
+        } else {
+            head = start + (head - start + 7) / 8 * 8;
+            if (failed || count < 0 || head > end || (size_t) (end - head) < count * sizeof(TYPE)) {
+                failed = true;
+                *x = nullptr;
+                return;
+            }
+            *x = (TYPE *) head;
+            head += count * sizeof(TYPE);
+        }
+    }
+
+    void go(Section * x);
+    void go(SectionSet * x);
+
     inline void go(char ** x) {
         int32_t len = writing && *x? strlen(*x) : 0;
         go(&len);
+        if (!writing && len < 0) failed = true;
+        if (!writing && failed) len = 0;
         if (!writing) *x = (char *) malloc(len + 1);
         go(*x, len);
         if (!writing) (*x)[len] = '\0';
@@ -62,7 +93,7 @@ struct Serializer {
         if (!writing) assert(!x->data && !x->len && !x->max);
         int32_t count = x->len; // shall be 0 in reading-mode
         go(&count);
-        for (int32_t i = 0; i < count; ++i) {
+        for (int32_t i = 0; i < count && !failed; ++i) {
             if (!writing) x->add({}); //PERF: pre-allocate the array instead of adding individually
             go(&(*x)[i]);
         }
@@ -70,10 +101,10 @@ struct Serializer {
 
     void start_read(void * start, size_t bytes) {
         writing = false;
-        head = (char *) start;
+        this->start = head = (char *) start;
         end = head + bytes;
         go(&ver);
-        assert(ver >= 0 && ver <= SV_LATEST);
+        if (ver < 0 || ver > SV_LATEST) failed = true;
     }
 
     void start_write() {
@@ -84,6 +115,499 @@ struct Serializer {
     }
 };
 
+void Serializer::go(Section * x) {
+    SV_ADD(SV_INITIAL, width);
+    SV_ADD(SV_INITIAL, solidStride);
+    SV_ADD(SV_INITIAL, spawnCount);
+    SV_ADD(SV_INITIAL, tileset);
+    SV_ADD(SV_INITIAL, firstGid);
+    go_in_place(&x->tiles, x->width * LEVEL_HEIGHT);
+    go_in_place(&x->solid, x->solidStride * LEVEL_HEIGHT);
+    go_in_place(&x->spawns, x->spawnCount);
+}
+
+void Serializer::go(SectionSet * x) {
+    SV_ADD(SV_INITIAL, paletteLen);
+    SV_ADD(SV_INITIAL, palette);
+    for (Section & section : x->sections) go(&section);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// DEEP BOILERPLATE                                                                                                 ///
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// LEVEL GENERATION                                                                                                 ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns the palette index of `tile`, adding it to the palette if it isn't there yet
+static u8 palette_index(SectionSet & set, Tile tile) {
+    for (int i = 0; i < set.paletteLen; ++i) {
+        if (!memcmp(&set.palette[i], &tile, sizeof(Tile))) {
+            return i;
+        }
+    }
+    assert(set.paletteLen < ARR_SIZE(set.palette));
+    set.palette[set.paletteLen] = tile;
+    return set.paletteLen++;
+}
+
+//converts the Tiled sections into their compact form
+//NOTE: the sections are parsed and converted in parallel, except for assigning palette indices,
+//      which happens afterwards in section order so that the palette comes out the same every time
+static SectionSet convert_sections() { TimeFunc
+    SectionSet set = {};
+    Tile * sectionTiles[SECTION_COUNT] = {};
+    parallel_for(SECTION_COUNT, 1, [&] (int first, int last) {
+        for (int i = first; i < last; ++i) {
+            Tilemap map;
+            char * path = dsprintf(nullptr, "res/section%d.json", i);
+            map.LoadMap(path);
+            free(path);
+            assert(map.mapLayers.size() == 4);
+            for (int l = 0; l < 4; ++l) assert(map.mapLayers[l].height == LEVEL_HEIGHT);
+            assert(map.tilesetImages.size() == 1);
+
+            Section & section = set.sections[i];
+            section.width = map.mapLayers[0].width;
+            //the run table relies on no section being narrower than its granularity (see RUN_TABLE_GRANULARITY)
+            assert(section.width >= RUN_TABLE_GRANULARITY);
+            section.solidStride = section.width / 64 + 2;
+            section.solid = (u64 *) calloc(section.solidStride * LEVEL_HEIGHT, sizeof(u64));
+            section.tileset = dup(map.tilesetImages[0].c_str());
+            section.firstGid = map.tilesetFirstGids[0];
+            sectionTiles[i] = (Tile *) malloc(section.width * LEVEL_HEIGHT * sizeof(Tile));
+            List<SectionSpawn> spawns = {};
+            for (int x = 0; x < section.width; ++x) {
+                for (int y = 0; y < LEVEL_HEIGHT; ++y) {
+                    //NOTE: gids with Tiled's flip flags set end up negative here, so they're treated as empty
+                    int idx = section.width * y + x;
+                    Tile tile = { {
+                        map.mapLayers[0].data[idx] - section.firstGid,
+                        map.mapLayers[1].data[idx] - section.firstGid,
+                        map.mapLayers[2].data[idx] - section.firstGid,
+                    } };
+                    sectionTiles[i][idx] = tile;
+                    if (tile.layer[2] >= 0) section.solid[y * section.solidStride + x / 64] |= 1ull << (x % 64);
+
+                    static const int ghostIdx = 2;
+                    static const int walkerIdx = 6;
+                    int enemyIdx = map.mapLayers[3].data[idx] - section.firstGid;
+                    if (enemyIdx == ghostIdx) {
+                        spawns.add({ x, y, SPAWN_GHOST });
+                    } else if (enemyIdx == walkerIdx) {
+                        spawns.add({ x, y, SPAWN_WALKER });
+                    }
+                }
+            }
+            section.spawns = spawns.data;
+            section.spawnCount = spawns.len;
+        }
+    });
+
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        Section & section = set.sections[i];
+        section.tiles = (u8 *) malloc(section.width * LEVEL_HEIGHT);
+        for (int idx = 0; idx < section.width * LEVEL_HEIGHT; ++idx) {
+            section.tiles[idx] = palette_index(set, sectionTiles[i][idx]);
+        }
+        free(sectionTiles[i]);
+    }
+    return set;
+}
+
+static const char * BAKED_SECTIONS_PATH = "res/sections.bin";
+
+//the baked file needs to be rebuilt if it's missing, older than any of the sections, or from an older version
+static bool baked_sections_stale() {
+    long long bakedTime = file_modified_time(BAKED_SECTIONS_PATH);
+    if (!bakedTime) return true;
+    for (int i = 0; i < SECTION_COUNT; ++i) {
+        char * path = dsprintf(nullptr, "res/section%d.json", i);
+        long long time = file_modified_time(path);
+        free(path);
+        if (time > bakedTime) return true;
+    }
+
+    MappedFile file = map_entire_file(BAKED_SECTIONS_PATH);
+    int32_t ver = -1;
+    if (file.data && file.size >= sizeof(ver)) memcpy(&ver, file.data, sizeof(ver));
+    unmap_file(file);
+    return ver != SV_LATEST;
+}
+
+void bake_sections(const char * path) { TimeFunc
+    SectionSet set = convert_sections();
+    Serializer s = {};
+    s.start_write();
+    s.go(&set);
+    if (!replace_entire_file(path, s.writer.data, s.writer.len)) {
+        fprintf(stderr, "ERROR: Could not write file %s\n", path);
+        exit(1);
+    }
+    s.writer.finalize();
+
+    for (Section & section : set.sections) {
+        free(section.tiles);
+        free(section.solid);
+        free(section.spawns);
+        free(section.tileset);
+    }
+}
+
+static SectionSet sectionSet;
+static MappedFile sectionFile; //mapped for the lifetime of the program, since `sectionSet` points into it
+
+//reads the sections out of `file`, or returns false if it's cut short, has anything left over at the end,
+//or has sizes that don't add up (e.g. from a crash while it was being written by an older build)
+static bool read_sections(MappedFile file, SectionSet & set) {
+    set = {};
+    if (!file.data) return false;
+    Serializer s = {};
+    s.start_read((void *) file.data, file.size);
+    s.go(&set);
+    bool valid = !s.failed && s.head == s.end && set.paletteLen >= 0 && set.paletteLen <= 256;
+    for (Section & section : set.sections) {
+        valid = valid && section.width >= RUN_TABLE_GRANULARITY && section.solidStride == section.width / 64 + 2;
+    }
+    if (!valid) {
+        for (Section & section : set.sections) free(section.tileset);
+        set = {};
+    }
+    return valid;
+}
+
+//sections are loaded the first time a level is created and then shared by every level after that
+static SectionSet * load_sections() { TimeFunc
+    if (sectionFile.data) return &sectionSet;
+    if (baked_sections_stale()) {
+        print_log("rebuilding %s\n", BAKED_SECTIONS_PATH);
+        bake_sections(BAKED_SECTIONS_PATH);
+    }
+
+    sectionFile = map_entire_file(BAKED_SECTIONS_PATH);
+    if (!read_sections(sectionFile, sectionSet)) {
+        print_log("rebuilding %s, which couldn't be read\n", BAKED_SECTIONS_PATH);
+        unmap_file(sectionFile);
+        bake_sections(BAKED_SECTIONS_PATH);
+        sectionFile = map_entire_file(BAKED_SECTIONS_PATH);
+        if (!read_sections(sectionFile, sectionSet)) {
+            fprintf(stderr, "ERROR: Could not load file %s\n", BAKED_SECTIONS_PATH);
+            exit(1);
+        }
+    }
+    return &sectionSet;
+}
+
+//lays out the whole level as a list of section runs, which only takes one entry per section
+static void generate_runs(TileGrid & grid, u32 seed) { TimeFunc
+    List<SectionRun> runs = {};
+    for (int xstart = 0; xstart < grid.width;) {
+        //the level always starts with section 0, the rest are picked at random
+        int sectionIdx = runs.len? 1 + hash(seed ^ hash(runs.len)) % (SECTION_COUNT - 1) : 0;
+        runs.add({ (u8) sectionIdx, xstart });
+        xstart += grid.set->sections[sectionIdx].width;
+    }
+    grid.runs = runs.data;
+    grid.runCount = runs.len;
+
+    int tableLen = (grid.width + RUN_TABLE_GRANULARITY - 1) / RUN_TABLE_GRANULARITY;
+    assert(grid.runCount <= 0xFFFF);
+    grid.runTable = (u16 *) malloc(tableLen * sizeof(u16));
+    for (int i = 0, run = 0; i < tableLen; ++i) {
+        while (run + 1 < grid.runCount && grid.runs[run + 1].xstart <= i * RUN_TABLE_GRANULARITY) ++run;
+        grid.runTable[i] = run;
+    }
+}
+
+//deterministic per-tile randomness, so that a chunk spawns the same entities every time it's streamed in
+static inline u32 tile_hash(u32 seed, int x, int y, u32 salt) {
+    return hash(seed ^ hash(x ^ hash(y ^ hash(salt))));
+}
+
+//returns a number in [0, 1)
+static inline float tile_random(u32 seed, int x, int y, u32 salt) {
+    return (tile_hash(seed, x, y, salt) & 0x00FFFFFF) * 5.9604644775390625e-8f;
+}
+
+static void spawn_entity(Level & level, SectionSpawn spawn, int x) {
+    int y = spawn.y;
+    if (spawn.type == SPAWN_GHOST) {
+        level.enemies.add({ .pos = vec2(x + tile_random(level.seed, x, y, 0), y + 0.5f) * UNITS_PER_TILE,
+                            .timer = tile_random(level.seed, x, y, 1) * (BULLET_INTERVAL / BULLET_INTERVAL_VARIANCE),
+                            .rng = { (int) tile_hash(level.seed, x, y, 2) } });
+    } else if (spawn.type == SPAWN_WALKER) {
+        Vec2 pos = vec2(x + tile_random(level.seed, x, y, 0), y) * UNITS_PER_TILE;
+        level.walkers.add({ .home = pos, .pos = pos });
+    }
+}
+
+static void spawn_chunk(Level & level, int chunkIndex) {
+    TileGrid & grid = level.tiles;
+    int x0 = chunkIndex * CHUNK_WIDTH, x1 = imin(x0 + CHUNK_WIDTH, grid.width);
+    for (int x = x0; x < x1;) {
+        SectionRun & run = grid.runs[run_at(grid, x)];
+        Section & section = grid.set->sections[run.section];
+        int sx = x - run.xstart;
+        int count = imin(section.width - sx, x1 - x);
+        for (int i = 0; i < section.spawnCount; ++i) {
+            SectionSpawn & spawn = section.spawns[i];
+            if (spawn.x >= sx && spawn.x < sx + count) {
+                spawn_entity(level, spawn, run.xstart + spawn.x);
+            }
+        }
+        x += count;
+    }
+}
+
+//removes the elements of an x-sorted list whose sort key is in the range [minx, maxx)
+template <typename TYPE>
+static void remove_x_range(List<TYPE> & list, float minx, float maxx) {
+    int first = lower_bound_x(list, minx), last = lower_bound_x(list, maxx);
+    if (first < last) list.remove(first, last);
+}
+
+static void despawn_chunk(Level & level, int chunkIndex) {
+    float minx = chunkIndex * CHUNK_WIDTH * UNITS_PER_TILE, maxx = minx + CHUNK_WIDTH * UNITS_PER_TILE;
+    remove_x_range(level.enemies, minx, maxx);
+    remove_x_range(level.walkers, minx, maxx);
+}
+
+void stream_level(Level & level, float focusX) {
+    int focusChunk = imax(0, floorf(focusX / UNITS_PER_TILE)) / CHUNK_WIDTH;
+    int firstChunk = imax(0, focusChunk - CHUNKS_BEHIND);
+    bool spawnedAny = false;
+    for (int c = firstChunk; c < firstChunk + CHUNK_COUNT; ++c) {
+        int & slot = level.chunks[c % CHUNK_COUNT];
+        if (slot == c) continue;
+        TimeScope("stream chunk");
+        if (slot >= 0) despawn_chunk(level, slot);
+        spawn_chunk(level, c);
+        slot = c;
+        spawnedAny = true;
+    }
+
+    //NOTE: entities from a new chunk are appended, so they have to be sorted back into place.
+    //      this only happens when the camera crosses into a new chunk, and the lists are mostly sorted already
+    if (spawnedAny) {
+        sort_by_x(level.enemies);
+        sort_by_x(level.walkers);
+    }
+}
+
+//NOTE: this is cheap, since sections are only loaded once and the level itself is just a list of section runs
+//NOTE: this must not touch any global state other than the (read-only) sections, since it runs on the pregen thread
+Level init_level(u32 seed) { TimeFunc
+    Level level = {};
+    level.seed = seed;
+    level.tiles = { .set = load_sections(), .width = LEVEL_WIDTH, .height = LEVEL_HEIGHT };
+    generate_runs(level.tiles, level.seed);
+    for (int i = 0; i < CHUNK_COUNT; ++i) level.chunks[i] = -1;
+
+    //spawn debug/test setup
+    // level.playerStartPos = level.player.pos = vec2(20, 20);
+    level.playerStartPos = level.player.pos = vec2(80, 60);
+    // level.enemies.add({ .pos = vec2(-10 + 20, 10 + 30) });
+    // level.enemies.add({ .pos = vec2(  3 + 20, 12 + 30) });
+    // level.enemies.add({ .pos = vec2( 11 + 20, 10 + 30) });
+    level.camCenter = level.player.pos;
+    stream_level(level, level.camCenter.x);
+
+    return level;
+}
+
+void free_level(Level & level) {
+    free(level.tiles.runs);
+    free(level.tiles.runTable);
+    level.enemies.finalize();
+    level.walkers.finalize();
+    level.bullets.finalize();
+    level = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// TICK                                                                                                             ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//entities are ticked in parallel in batches of this many, so a normal amount of them never leaves the main thread
+static const int ENTITY_BATCH_SIZE = 256;
+
+//per-entity results of the parallel parts of the tick, to be applied in order afterwards
+struct TickScratch {
+    List<u8> fired; //per active enemy
+    List<u8> attacked; //per active walker
+};
+
+//NOTE: this makes `tick_level()` non-reentrant, which is fine since there's only ever one simulation running
+static TickScratch scratch;
+
+template <typename TYPE>
+static void set_len(List<TYPE> & list, int len) {
+    if ((int) list.max < len) {
+        list.max = len;
+        list.data = (TYPE *) realloc(list.data, len * sizeof(TYPE));
+    }
+    list.len = len;
+}
+
+void tick_level(Level & level, TickInput input, float tick, Coord2 viewSize, List<GameEvent> & events) {
+    stream_level(level, level.camCenter.x);
+
+    //update virtual cursor
+    level.player.cursor += vec2(input.mouseMotion) * 0.04f;
+    float cursorRadiusInner = 1.0f, cursorRadiusOuter = 5.0f;
+    if (len(level.player.cursor) < 0.001f) level.player.cursor = vec2(0, cursorRadiusInner);
+    if (len(level.player.cursor) < cursorRadiusInner) level.player.cursor = setlen(level.player.cursor, cursorRadiusInner);
+    if (len(level.player.cursor) > cursorRadiusOuter) level.player.cursor = setlen(level.player.cursor, cursorRadiusOuter);
+
+    //tick player
+    if (!level.player.dead) { TimeScope("tick player")
+        //apply gravity to player
+        Vec2 gravity = vec2(0, 8.0f);
+        level.player.vel += gravity * tick;
+        level.player.pos += level.player.vel * tick;
+
+        //kill player if they touch any solid geometry
+        if (collide_with_tiles(level.tiles, player_hitbox(level.player.pos))) {
+            level.player.dead = true;
+            events.add({ EVENT_PLAYER_DIED });
+        }
+    }
+
+    //tick enemies and spawn bullets
+    //NOTE: enemies are ticked in parallel, and only record whether they fired.
+    //      the bullets are then spawned in enemy order, so the result doesn't depend on how the work was split up
+    float activeMinX = level.player.pos.x - ACTIVE_RANGE, activeMaxX = level.player.pos.x + ACTIVE_RANGE;
+    XRange<Enemy> enemies = x_range(level.enemies, activeMinX, activeMaxX);
+    int enemyCount = enemies.end() - enemies.begin();
+    set_len(scratch.fired, enemyCount);
+    TimeLoop("tick enemies") parallel_for(enemyCount, ENTITY_BATCH_SIZE, [&] (int first, int last) {
+        for (int i = first; i < last; ++i) {
+            Enemy & enemy = enemies.first[i];
+            scratch.fired[i] = false;
+            if (len(enemy.pos - level.player.pos) > ACTIVE_RANGE) continue;
+
+            //proximity will make enemies shoot slightly faster as you get closer, to keep the game balanced
+            //NOTE: it's important to apply the proximity effect to how fast the timer counts down
+            //      instead of to its starting value, since the latter will inherently create some lag
+            //      in the responsiveness of the effect
+            float proximity = 0.2f * powf(len(enemy.pos - level.player.pos), 1.0f / 2);
+            enemy.timer -= tick / fmaxf(0.2f, proximity);
+            if (enemy.timer < 0) {
+                float random = rand_float(enemy.rng, BULLET_INTERVAL_VARIANCE, 1 / BULLET_INTERVAL_VARIANCE);
+                enemy.timer = BULLET_INTERVAL * random;
+                scratch.fired[i] = true;
+            }
+        }
+    });
+    for (int i = 0; i < enemyCount; ++i) {
+        if (scratch.fired[i]) {
+            //TODO: make enemies partly lead their shots
+            Enemy & enemy = enemies.first[i];
+            Vec2 dir = noz(level.player.pos - enemy.pos);
+            level.bullets.add(enemy.pos + dir * 0.5f, dir * BULLET_VEL_MAX);
+        }
+    }
+
+    //tick bullets
+    //NOTE: bullets are moved all at once by a vectorized kernel, then collided and compacted in a second pass
+    //      which keeps the survivors in their original order
+    integrate_bullets(level.bullets, tick, level.camCenter, viewSize.x / PIXELS_PER_UNIT * 2);
+    BulletPool & bullets = level.bullets;
+    int survivors = 0;
+    TimeLoop("collide bullets") for (int i = 0; i < bullets.len; ++i) {
+        //despawn if very far from the camera
+        if (bullets.despawn[i]) continue;
+
+        //collide with level
+        Vec2 pos = bullets.pos(i);
+        if (collide_with_tiles(level.tiles, bullet_hitbox(pos))) continue;
+
+        //collide with player
+        Vec2 vel = bullets.vel(i);
+        if (intersects(bullet_hitbox(pos), player_hitbox(level.player.pos))) {
+            level.player.vel += (vel - level.player.vel) * (BULLET_MASS / PLAYER_MASS) * 0.5f;
+            Vec2 normal = noz(level.player.pos - pos);
+            level.player.vel += normal * fmaxf(0, dot(vel, normal)) * (BULLET_MASS / PLAYER_MASS) * 0.5f;
+            continue;
+        }
+
+        //collide with shield
+        if (intersects(reverse_winding(shield_hitbox(level.player)),
+                       reverse_winding(obb(bullet_hitbox(pos)))))
+        {
+            //this check ensures bullets only bounce off the shield's front side, not its back side
+            if (dot(vel - level.player.vel, level.player.cursor) < 0) {
+                //in order to do this properly we have to do proper rigidbody collision response
+                //so the math gets kind of hairy. equations basically copied from chris hecker's
+                //collision response articles http://www.chrishecker.com/images/e/e7/Gdmphys3.pdf
+                //NOTE: because |n| and e are both 1, some equations from the article become simplified
+                Vec2 normal = noz(level.player.cursor);
+                Vec2 relVel = vel - level.player.vel;
+                float impulse = -2 * dot(relVel, normal) / (1 / BULLET_MASS + 1 / PLAYER_MASS);
+                vel += normal * (impulse / BULLET_MASS);
+                level.player.vel -= normal * (impulse / PLAYER_MASS);
+                events.add({ EVENT_SHIELD_HIT, impulse });
+            }
+        }
+
+        bullets.posx[survivors] = pos.x;
+        bullets.posy[survivors] = pos.y;
+        bullets.velx[survivors] = vel.x;
+        bullets.vely[survivors] = vel.y;
+        ++survivors;
+    }
+    bullets.len = survivors;
+
+    //tick walkers
+    //NOTE: like enemies, walkers are ticked in parallel and their effect on the player is applied in order afterwards
+    XRange<Walker> walkers = x_range(level.walkers, activeMinX - WALKER_HOME_RADIUS, activeMaxX + WALKER_HOME_RADIUS);
+    int walkerCount = walkers.end() - walkers.begin();
+    set_len(scratch.attacked, walkerCount);
+    TimeLoop("tick walkers") parallel_for(walkerCount, ENTITY_BATCH_SIZE, [&] (int first, int last) {
+        for (int i = first; i < last; ++i) {
+            Walker & walker = walkers.first[i];
+
+            //attack
+            scratch.attacked[i] = false;
+            if (!level.player.dead && walker.attackTimer == 0 && len(level.player.pos - walker.pos) < WALKER_ATTACK_RANGE) {
+                walker.attackTimer = WALKER_ATTACK_TIME;
+                walker.walkTimer = 0;
+                scratch.attacked[i] = true;
+            }
+            walker.attackTimer = fmaxf(0, walker.attackTimer - tick);
+
+            //walk
+            if (walker.attackTimer == 0 && len(level.player.pos - walker.pos) < WALKER_AGRO_RANGE) {
+                if (walker.pos.x > walker.home.x - WALKER_HOME_RADIUS && level.player.pos.x < walker.pos.x - 0.1f) {
+                    walker.pos.x -= WALKER_WALK_SPEED * tick;
+                    walker.walkTimer += tick;
+                    walker.facingRight = false;
+                } else if (walker.pos.x < walker.home.x + WALKER_HOME_RADIUS && level.player.pos.x > walker.pos.x + 0.1f) {
+                    walker.pos.x += WALKER_WALK_SPEED * tick;
+                    walker.walkTimer += tick;
+                    walker.facingRight = true;
+                } else {
+                    walker.walkTimer = 0;
+                }
+            }
+        }
+    });
+    for (int i = 0; i < walkerCount; ++i) {
+        if (scratch.attacked[i]) {
+            level.player.vel.y = 0;
+            level.player.vel -= noz(level.player.cursor) * 20;
+            events.add({ EVENT_WALKER_ATTACK });
+        }
+    }
+
+    //update camera
+    if (input.debugCam) {
+        level.camCenter += input.debugCamMove * 50 * tick;
+    } else { TimeScope("update camera")
+        level.camCenter += (level.player.pos + vec2(5, 10) - level.camCenter) * 0.01f; //TODO: tick rate dependent
+        level.camCenter.x = fmaxf(level.camCenter.x, viewSize.x / 2.0f / PIXELS_PER_UNIT);
+        level.camCenter.y = fmaxf(level.camCenter.y, viewSize.y / 2.0f / PIXELS_PER_UNIT);
+        level.camCenter.y = fminf(level.camCenter.y, level.tiles.height * UNITS_PER_TILE - viewSize.y / 2 / PIXELS_PER_UNIT);
+    }
+}
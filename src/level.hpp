@@ -3,8 +3,11 @@
 
 #include "math.hpp"
 #include "list.hpp"
+#include "types.hpp"
 #include "tilemap.h"
 #include "trace.hpp"
+#include "bullet.hpp"
+#include <algorithm>
 
 //NOTE: only the ratios of different masses matter, so the units are unimportant, imagine they're kilograms
 static const float PLAYER_MASS = 50;
@@ -39,17 +42,10 @@ static inline OBB shield_hitbox(Player & player) {
 
 static const float BULLET_INTERVAL = 1.0f; //TODO: per-enemy interval
 static const float BULLET_INTERVAL_VARIANCE = 1.3f;
-static const float BULLET_VEL_MAX = 40.0f;
-static const float BULLET_VEL_MIN = 16.0f;
 struct Enemy {
     Vec2 pos;
     float timer;
-};
-
-static const float BULLET_RADIUS = 0.5f;
-struct Bullet {
-    Vec2 pos;
-    Vec2 vel;
+    Rng rng; //each enemy has its own, so the result of ticking them doesn't depend on what order it happens in
 };
 
 //TODO: collapse this with `player_hitbox()`
@@ -62,16 +58,87 @@ struct Tile {
     int layer[3];
 };
 
+static const int LEVEL_WIDTH = 100000; //in tiles
+static const int LEVEL_HEIGHT = 50; //in tiles, every section has to be exactly this tall
+static const int SECTION_COUNT = 10;
+
+enum SpawnType : u8 {
+    SPAWN_GHOST,
+    SPAWN_WALKER,
+};
+
+struct SectionSpawn {
+    int x, y; //in tiles, relative to the section
+    SpawnType type;
+    u8 pad[3]; //so that the baked file has no uninitialized bytes in it
+};
+
+//a Tiled section prefab, converted to a compact form that every level shares
+//NOTE: a section only stores one byte per tile, which indexes into the distinct tiles of all sections put together
+//NOTE: sections are baked to a binary file and the arrays here point straight into the memory-mapped file,
+//      so they must be treated as read-only
+struct Section {
+    int width;
+    u8 * tiles; //indices into `SectionSet::palette`, [y * width + x]
+    u64 * solid; //one bitmap per row, starting at word `y * solidStride`, bit set if the tile has collision
+    int solidStride; //words per row, including a zero word of padding so bits can always be read two words at a time
+    SectionSpawn * spawns; //in order of x
+    int spawnCount;
+    char * tileset; //image file the section's tile indices refer to, relative to res/
+    int firstGid; //the Tiled gid of the tileset's first tile, which has already been subtracted from the tiles
+};
+
+struct SectionSet {
+    Section sections[SECTION_COUNT];
+    Tile palette[256];
+    int paletteLen;
+};
+
+//returns bits [sx, sx + count) of row `y` of the section's solidity bitmap, shifted down to start at bit 0
+static inline u64 section_solid_bits(Section & section, int y, int sx, int count) {
+    assert(count > 0 && count <= 64);
+    u64 * row = section.solid + y * section.solidStride + sx / 64;
+    int shift = sx % 64;
+    u64 bits = shift? row[0] >> shift | row[1] << (64 - shift) : row[0];
+    return count == 64? bits : bits & ((1ull << count) - 1);
+}
+
+//a stretch of the level that is an instance of one of the sections
+struct SectionRun {
+    u8 section;
+    int xstart; //in tiles
+};
+
+//NOTE: the smallest section is 30 tiles wide, so a stretch of this many columns can touch at most two runs
+static const int RUN_TABLE_GRANULARITY = 16;
+
+//the level's tiles aren't stored anywhere, they're looked up on the fly from the sections via the run list
 struct TileGrid {
-    Tile * tiles;
+    SectionSet * set;
+    SectionRun * runs; //in order of `xstart`, covering the whole level
+    int runCount;
+    u16 * runTable; //run containing column `i * RUN_TABLE_GRANULARITY`, so column lookups are O(1)
     int width, height;
-
-    //NOTE: indexed in [y][x] order!!!
-    inline Tile * operator[] (int row) {
-        return tiles + row * width;
-    }
 };
 
+//returns the index of the run containing column `x`
+static inline int run_at(TileGrid & grid, int x) {
+    int run = grid.runTable[x / RUN_TABLE_GRANULARITY];
+    if (run + 1 < grid.runCount && grid.runs[run + 1].xstart <= x) ++run;
+    return run;
+}
+
+static inline Tile get_tile(TileGrid & grid, int x, int y) {
+    SectionRun & run = grid.runs[run_at(grid, x)];
+    Section & section = grid.set->sections[run.section];
+    return grid.set->palette[section.tiles[y * section.width + x - run.xstart]];
+}
+
+//entities are streamed in and out in chunks of this many columns as the camera moves
+static const int CHUNK_WIDTH = 64; //in tiles
+static const int CHUNK_COUNT = 8; //how many chunks' entities are spawned at once
+static const int CHUNKS_BEHIND = 3; //how many of those chunks are behind the camera's chunk
+
 static const float WALKER_ATTACK_TIME = 0.3f;
 static const float WALKER_HOME_RADIUS = 12.0f;
 static const float WALKER_AGRO_RANGE = 25.0f;
@@ -86,102 +153,115 @@ struct Walker {
     bool facingRight;
 };
 
+//enemies are kept sorted by `pos.x` and walkers by `home.x` (which never changes, unlike `pos.x`)
+//so that the tick and the renderer can binary search for the ones near the camera
+//instead of touching every entity in the whole level every frame
+static inline float sort_key(Enemy & enemy) { return enemy.pos.x; }
+static inline float sort_key(Walker & walker) { return walker.home.x; }
+
+template <typename TYPE>
+static inline int lower_bound_x(List<TYPE> & list, float x) {
+    int lo = 0, hi = list.len;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (sort_key(list.data[mid]) < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+template <typename TYPE>
+struct XRange {
+    TYPE * first;
+    TYPE * last;
+
+    inline TYPE * begin() { return first; }
+    inline TYPE * end() { return last; }
+};
+
+//returns the elements of an x-sorted list whose sort key is in the range [minx, maxx), for use with range-for
+template <typename TYPE>
+static inline XRange<TYPE> x_range(List<TYPE> & list, float minx, float maxx) {
+    return { list.data + lower_bound_x(list, minx), list.data + lower_bound_x(list, maxx) };
+}
+
+template <typename TYPE>
+static inline void sort_by_x(List<TYPE> & list) {
+    std::sort(list.begin(), list.end(), [] (TYPE & a, TYPE & b) { return sort_key(a) < sort_key(b); });
+}
+
+//enemies further away from the player than this are dormant
+//NOTE: walkers use the same range even though they only react to the player from much closer,
+//      because it's far enough that no walker can still be mid-attack by the time it goes dormant
+static const float ACTIVE_RANGE = 100;
+
 struct Level {
+    u32 seed; //everything about the level's layout and spawns is derived from this
+    int chunks[CHUNK_COUNT]; //which chunks' entities are spawned, chunk i can only ever be in slot i % CHUNK_COUNT
     Player player;
     Vec2 camCenter;
     List<Enemy> enemies;
     List<Walker> walkers;
-    List<Bullet> bullets;
+    BulletPool bullets;
     TileGrid tiles;
     Vec2 playerStartPos;
 };
 
+static const float TICK_LENGTH = 1.0f / 250; //seconds of game time per simulation tick (at normal game speed)
+
+//everything the simulation needs to know about the player's input for one tick
+struct TickInput {
+    Coord2 mouseMotion;
+    bool debugCam;
+    Vec2 debugCamMove; //only used when `debugCam` is on
+};
+
+//things that happen during a tick that the simulation itself doesn't care about
+//but the outside world might (sound, screenshake, saving the player's record, etc.)
+enum GameEventType {
+    EVENT_PLAYER_DIED,
+    EVENT_SHIELD_HIT,
+    EVENT_WALKER_ATTACK,
+};
+
+struct GameEvent {
+    GameEventType type;
+    float impulse; //only used by EVENT_SHIELD_HIT
+};
+
+//advances the level by one tick of `tick` seconds
+//`viewSize` is the size of the canvas in pixels, which the camera and bullet despawning depend on
+void tick_level(Level & level, TickInput input, float tick, Coord2 viewSize, List<GameEvent> & events);
+
+//bakes the Tiled JSON files into `path`, which the game loads from res/sections.bin
+//NOTE: res/sections.bin is normally rebuilt automatically whenever it's out of date
+void bake_sections(const char * path);
+
+//spawns/despawns chunks' worth of entities so that the ones around `focusX` are active
+void stream_level(Level & level, float focusX);
+Level init_level(u32 seed);
+void free_level(Level & level);
+
 static inline bool collide_with_tiles(TileGrid & tiles, Rect hitbox) {
     int minx = imax(0, floorf(hitbox.x / UNITS_PER_TILE));
     int miny = imax(0, floorf(hitbox.y / UNITS_PER_TILE));
     int maxx = imin(tiles.width , ceilf((hitbox.x + hitbox.w) / UNITS_PER_TILE));
     int maxy = imin(tiles.height, ceilf((hitbox.y + hitbox.h) / UNITS_PER_TILE));
-    for (int y = miny; y < maxy; ++y) {
-        for (int x = minx; x < maxx; ++x) {
-            if (tiles[y][x].layer[2] >= 0) {
+
+    //test the columns one run at a time, up to 64 of them at once
+    for (int x = minx; x < maxx;) {
+        SectionRun & run = tiles.runs[run_at(tiles, x)];
+        Section & section = tiles.set->sections[run.section];
+        int sx = x - run.xstart;
+        int count = imin(imin(section.width - sx, maxx - x), 64);
+        for (int y = miny; y < maxy; ++y) {
+            if (section_solid_bits(section, y, sx, count)) {
                 return true;
             }
         }
+        x += count;
     }
     return false;
 }
 
-static inline void draw_tile_grid(Canvas & canvas, TileGrid & tiles, Tileset & tileset, int offx, int offy) { TimeFunc
-    int minx = imax(0, floorf(offx / PIXELS_PER_TILE));
-    int miny = imax(0, floorf(offy / PIXELS_PER_TILE));
-    int maxx = imin(tiles.width , ceilf((offx + canvas.width ) / PIXELS_PER_TILE));
-    int maxy = imin(tiles.height, ceilf((offy + canvas.height) / PIXELS_PER_TILE));
-    for (int y = miny; y < maxy; ++y) {
-        for (int x = minx; x < maxx; ++x) {
-            for (int i = 0; i < 3; ++i) {
-                if (tiles[y][x].layer[i] >= 0) {
-                    int tx = tiles[y][x].layer[i] % tileset.width;
-                    int ty = tiles[y][x].layer[i] / tileset.width;
-                    draw_tile_a1(canvas, tileset, tx, ty, x * PIXELS_PER_TILE - offx, y * PIXELS_PER_TILE - offy);
-                }
-            }
-        }
-    }
-}
-
-static inline Level init_level() {
-    Level level = {};
-
-    //load Tiled section prefabs
-    Tilemap sections[10];
-    for (int i = 0; i < ARR_SIZE(sections); ++i) {
-        sections[i].LoadMap(dsprintf(nullptr, "res/section%d.json", i)); //leak
-        assert(sections[i].mapLayers.size() == 4);
-        assert(sections[i].mapLayers[0].height == 50);
-        assert(sections[i].mapLayers[1].height == 50);
-        assert(sections[i].mapLayers[2].height == 50);
-        assert(sections[i].mapLayers[3].height == 50);
-    }
-
-    //copy section0 data to the tile grid
-    int width = 100000, height = 50, xstart = 0, sectionCount = 0;
-    level.tiles = { (Tile *) malloc(width * height * sizeof(Tile)), width, height };
-    while (xstart < width - 500) { //magic number here should be >= largest section width
-        int sectionIdx = rand_int(1, ARR_SIZE(sections));
-        if (xstart == 0) sectionIdx = 0;
-        Tilemap & section = sections[sectionIdx];
-        for (int y = 0; y < 50; ++y) {
-            for (int x = 0; x < section.mapLayers[0].width; ++x) {
-                level.tiles[y][x + xstart] = { {
-                    section.mapLayers[0].data[section.mapLayers[0].width * y + x] - 1,
-                    section.mapLayers[1].data[section.mapLayers[1].width * y + x] - 1,
-                    section.mapLayers[2].data[section.mapLayers[2].width * y + x] - 1,
-                } };
-                static const int ghostIdx = 2;
-                static const int walkerIdx = 6;
-                int enemyIdx = section.mapLayers[3].data[section.mapLayers[3].width * y + x] - 1;
-                if (enemyIdx == ghostIdx) {
-                    level.enemies.add({ .pos = vec2(x + xstart + rand_float(), y + 0.5f) * UNITS_PER_TILE,
-                                        .timer = rand_float(BULLET_INTERVAL / BULLET_INTERVAL_VARIANCE) });
-                } else if (enemyIdx == walkerIdx) {
-                    Vec2 pos = vec2(x + xstart + rand_float(), y) * UNITS_PER_TILE;
-                    level.walkers.add({ .home = pos, .pos = pos });
-                }
-            }
-        }
-        xstart += section.mapLayers[0].width;
-        ++sectionCount;
-    }
-    printf("sectionCount: %d\n", sectionCount);
-
-    //spawn debug/test setup
-    // level.playerStartPos = level.player.pos = vec2(20, 20);
-    level.playerStartPos = level.player.pos = vec2(80, 60);
-    // level.enemies.add({ .pos = vec2(-10 + 20, 10 + 30) });
-    // level.enemies.add({ .pos = vec2(  3 + 20, 12 + 30) });
-    // level.enemies.add({ .pos = vec2( 11 + 20, 10 + 30) });
-    level.camCenter = level.player.pos;
-
-    return level;
-}
 #endif // VOXEL_LEVEL_HPP
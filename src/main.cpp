@@ -27,6 +27,10 @@ GAMEPLAY TODOS:
 #include "msf_gif.h"
 #include "pixel.hpp"
 #include "graphics.hpp"
+#include "bench.hpp"
+#include "pregen.hpp"
+#include "render.hpp"
+#include "jobs.hpp"
 
 #include "soloud.h"
 #include "soloud_wav.h"
@@ -85,6 +89,7 @@ static SoLoud::Wav sfx_lose;
 
 int main(int argc, char ** argv) {
     init_profiling_trace();
+    init_job_system();
     global_pcg_state = time(NULL);
 
     #ifdef _WIN32
@@ -99,6 +104,9 @@ int main(int argc, char ** argv) {
             SDL_free(basePath);
         }
 
+        //headless modes don't need a window, a GL context or audio, so we branch off before creating any of those
+        if (int ret = run_headless(argc, argv); ret >= 0) return ret;
+
         //initialize timer and startup SDL
         TimeLine("SDL init")
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER | SDL_INIT_AUDIO)) {
@@ -106,8 +114,8 @@ int main(int argc, char ** argv) {
             exit(1);
         }
     print_log("[] SDL init: %f seconds\n", get_time());
-        const int canvasWidth = 640;
-        const int canvasHeight = 360;
+        const int canvasWidth = CANVAS_WIDTH;
+        const int canvasHeight = CANVAS_HEIGHT;
         const int pixelScale = 2;
         const int windowWidth = canvasWidth * pixelScale;
         const int windowHeight = canvasHeight * pixelScale;
@@ -151,16 +159,19 @@ int main(int argc, char ** argv) {
         ImGui_ImplOpenGL3_Init();
     print_log("[] dear imgui init: %f seconds\n", get_time());
         Imm imm = {};
-        TimeLine("Imm.init") imm.init(500);
-        TimeLine("load_font") imm.font = load_font("res/nova.fnt");
+        //with text and images all in the atlas, nothing else splits a frame's overlay into more than one batch
+        TimeLine("Imm.init") imm.init(1 << 14);
+        TimeLine("load_font") imm.font = load_font("res/nova.fnt", imm.atlas);
 
-        uint blitShader = create_program_from_files("res/blit.vert", "res/blit.frag");
-        Canvas canvas = make_canvas(canvasWidth, canvasHeight, 16);
+        CanvasPresenter presenter = make_canvas_presenter(create_program_from_files("res/blit.vert", "res/blit.frag"));
         Graphics graphics = load_graphics();
+        //NOTE: with only one hardware thread, pipelining would just add a frame of latency
+        RenderPipeline * pipeline = make_render_pipeline(canvasWidth, canvasHeight, LEVEL_HEIGHT, job_thread_count() > 1);
         MonoFont font = load_mono_font("res/font-16-white.png", 8, 16);
     print_log("[] graphics init: %f seconds\n", get_time());
         settings.load();
-        Level level = init_level();
+        Level level = init_level(rand_int());
+        start_level_pregen(rand_int());
     print_log("[] level init: %f seconds\n", get_time());
         TimeLine("SoLoud init") if (int err = loud.init(); err) printf("soloud init error: %d\n", err);
     print_log("[] soloud init: %f seconds\n", get_time());
@@ -195,10 +206,11 @@ int main(int argc, char ** argv) {
         gl_error("program init");
     print_log("[] done initializing: %f seconds\n", get_time());
 
-    const float tickLength = 1.0f/250;
+    const float tickLength = TICK_LENGTH;
     float gameSpeed = 1.0f;
     float tickSpeed = 1.0f;
     float shakeTimer = 0;
+    List<GameEvent> events = {};
 
     const static float TUTORIAL_TIME = 8;
     const static char * tutorialLines[] = {
@@ -263,7 +275,7 @@ int main(int argc, char ** argv) {
             if (TICK_DOWN(G) && (HELD(LGUI) || HELD(RGUI) || HELD(LCTRL) || HELD(RCTRL))) {
                 giffing = !giffing;
                 if (giffing) {
-                    msf_gif_begin(&gifState, canvas.width, canvas.height);
+                    msf_gif_begin(&gifState, canvasWidth, canvasHeight);
                     gifTimer = 0;
                 } else {
                     MsfGifResult result = msf_gif_end(&gifState);
@@ -283,23 +295,14 @@ int main(int argc, char ** argv) {
 
 
             //game update logic goes here
-            //update virtual cursor
-            level.player.cursor += vec2(input.tick.mouseMotion) * 0.04f;
-            float cursorRadiusInner = 1.0f, cursorRadiusOuter = 5.0f;
-            if (len(level.player.cursor) < 0.001f) level.player.cursor = vec2(0, cursorRadiusInner);
-            if (len(level.player.cursor) < cursorRadiusInner) level.player.cursor = setlen(level.player.cursor, cursorRadiusInner);
-            if (len(level.player.cursor) > cursorRadiusOuter) level.player.cursor = setlen(level.player.cursor, cursorRadiusOuter);
-
-            //tick player
-            if (!level.player.dead) {
-                //apply gravity to player
-                Vec2 gravity = vec2(0, 8.0f);
-                level.player.vel += gravity * tick;
-                level.player.pos += level.player.vel * tick;
-
-                //kill player if they touch any solid geometry
-                if (collide_with_tiles(level.tiles, player_hitbox(level.player.pos))) {
-                    level.player.dead = true;
+            static bool debugCam = false;
+            DEBUG_TOGGLE(debugCam, TICK_DOWN(F));
+            TickInput tickInput = { input.tick.mouseMotion, debugCam, vec2(HELD(D) - HELD(A), HELD(S) - HELD(W)) };
+            tick_level(level, tickInput, tick, coord2(canvasWidth, canvasHeight), events);
+
+            //handle game events
+            for (GameEvent & event : events) {
+                if (event.type == EVENT_PLAYER_DIED) {
                     settings.bestDistance = fmaxf(settings.bestDistance, level.player.pos.x - level.playerStartPos.x);
                     settings.save();
 
@@ -307,127 +310,17 @@ int main(int argc, char ** argv) {
                     shakeTimer = 20;
                     loud.play(sfx_gunshot, 2.0f);
                     loud.play(sfx_lose, 1.0f);
-                }
-            }
-
-            //tick enemies and spawn bullets
-            for (Enemy & enemy : level.enemies) {
-                if (len(enemy.pos - level.player.pos) > 100) continue;
-
-                //proximity will make enemies shoot slightly faster as you get closer, to keep the game balanced
-                //NOTE: it's important to apply the proximity effect to how fast the timer counts down
-                //      instead of to its starting value, since the latter will inherently create some lag
-                //      in the responsiveness of the effect
-                float proximity = 0.2f * powf(len(enemy.pos - level.player.pos), 1.0f / 2);
-                enemy.timer -= tick / fmaxf(0.2f, proximity);
-                if (enemy.timer < 0) {
-                    float random = rand_float(BULLET_INTERVAL_VARIANCE, 1 / BULLET_INTERVAL_VARIANCE);
-                    enemy.timer = BULLET_INTERVAL * random;
-
-                    //TODO: make enemies partly lead their shots
-                    Vec2 dir = noz(level.player.pos - enemy.pos);
-                    level.bullets.add({ .pos = enemy.pos + dir * 0.5f, .vel = dir * BULLET_VEL_MAX });
-                }
-            }
-
-            //tick bullets
-            for (int i = 0; i < level.bullets.len; ++i) {
-                Bullet & bullet = level.bullets[i];
-
-                //bullet velocity exponentially decays from the starting velocity down to BULLET_VEL_MIN
-                bullet.vel = noz(bullet.vel) * (BULLET_VEL_MIN + (len(bullet.vel) - BULLET_VEL_MIN) * powf(0.4f, tick));
-                bullet.pos += bullet.vel * tick;
-
-                //despawn if very far from the camera
-                if (len(bullet.pos - level.camCenter) > canvas.width / PIXELS_PER_UNIT * 2) {
-                    level.bullets.remove(i);
-                    i -= 1;
-                    continue;
-                }
-
-                //collide with level
-                if (collide_with_tiles(level.tiles, bullet_hitbox(bullet.pos))) {
-                    level.bullets.remove(i);
-                    i -= 1;
-                    continue;
-                }
-
-                //collide with player
-                if (intersects(bullet_hitbox(bullet.pos), player_hitbox(level.player.pos))) {
-                    level.player.vel += (bullet.vel - level.player.vel) * (BULLET_MASS / PLAYER_MASS) * 0.5f;
-                    Vec2 normal = noz(level.player.pos - bullet.pos);
-                    level.player.vel += normal * fmaxf(0, dot(bullet.vel, normal)) * (BULLET_MASS / PLAYER_MASS) * 0.5f;
-                    level.bullets.remove(i);
-                    i -= 1;
-                    continue;
-                }
-
-                //collide with shield
-                if (intersects(reverse_winding(shield_hitbox(level.player)),
-                               reverse_winding(obb(bullet_hitbox(bullet.pos)))))
-                {
-                    //this check ensures bullets only bounce off the shield's front side, not its back side
-                    if (dot(bullet.vel - level.player.vel, level.player.cursor) < 0) {
-                        //in order to do this properly we have to do proper rigidbody collision response
-                        //so the math gets kind of hairy. equations basically copied from chris hecker's
-                        //collision response articles http://www.chrishecker.com/images/e/e7/Gdmphys3.pdf
-                        //NOTE: because |n| and e are both 1, some equations from the article become simplified
-                        Vec2 normal = noz(level.player.cursor);
-                        Vec2 relVel = bullet.vel - level.player.vel;
-                        float impulse = -2 * dot(relVel, normal) / (1 / BULLET_MASS + 1 / PLAYER_MASS);
-                        bullet.vel += normal * (impulse / BULLET_MASS);
-                        level.player.vel -= normal * (impulse / PLAYER_MASS);
-
-                        //sound
-                        shakeTimer += 0.01f * impulse;
-                        loud.play(sfx_shield, 0.051f * sqrtf(impulse));
-                    }
-                }
-            }
-
-            //tick walkers
-            for (Walker & walker : level.walkers) {
-                //attack
-                if (!level.player.dead && walker.attackTimer == 0 && len(level.player.pos - walker.pos) < WALKER_ATTACK_RANGE) {
-                    level.player.vel.y = 0;
-                    level.player.vel -= noz(level.player.cursor) * 20;
-                    walker.attackTimer = WALKER_ATTACK_TIME;
-                    walker.walkTimer = 0;
-
+                } else if (event.type == EVENT_SHIELD_HIT) {
+                    //sound
+                    shakeTimer += 0.01f * event.impulse;
+                    loud.play(sfx_shield, 0.051f * sqrtf(event.impulse));
+                } else if (event.type == EVENT_WALKER_ATTACK) {
                     //sound
                     shakeTimer += 3;
                     loud.play(sfx_slash[rand_int(ARR_SIZE(sfx_slash))], 0.5f);
-
-                }
-                walker.attackTimer = fmaxf(0, walker.attackTimer - tick);
-
-                //walk
-                if (walker.attackTimer == 0 && len(level.player.pos - walker.pos) < WALKER_AGRO_RANGE) {
-                    if (walker.pos.x > walker.home.x - WALKER_HOME_RADIUS && level.player.pos.x < walker.pos.x - 0.1f) {
-                        walker.pos.x -= WALKER_WALK_SPEED * tick;
-                        walker.walkTimer += tick;
-                        walker.facingRight = false;
-                    } else if (walker.pos.x < walker.home.x + WALKER_HOME_RADIUS && level.player.pos.x > walker.pos.x + 0.1f) {
-                        walker.pos.x += WALKER_WALK_SPEED * tick;
-                        walker.walkTimer += tick;
-                        walker.facingRight = true;
-                    } else {
-                        walker.walkTimer = 0;
-                    }
                 }
             }
-
-            //update camera
-            static bool debugCam = false;
-            DEBUG_TOGGLE(debugCam, TICK_DOWN(F));
-            if (debugCam) {
-                level.camCenter += vec2(HELD(D) - HELD(A), HELD(S) - HELD(W)) * 50 * tick;
-            } else {
-                level.camCenter += (level.player.pos + vec2(5, 10) - level.camCenter) * 0.01f; //TODO: tick rate dependent
-                level.camCenter.x = fmaxf(level.camCenter.x, canvas.width / 2.0f / PIXELS_PER_UNIT);
-                level.camCenter.y = fmaxf(level.camCenter.y, canvas.height / 2.0f / PIXELS_PER_UNIT);
-                level.camCenter.y = fminf(level.camCenter.y, level.tiles.height * UNITS_PER_TILE - canvas.height / 2 / PIXELS_PER_UNIT);
-            }
+            events.len = 0;
 
 
 
@@ -468,6 +361,11 @@ int main(int argc, char ** argv) {
         glClearColor(0.01, 0.01, 0.01, 1);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+        //the frame is recorded into a draw list here, and rasterized on the render thread while the next one ticks
+        FrameSlot & frame = next_frame_slot(*pipeline);
+        DrawList & drawList = frame.list;
+        Canvas & canvas = frame.canvas;
+
         //calculate camera offset
         int offx = level.camCenter.x * PIXELS_PER_UNIT - canvas.width  * 0.5f;
         int offy = level.camCenter.y * PIXELS_PER_UNIT - canvas.height * 0.5f;
@@ -477,92 +375,19 @@ int main(int argc, char ** argv) {
         offy += rand_float(-shakeTimer, shakeTimer);
         shakeTimer = fmaxf(0, shakeTimer - dt * 30);
 
-        //clear canvas
-        for (int y = 0; y < canvas.height; ++y) {
-            for (int x = 0; x < canvas.width; ++x) {
-                canvas[y][x] = { (u8) (y + offy), (u8) (x + offx), 255, 255 };
-            }
-        }
-
-        //pixel art rendering and such goes here
-        auto draw_sprite_centered = [&canvas, &offx, &offy] (Image sprite, Vec2 pos) {
-            draw_sprite(canvas, sprite, pos.x * PIXELS_PER_UNIT - offx - sprite.width  * 0.5f,
-                                        pos.y * PIXELS_PER_UNIT - offy - sprite.height * 0.5f);
-        };
-
-        auto draw_anim_centered = [&canvas, &offx, &offy] (Tileset anim, Vec2 pos, int frame, bool flip) {
-            draw_tile_flip(canvas, anim, frame % anim.width, 0, pos.x * PIXELS_PER_UNIT - offx - anim.tileWidth  * 0.5f,
-                                                                pos.y * PIXELS_PER_UNIT - offy - anim.tileHeight * 0.5f, flip);
-        };
-
-        auto draw_hitbox = [&canvas, &offx, &offy] (Rect hb) {
-            draw_rect(canvas, lroundf(hb.x * PIXELS_PER_UNIT) - offx, lroundf(hb.y * PIXELS_PER_UNIT) - offy,
-                              lroundf(hb.w * PIXELS_PER_UNIT), lroundf(hb.h * PIXELS_PER_UNIT), { 255, 100, 255, 200 });
-        };
-
-        //draw level
-        draw_tile_grid(canvas, level.tiles, graphics.tileset, offx, offy);
-
-        if (!level.player.dead) {
-            //draw player and cursor
-            draw_sprite_centered(graphics.player, level.player.pos);
-            draw_sprite_centered(graphics.cursor, level.player.pos + level.player.cursor);
-
-            //draw shield
-            auto draw_obb = [&canvas, &offx, &offy] (OBB o, Color c) {
-                Coord2 p[4]; for (int i = 0; i < 4; ++i) p[i] = coord2(o.p[i] * PIXELS_PER_UNIT) - coord2(offx, offy);
-                draw_triangle(canvas, p[0].x, p[0].y, p[1].x, p[1].y, p[2].x, p[2].y, c);
-                draw_triangle(canvas, p[0].x, p[0].y, p[2].x, p[2].y, p[3].x, p[3].y, c);
-            };
-            draw_obb(shield_hitbox(level.player), { 128, 255, 128, 255 });
-        }
-
-        //draw enemies
-        for (Enemy & enemy : level.enemies) {
-            draw_sprite_centered(graphics.ghost, enemy.pos);
-        }
-
-        for (Walker & walker : level.walkers) {
-            if (walker.attackTimer > 0) {
-                draw_anim_centered(graphics.walkerAttack, walker.pos,
-                                   (1 - (walker.attackTimer / WALKER_ATTACK_TIME)) * graphics.walkerAttack.width, !walker.facingRight);
-            } else {
-                draw_anim_centered(graphics.walkerWalk, walker.pos, walker.walkTimer * WALKER_WALK_SPEED, !walker.facingRight);
-            }
-        }
-
-        //draw bullets
-        for (Bullet & bullet : level.bullets) {
-            float r1 = BULLET_RADIUS * PIXELS_PER_UNIT * 1.1f; //hitbox radiuse
-            float r2 = BULLET_RADIUS * PIXELS_PER_UNIT * 1.5f; //visual radius
-            draw_oval_f(canvas, bullet.pos.x * PIXELS_PER_UNIT - offx,
-                                bullet.pos.y * PIXELS_PER_UNIT - offy, r2, r2, { 255, 0, 0, 255 });
-            draw_oval_f(canvas, bullet.pos.x * PIXELS_PER_UNIT - offx,
-                                bullet.pos.y * PIXELS_PER_UNIT - offy, r1, r1, { 127, 0, 0, 255 });
-        }
-
         //DEBUG draw hitboxes
         static bool debugDraw = false;
         DEBUG_TOGGLE(debugDraw, FRAME_DOWN(H));
-        if (debugDraw) {
-            draw_hitbox(player_hitbox(level.player.pos));
-            for (Bullet & bullet : level.bullets) draw_hitbox(bullet_hitbox(bullet.pos));
-        }
 
-        //distance counter
-        {
-            char buf[50];
-            snprintf(buf, sizeof(buf), "distance: %.0f meters", level.player.pos.x - level.playerStartPos.x);
-            float r = 4;
-            float w = font.glyphWidth * strlen(buf) + r * 2, h = font.glyphHeight + r * 2;
-            draw_rect(canvas, canvas.width / 2 - w / 2, font.glyphHeight - r, w, h, { 0, 0, 0, 100 });
-            draw_text_center(canvas, font, canvas.width / 2 + 1, font.glyphHeight + 1, { 0, 0, 0, 255 }, buf);
-            draw_text_center(canvas, font, canvas.width / 2 + 0, font.glyphHeight + 0, { 255, 255, 255, 255 }, buf);
-        }
+        //pixel art rendering and such goes here
+        //NOTE: this is all recorded into the draw list first, and rasterized in parallel bands at the end
+        draw_level(drawList, level, graphics, frame.tileCache, offx, offy, coord2(canvas.width, canvas.height), debugDraw);
+
+        draw_distance_counter(drawList, level, font, coord2(canvas.width, canvas.height));
 
         //draw tutorial screen
         if (gameTime < TUTORIAL_TIME) {
-            draw_rect(canvas, 0, 0, canvas.width, canvas.height, { 0, 0, 0, 160 });
+            draw_rect(drawList, 0, 0, canvas.width, canvas.height, { 0, 0, 0, 160 });
 
             int lines = ARR_SIZE(tutorialLines);
             for (int i = 0; i < lines; ++i) {
@@ -576,7 +401,7 @@ int main(int argc, char ** argv) {
                 if (gameTime > trigger) {
                     float x = canvas.width / 2;
                     float y = canvas.height / 2 - font.glyphHeight * 6 + i * font.glyphHeight * 4;
-                    draw_text_center(canvas, font, x, y, { 255, 255, 255, 255 }, tutorialLines[i]);
+                    draw_text_center(drawList, font, x, y, { 255, 255, 255, 255 }, tutorialLines[i]);
                 }
             }
         }
@@ -589,31 +414,34 @@ int main(int argc, char ** argv) {
 
         //draw game over screen
         if (level.player.dead) {
-            draw_rect(canvas, 0, 0, canvas.width, canvas.height, { 0, 0, 0, 160 });
+            draw_rect(drawList, 0, 0, canvas.width, canvas.height, { 0, 0, 0, 160 });
             Color white = { 255, 255, 255, 255 };
-            draw_text_center(canvas, font, canvas.width / 2, canvas.height / 2 - 6 * font.glyphHeight, white, "GAME OVER");
+            draw_text_center(drawList, font, canvas.width / 2, canvas.height / 2 - 6 * font.glyphHeight, white, "GAME OVER");
             char buf[100] = {};
             snprintf(buf, sizeof(buf), "You made it %.0f meters toward freedom...", level.player.pos.x - level.playerStartPos.x);
-            draw_text_center(canvas, font, canvas.width / 2, canvas.height / 2 - 2 * font.glyphHeight, white, buf);
+            draw_text_center(drawList, font, canvas.width / 2, canvas.height / 2 - 2 * font.glyphHeight, white, buf);
             snprintf(buf, sizeof(buf), "Your personal best is %0.f meters.", settings.bestDistance);
-            draw_text_center(canvas, font, canvas.width / 2, canvas.height / 2 + 2 * font.glyphHeight, white, buf);
-            draw_text_center(canvas, font, canvas.width / 2, canvas.height / 2 + 6 * font.glyphHeight, white, "Press R to try again.");
+            draw_text_center(drawList, font, canvas.width / 2, canvas.height / 2 + 2 * font.glyphHeight, white, buf);
+            draw_text_center(drawList, font, canvas.width / 2, canvas.height / 2 + 6 * font.glyphHeight, white, "Press R to try again.");
         }
 
         //level restart
         if (FRAME_DOWN(R)) {
-            level = init_level();
+            swap_in_pregenerated_level(level, rand_int());
         }
 
         //framerate display
         {
             char buf[20] = {};
             snprintf(buf, sizeof(buf), "%dfps", (int) lroundf(framerate));
-            draw_text_right(canvas, font, canvas.width - font.glyphWidth, font.glyphHeight, { 255, 255, 255, 255 }, buf);
-            if (giffing) draw_text(canvas, font, font.glyphWidth, font.glyphHeight, { 255, 255, 255, 255 }, "GIF");
+            draw_text_right(drawList, font, canvas.width - font.glyphWidth, font.glyphHeight, { 255, 255, 255, 255 }, buf);
+            if (giffing) draw_text(drawList, font, font.glyphWidth, font.glyphHeight, { 255, 255, 255, 255 }, "GIF");
         }
 
-        draw_canvas(blitShader, canvas, bufferWidth, bufferHeight);
+        //put up the previous frame, which has been rasterizing since the start of this one
+        submit_frame(*pipeline);
+        Canvas * finished = finished_frame(*pipeline);
+        if (finished) draw_canvas(presenter, *finished, bufferWidth, bufferHeight);
 
 
 
@@ -643,8 +471,8 @@ int main(int argc, char ** argv) {
 
         //gif rendering
         //TODO: pull straight from the canvas
-        if (giffing && gifTimer > gifCentiseconds / 100.0f) {
-            msf_gif_frame(&gifState, (uint8_t *) canvas.pixels, gifCentiseconds, 15, canvas.pitch * 4);
+        if (giffing && finished && gifTimer > gifCentiseconds / 100.0f) {
+            msf_gif_frame(&gifState, (uint8_t *) finished->pixels, gifCentiseconds, 15, finished->pitch * 4);
             gifTimer -= gifCentiseconds / 100.0f;
         }
 
@@ -670,6 +498,9 @@ int main(int argc, char ** argv) {
         // if (frameCount > 5) shouldExit = true;
     }
 
+    //stops the rasterizer thread, which would otherwise still be waiting on a frame when the process exits
+    free_render_pipeline(pipeline);
+
     printf("[] exiting game normally at %f seconds\n", get_time()); fflush(stdout);
     return 0;
 }
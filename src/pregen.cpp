@@ -0,0 +1,78 @@
+#include "pregen.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct Pregen {
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable levelReady;
+
+    //everything below is guarded by `mutex`
+    bool requested;
+    u32 requestedSeed;
+    bool ready;
+    Level nextLevel;
+    List<Level> retired;
+};
+
+//NOTE: this is intentionally never destroyed, since the worker thread is never joined and destroying a condition
+//      variable that a thread is still waiting on (which would happen at exit if this was a plain global) can hang
+static Pregen & pregen = *new Pregen();
+
+static void pregen_thread() {
+    std::unique_lock<std::mutex> lock(pregen.mutex);
+    while (true) {
+        pregen.workAvailable.wait(lock, [] { return pregen.requested || pregen.retired.len; });
+
+        //free old levels first, so there's only ever one level's worth of extra memory in use
+        while (pregen.retired.len) {
+            Level level = pregen.retired[pregen.retired.len - 1];
+            pregen.retired.len -= 1;
+            lock.unlock();
+            free_level(level);
+            lock.lock();
+        }
+
+        if (pregen.requested) {
+            pregen.requested = false;
+            u32 seed = pregen.requestedSeed;
+            lock.unlock();
+            Level level = init_level(seed);
+            lock.lock();
+            pregen.nextLevel = level;
+            pregen.ready = true;
+            pregen.levelReady.notify_all();
+        }
+    }
+}
+
+void start_level_pregen(u32 seed) {
+    {
+        std::lock_guard<std::mutex> lock(pregen.mutex);
+        pregen.requested = true;
+        pregen.requestedSeed = seed;
+    }
+    std::thread(pregen_thread).detach();
+}
+
+void swap_in_pregenerated_level(Level & level, u32 nextSeed) { TimeFunc
+    std::unique_lock<std::mutex> lock(pregen.mutex);
+    pregen.levelReady.wait(lock, [] { return pregen.ready; });
+    pregen.retired.add(level);
+    level = pregen.nextLevel;
+    pregen.ready = false;
+    pregen.requested = true;
+    pregen.requestedSeed = nextSeed;
+
+    //NOTE: unlocking before waking the worker means it won't immediately block on the mutex we're still holding
+    lock.unlock();
+    pregen.workAvailable.notify_one();
+}
+
+void retire_level(Level & level) {
+    std::lock_guard<std::mutex> lock(pregen.mutex);
+    pregen.retired.add(level);
+    level = {};
+    pregen.workAvailable.notify_one();
+}
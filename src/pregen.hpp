@@ -0,0 +1,20 @@
+#ifndef PREGEN_HPP
+#define PREGEN_HPP
+
+#include "level.hpp"
+
+//builds the next level on a worker thread while the current one is being played, and frees old levels there too,
+//so that restarting is just a swap and never hitches the frame
+//NOTE: the first level has to be created with `init_level()` on the main thread before calling `start_level_pregen()`,
+//      so that the shared section data is already loaded by the time the worker thread uses it
+void start_level_pregen(u32 seed);
+
+//replaces `level` with the pre-generated one, hands the old one off to be freed,
+//and starts generating the level after that with `nextSeed`
+//NOTE: this only blocks if the worker hasn't finished yet, i.e. if the player restarts twice in very quick succession
+void swap_in_pregenerated_level(Level & level, u32 nextSeed);
+
+//hands a level that's no longer in use to the worker thread to be freed
+void retire_level(Level & level);
+
+#endif // PREGEN_HPP
@@ -0,0 +1,188 @@
+#include "render.hpp"
+#include "jobs.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+static void blit_tile_cache_callback(Canvas & canvas, void * data, int x, int y) {
+    blit_tile_cache(canvas, *(TileCache *) data, x, y);
+}
+
+//draws the stamp of a bullet centered on (x, y) in canvas pixels, which rounds its position to the nearest subpixel
+static void draw_bullet(DrawList & list, Tileset & stamps, float x, float y) {
+    int sx = lroundf(x * BULLET_STAMP_SUBPIXELS);
+    int sy = lroundf(y * BULLET_STAMP_SUBPIXELS);
+    draw_tile(list, stamps, floor_mod2(sx, BULLET_STAMP_SUBPIXELS), floor_mod2(sy, BULLET_STAMP_SUBPIXELS),
+        floor_div2(sx, BULLET_STAMP_SUBPIXELS) - stamps.tileWidth  / 2,
+        floor_div2(sy, BULLET_STAMP_SUBPIXELS) - stamps.tileHeight / 2);
+}
+
+void draw_level(DrawList & list, Level & level, Graphics & graphics, TileCache & tileCache,
+                int offx, int offy, Coord2 canvasSize, bool debugDraw) { TimeFunc
+    //draw level background, which also clears the canvas
+    update_tile_cache(tileCache, level, graphics.tileset, offx, canvasSize.x);
+    draw_callback(list, blit_tile_cache_callback, &tileCache, offx, offy, 0, canvasSize.y);
+
+    auto draw_sprite_centered = [&list, &offx, &offy] (Image sprite, Vec2 pos) {
+        draw_sprite(list, sprite, pos.x * PIXELS_PER_UNIT - offx - sprite.width  * 0.5f,
+                                  pos.y * PIXELS_PER_UNIT - offy - sprite.height * 0.5f);
+    };
+
+    auto draw_anim_centered = [&list, &offx, &offy] (Tileset anim, Vec2 pos, int frame, bool flip) {
+        draw_tile_flip(list, anim, frame % anim.width, 0, pos.x * PIXELS_PER_UNIT - offx - anim.tileWidth  * 0.5f,
+                                                          pos.y * PIXELS_PER_UNIT - offy - anim.tileHeight * 0.5f, flip);
+    };
+
+    auto draw_hitbox = [&list, &offx, &offy] (Rect hb) {
+        draw_rect(list, lroundf(hb.x * PIXELS_PER_UNIT) - offx, lroundf(hb.y * PIXELS_PER_UNIT) - offy,
+                        lroundf(hb.w * PIXELS_PER_UNIT), lroundf(hb.h * PIXELS_PER_UNIT), { 255, 100, 255, 200 });
+    };
+
+    if (!level.player.dead) {
+        //draw player and cursor
+        draw_sprite_centered(graphics.player, level.player.pos);
+        draw_sprite_centered(graphics.cursor, level.player.pos + level.player.cursor);
+
+        //draw shield
+        auto draw_obb = [&list, &offx, &offy] (OBB o, Color c) {
+            Coord2 p[4]; for (int i = 0; i < 4; ++i) p[i] = coord2(o.p[i] * PIXELS_PER_UNIT) - coord2(offx, offy);
+            draw_triangle(list, p[0].x, p[0].y, p[1].x, p[1].y, p[2].x, p[2].y, c);
+            draw_triangle(list, p[0].x, p[0].y, p[2].x, p[2].y, p[3].x, p[3].y, c);
+        };
+        draw_obb(shield_hitbox(level.player), { 128, 255, 128, 255 });
+    }
+
+    //draw enemies
+    //NOTE: the margins here just need to be at least half the width of each sprite, plus how far walkers can roam
+    float viewMinX = offx / PIXELS_PER_UNIT, viewMaxX = (offx + canvasSize.x) / PIXELS_PER_UNIT;
+    for (Enemy & enemy : x_range(level.enemies, viewMinX - 2, viewMaxX + 2)) {
+        draw_sprite_centered(graphics.ghost, enemy.pos);
+    }
+
+    float walkerMargin = WALKER_HOME_RADIUS + 4;
+    for (Walker & walker : x_range(level.walkers, viewMinX - walkerMargin, viewMaxX + walkerMargin)) {
+        if (walker.attackTimer > 0) {
+            draw_anim_centered(graphics.walkerAttack, walker.pos,
+                               (1 - (walker.attackTimer / WALKER_ATTACK_TIME)) * graphics.walkerAttack.width, !walker.facingRight);
+        } else {
+            draw_anim_centered(graphics.walkerWalk, walker.pos, walker.walkTimer * WALKER_WALK_SPEED, !walker.facingRight);
+        }
+    }
+
+    //draw bullets
+    for (int i = 0; i < level.bullets.len; ++i) {
+        Vec2 pos = level.bullets.pos(i);
+        draw_bullet(list, graphics.bulletStamps, pos.x * PIXELS_PER_UNIT - offx, pos.y * PIXELS_PER_UNIT - offy);
+    }
+
+    //DEBUG draw hitboxes
+    if (debugDraw) {
+        draw_hitbox(player_hitbox(level.player.pos));
+        for (int i = 0; i < level.bullets.len; ++i) draw_hitbox(bullet_hitbox(level.bullets.pos(i)));
+    }
+}
+
+void draw_distance_counter(DrawList & list, Level & level, MonoFont & font, Coord2 canvasSize) {
+    char buf[50];
+    snprintf(buf, sizeof(buf), "distance: %.0f meters", level.player.pos.x - level.playerStartPos.x);
+    float r = 4;
+    float w = font.glyphWidth * strlen(buf) + r * 2, h = font.glyphHeight + r * 2;
+    draw_rect(list, canvasSize.x / 2 - w / 2, font.glyphHeight - r, w, h, { 0, 0, 0, 100 });
+    draw_text_center(list, font, canvasSize.x / 2 + 1, font.glyphHeight + 1, { 0, 0, 0, 255 }, buf);
+    draw_text_center(list, font, canvasSize.x / 2 + 0, font.glyphHeight + 0, { 255, 255, 255, 255 }, buf);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// RENDER PIPELINE                                                                                                  ///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct RenderPipeline {
+    FrameSlot slots[2];
+    bool threaded;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable frameSubmitted;
+    std::condition_variable frameFinished;
+
+    //everything below is guarded by `mutex`. frame N is recorded into and rasterized from `slots[N % 2]`
+    int submitted; //number of frames handed off to be rasterized
+    int finished; //number of frames rasterized
+    bool quit;
+};
+
+static void rasterize_frame(FrameSlot & slot) { TimeFunc
+    execute_draw_list(slot.list, slot.canvas, job_thread_count());
+}
+
+static void render_thread(RenderPipeline * p) {
+    std::unique_lock<std::mutex> lock(p->mutex);
+    while (true) {
+        p->frameSubmitted.wait(lock, [p] { return p->finished < p->submitted || p->quit; });
+        if (p->quit) return;
+
+        FrameSlot & slot = p->slots[p->finished % 2];
+        lock.unlock();
+        rasterize_frame(slot);
+        lock.lock();
+        p->finished += 1;
+        p->frameFinished.notify_all();
+    }
+}
+
+RenderPipeline * make_render_pipeline(int canvasWidth, int canvasHeight, int levelHeight, bool threaded) {
+    RenderPipeline * p = new RenderPipeline();
+    for (FrameSlot & slot : p->slots) {
+        slot.canvas = make_canvas(canvasWidth, canvasHeight, 16);
+        slot.tileCache = make_tile_cache(canvasWidth, levelHeight);
+    }
+    p->threaded = threaded;
+    if (threaded) p->thread = std::thread(render_thread, p);
+    return p;
+}
+
+void free_render_pipeline(RenderPipeline * p) {
+    if (p->threaded) {
+        {
+            std::lock_guard<std::mutex> lock(p->mutex);
+            p->quit = true;
+        }
+        p->frameSubmitted.notify_all();
+        p->thread.join();
+    }
+    for (FrameSlot & slot : p->slots) {
+        slot.list.finalize();
+        free_tile_cache(slot.tileCache);
+        free(slot.canvas.basePointer());
+    }
+    delete p;
+}
+
+FrameSlot & next_frame_slot(RenderPipeline & p) {
+    std::unique_lock<std::mutex> lock(p.mutex);
+    p.frameFinished.wait(lock, [&p] { return p.finished >= p.submitted - 1; });
+    return p.slots[p.submitted % 2];
+}
+
+void submit_frame(RenderPipeline & p) {
+    if (!p.threaded) {
+        rasterize_frame(p.slots[p.submitted % 2]);
+        p.submitted += 1;
+        p.finished += 1;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        p.submitted += 1;
+    }
+    p.frameSubmitted.notify_one();
+}
+
+Canvas * finished_frame(RenderPipeline & p) { TimeFunc
+    if (!p.threaded) return p.submitted? &p.slots[(p.submitted - 1) % 2].canvas : nullptr;
+
+    std::unique_lock<std::mutex> lock(p.mutex);
+    if (p.submitted < 2) return nullptr;
+    p.frameFinished.wait(lock, [&p] { return p.finished >= p.submitted - 1; });
+    return &p.slots[(p.submitted - 2) % 2].canvas;
+}
@@ -0,0 +1,50 @@
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include "level.hpp"
+#include "drawlist.hpp"
+#include "graphics.hpp"
+#include "tilecache.hpp"
+
+//records everything in the level that's visible on a canvas of `canvasSize` at camera offset (offx, offy),
+//from the background up to the bullets, updating the tile cache first so that the background can be drawn in bands
+//NOTE: the HUD and menus are drawn on top of this by the caller
+void draw_level(DrawList & list, Level & level, Graphics & graphics, TileCache & tileCache,
+                int offx, int offy, Coord2 canvasSize, bool debugDraw);
+
+//records the "distance: N meters" box at the top center of a canvas of `canvasSize`
+void draw_distance_counter(DrawList & list, Level & level, MonoFont & font, Coord2 canvasSize);
+
+//everything it takes to rasterize one frame after it's been recorded: the draw list is the frame's snapshot of the
+//level (every sprite, bullet and piece of text with its position, with the camera offset and screenshake baked in),
+//the tile cache holds the background columns it blits from, and the canvas is where it gets drawn
+struct FrameSlot {
+    DrawList list;
+    TileCache tileCache;
+    Canvas canvas;
+};
+
+//rasterizes frames on a thread of its own, so that rasterizing one frame overlaps with simulating and recording
+//the next one (and presenting the one before), at the cost of showing each frame one frame later.
+//there are two frame slots, which are recorded into and rasterized from in turn:
+//  FrameSlot & slot = next_frame_slot(pipeline); //record the frame into `slot.list`...
+//  submit_frame(pipeline);
+//  Canvas * canvas = finished_frame(pipeline);   //...and put this one on screen, unless it's null
+//NOTE: when not `threaded`, frames are rasterized right away in `submit_frame()` with no extra latency
+struct RenderPipeline;
+
+RenderPipeline * make_render_pipeline(int canvasWidth, int canvasHeight, int levelHeight, bool threaded);
+void free_render_pipeline(RenderPipeline * pipeline);
+
+//the slot to record the next frame into, waiting for the frame that was last recorded into it to be rasterized
+FrameSlot & next_frame_slot(RenderPipeline & pipeline);
+
+//hands the frame recorded into the slot from `next_frame_slot()` off to be rasterized
+void submit_frame(RenderPipeline & pipeline);
+
+//waits for the frame before the one just submitted to be rasterized and returns its canvas,
+//or null if there isn't one yet (i.e. right after the first frame is submitted)
+//NOTE: the canvas stays untouched until the next call to `submit_frame()`
+Canvas * finished_frame(RenderPipeline & pipeline);
+
+#endif // RENDER_HPP
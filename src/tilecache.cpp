@@ -0,0 +1,86 @@
+#include "tilecache.hpp"
+#include <limits.h>
+
+static const int EMPTY_SLOT = INT_MIN; //never a valid tile column, not even way off the left side of the level
+
+TileCache make_tile_cache(int canvasWidth, int levelHeight) {
+    //a canvas-wide view can straddle one more column than fits in it, plus one spare so that when screenshake
+    //jitters the camera back and forth across a column boundary, both edge columns stay cached
+    int slotCount = (canvasWidth + TILE_PIXELS - 1) / TILE_PIXELS + 2;
+    TileCache cache = {};
+    cache.pitch = slotCount * TILE_PIXELS;
+    cache.height = levelHeight * TILE_PIXELS;
+    cache.pixels = (Pixel *) malloc(cache.pitch * cache.height * sizeof(Pixel));
+    cache.slots = (int *) malloc(slotCount * sizeof(int));
+    cache.slotCount = slotCount;
+    for (int i = 0; i < slotCount; ++i) cache.slots[i] = EMPTY_SLOT;
+    return cache;
+}
+
+void free_tile_cache(TileCache & cache) {
+    free(cache.pixels);
+    free(cache.slots);
+    cache = {};
+}
+
+//composites tile column `x` of the level into its slot in the cache, in the same order the tiles used to be drawn
+static void composite_column(TileCache & cache, TileGrid & tiles, Tileset & tileset, int x) {
+    int slot = floor_mod2(x, cache.slotCount);
+    cache.slots[slot] = x;
+
+    //a canvas that's just this column's slot, so the tiles get clipped and blended by the regular sprite code
+    Canvas column = { cache.pixels + slot * TILE_PIXELS, TILE_PIXELS, cache.height, cache.pitch, 0 };
+    for (int y = 0; y < column.height; ++y) {
+        for (int i = 0; i < TILE_PIXELS; ++i) {
+            column[y][i] = background_pixel(x * TILE_PIXELS + i, y);
+        }
+    }
+
+    if (x < 0 || x >= tiles.width) return;
+    for (int y = 0; y < tiles.height; ++y) {
+        Tile tile = get_tile(tiles, x, y);
+        for (int i = 0; i < 3; ++i) {
+            if (tile.layer[i] >= 0) {
+                int tx = tile.layer[i] % tileset.width;
+                int ty = tile.layer[i] / tileset.width;
+                draw_tile_a1(column, tileset, tx, ty, 0, y * TILE_PIXELS);
+            }
+        }
+    }
+}
+
+void update_tile_cache(TileCache & cache, Level & level, Tileset & tileset, int offx, int canvasWidth) { TimeFunc
+    if (cache.seed != level.seed) {
+        for (int i = 0; i < cache.slotCount; ++i) cache.slots[i] = EMPTY_SLOT;
+        cache.seed = level.seed;
+    }
+
+    //bring any newly revealed columns into the cache
+    int minx = floor_div2(offx, TILE_PIXELS);
+    int maxx = floor_div2(offx + canvasWidth - 1, TILE_PIXELS);
+    assert(maxx - minx < cache.slotCount);
+    for (int x = minx; x <= maxx; ++x) {
+        if (cache.slots[floor_mod2(x, cache.slotCount)] != x) {
+            composite_column(cache, level.tiles, tileset, x);
+        }
+    }
+}
+
+void blit_tile_cache(Canvas & canvas, TileCache & cache, int offx, int offy) { TimeFunc
+    //copy each row out of the ring, which wraps around at most once within the width of the canvas
+    int ringx = floor_mod2(offx, cache.pitch);
+    int firstWidth = imin(canvas.width, cache.pitch - ringx);
+    for (int y = canvas.top; y < canvas.height; ++y) {
+        Pixel * dst = canvas[y];
+        int wy = y + offy;
+        if (wy >= 0 && wy < cache.height) {
+            Pixel * src = cache.pixels + wy * cache.pitch;
+            memcpy(dst, src + ringx, firstWidth * sizeof(Pixel));
+            memcpy(dst + firstWidth, src, (canvas.width - firstWidth) * sizeof(Pixel));
+        } else {
+            for (int x = 0; x < canvas.width; ++x) {
+                dst[x] = background_pixel(x + offx, wy);
+            }
+        }
+    }
+}
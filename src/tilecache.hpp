@@ -0,0 +1,47 @@
+#ifndef TILECACHE_HPP
+#define TILECACHE_HPP
+
+#include "level.hpp"
+
+//the level's background (the gradient plus all three tile layers), pre-composited into an image that's a few
+//tile columns wider than the canvas and used as a ring buffer, so each tile column is only composited once
+//when it scrolls into view, and drawing the background is just a couple of row copies per canvas row
+//NOTE: the cache covers the full height of the level, rows above and below it are filled with the plain gradient
+static const int TILE_PIXELS = PIXELS_PER_TILE; //`PIXELS_PER_TILE` as an int, for indexing pixels
+
+struct TileCache {
+    Pixel * pixels; //[y * pitch + x], tile column `x` lives at pixel column `floor_mod2(x, slotCount) * TILE_PIXELS`
+    int pitch; //number of pixels, NOT number of bytes! always `slotCount * TILE_PIXELS`
+    int height; //in pixels
+    int * slots; //which tile column is currently composited into each slot
+    int slotCount;
+    u32 seed; //seed of the level the cached columns came from, the layout is entirely determined by it
+};
+
+//the background color of the world pixel at (x, y) where there are no tiles
+static inline Color background_pixel(int x, int y) {
+    return { (u8) y, (u8) x, 255, 255 };
+}
+
+//`canvasWidth` is in pixels, `levelHeight` is in tiles
+TileCache make_tile_cache(int canvasWidth, int levelHeight);
+void free_tile_cache(TileCache & cache);
+
+//composites whichever tile columns a canvas `canvasWidth` pixels wide at horizontal camera offset `offx` needs
+//that weren't in the cache yet
+//NOTE: the cache is keyed on the level's seed, so restarting into a new level invalidates it automatically
+void update_tile_cache(TileCache & cache, Level & level, Tileset & tileset, int offx, int canvasWidth);
+
+//fills the canvas (from `canvas.top` down) with the level's background at camera offset (offx, offy)
+//NOTE: this only reads the cache, so different bands of a canvas can be filled at the same time,
+//      but the cache has to have been updated for the same `offx` beforehand
+void blit_tile_cache(Canvas & canvas, TileCache & cache, int offx, int offy);
+
+static inline void draw_tile_cache(Canvas & canvas, TileCache & cache, Level & level, Tileset & tileset,
+                                   int offx, int offy)
+{
+    update_tile_cache(cache, level, tileset, offx, canvas.width);
+    blit_tile_cache(canvas, cache, offx, offy);
+}
+
+#endif // TILECACHE_HPP
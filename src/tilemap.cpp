@@ -62,6 +62,8 @@ void Tilemap::LoadMap(std::string path) {
 
 			Tileset set = load_tileset(&fullName[0], 16, 16);
 			tilesets.emplace_back(set);
+			tilesetImages.emplace_back(imgName);
+			tilesetFirstGids.emplace_back(t["firstgid"].get<int>());
 		}
 	}
 	else {
@@ -29,6 +29,8 @@ public:
 // private:
 	std::vector<TileLayer> mapLayers;
 	std::vector<Tileset> tilesets;
+	std::vector<std::string> tilesetImages;
+	std::vector<int> tilesetFirstGids;
 	std::vector<Vec2> enemySpawnPoints;
 };
 